@@ -0,0 +1,173 @@
+/*
+
+This program implements aggregate selects (count, min, max and sum)
+for a minimalistic SQLite DB based on a tutorial at
+https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+
+/*
+	count(*), min(id), max(id) and sum(id) are answered from the keys
+	in the leaves' slot directories without decoding a row -- a count
+	only finds where the range starts and ends in each leaf, and min
+	and max each come down to a single leaf
+*/
+
+
+/*
+	adds up the keys from first_key to last_key on the calling thread
+
+	table: pointer to the Table struct to read
+	first_key: smallest key to count
+	last_key: biggest key to count
+	with_sum: true if the keys should be summed as well as counted
+	totals: set to the count (and sum) of the keys in the range
+*/
+void total_keys_in_range(Table* table, uint32_t first_key, uint32_t last_key, bool with_sum, AggregateTotals* totals) {
+	totals->count = 0;
+	totals->sum = 0;
+
+	Cursor* cursor = find_range_in_table(table, first_key, last_key);
+	while (!(cursor->end_of_table)) {
+		void* node = cursor->node;
+		uint32_t num_cells = *get_leaf_num_cells(node);
+
+		/* the range runs to the end of the leaf unless the leaf goes
+		past last_key, in which case it ends at the first key that
+		does (and last_key can't be the biggest key there is) */
+		uint32_t end_cell = num_cells;
+		if (*get_leaf_key(node, num_cells - 1) > last_key) {
+			end_cell = search_keys(get_leaf_key(node, 0), LEAF_NODE_SLOT_SIZE / LEAF_NODE_KEY_SIZE,
+				num_cells, last_key + 1);
+		}
+
+		totals->count += end_cell - cursor->cell_num;
+		if (with_sum) {
+			for (uint32_t i = cursor->cell_num; i < end_cell; i++) {
+				totals->sum += *get_leaf_key(node, i);
+			}
+		}
+
+		/* settling from the end of the range moves on to the next
+		leaf, or finds that the range is over */
+		cursor->cell_num = end_cell;
+		settle_cursor(cursor);
+	}
+	close_cursor(cursor);
+}
+
+/*
+	visitor for a parallel count or sum: adds up the partition's keys
+
+	scan: pointer to the ParallelScan struct, with an AggregateScan
+	partition: index of the partition to add up
+*/
+void total_partition(ParallelScan* scan, uint32_t partition) {
+	AggregateScan* aggregate = scan->arg;
+	ScanPartition* range = &scan->partitions[partition];
+	total_keys_in_range(scan->table, range->first_key, range->last_key,
+		aggregate->with_sum, &aggregate->totals[partition]);
+}
+
+/*
+	counts (and sums) the keys from first_key to last_key, using the
+	scan threads if there are any
+
+	table: pointer to the Table struct to read
+	first_key: smallest key to count
+	last_key: biggest key to count
+	with_sum: true if the keys should be summed as well as counted
+	totals: set to the count (and sum) of the keys in the range
+*/
+void total_keys(Table* table, uint32_t first_key, uint32_t last_key, bool with_sum, AggregateTotals* totals) {
+	if (table->pager->scan_threads <= 1) {
+		total_keys_in_range(table, first_key, last_key, with_sum, totals);
+		return;
+	}
+
+	ParallelScan* scan = plan_parallel_scan(table, first_key, last_key);
+	uint32_t num_partitions = scan->num_partitions;
+	AggregateScan aggregate;
+	aggregate.with_sum = with_sum;
+	aggregate.totals = calloc(num_partitions, sizeof(AggregateTotals));
+	run_parallel_scan(scan, total_partition, &aggregate);
+
+	totals->count = 0;
+	totals->sum = 0;
+	for (uint32_t i = 0; i < num_partitions; i++) {
+		totals->count += aggregate.totals[i].count;
+		totals->sum += aggregate.totals[i].sum;
+	}
+	free(aggregate.totals);
+}
+
+/*
+	finds the smallest key from first_key to last_key
+
+	table: pointer to the Table struct to read
+	first_key: smallest key to consider
+	last_key: biggest key to consider
+	key: set to the smallest key in the range, if there is one
+	returns: false if there are no keys in the range
+*/
+bool find_min_key_in_range(Table* table, uint32_t first_key, uint32_t last_key, uint32_t* key) {
+	Cursor* cursor = find_range_in_table(table, first_key, last_key);
+	bool found = !(cursor->end_of_table);
+	if (found) {
+		*key = *get_leaf_key(cursor->node, cursor->cell_num);
+	}
+	close_cursor(cursor);
+	return found;
+}
+
+/*
+	finds the biggest key from first_key to last_key, reading only the
+	nodes on the way down to last_key's leaf
+
+	table: pointer to the Table struct to read
+	first_key: smallest key to consider
+	last_key: biggest key to consider
+	key: set to the biggest key in the range, if there is one
+	returns: false if there are no keys in the range
+*/
+bool find_max_key_in_range(Table* table, uint32_t first_key, uint32_t last_key, uint32_t* key) {
+	Pager* pager = table->pager;
+	uint32_t page_num = table->root_page_num;
+	void* node = latch_page(pager, page_num);
+	bool found = false;
+
+	while (get_node_type(node) == NODE_INTERNAL) {
+		/* the key left of the child is the biggest key before it, and
+		it's smaller than last_key, or we'd have gone left of it */
+		uint32_t child_index = find_internal_node_child(node, last_key);
+		if (child_index > 0) {
+			*key = *get_internal_node_key(node, child_index - 1);
+			found = true;
+		}
+		uint32_t child_num = *get_internal_node_child(node, child_index);
+		void* child = latch_page(pager, child_num);
+		unlatch_page(pager, page_num);
+		page_num = child_num;
+		node = child;
+	}
+
+	/* the leaf holds last_key itself, or the keys just before it */
+	uint32_t num_cells = *get_leaf_num_cells(node);
+	uint32_t cell_num = search_keys(get_leaf_key(node, 0), LEAF_NODE_SLOT_SIZE / LEAF_NODE_KEY_SIZE,
+		num_cells, last_key);
+	if (cell_num < num_cells && *get_leaf_key(node, cell_num) == last_key) {
+		*key = last_key;
+		found = true;
+	} else if (cell_num > 0) {
+		*key = *get_leaf_key(node, cell_num - 1);
+		found = true;
+	}
+	unlatch_page(pager, page_num);
+
+	return found && *key >= first_key;
+}
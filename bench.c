@@ -0,0 +1,542 @@
+/*
+
+This program benchmarks a minimalistic SQLite DB based on a tutorial
+at https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+#include <sys/resource.h>
+
+/*
+	drives the pager and the B-tree directly, one run per workload, and
+	prints a line of JSON for each with its throughput, latencies,
+	cache and I/O counters and peak RSS; email_lookup leaves its index
+	in the file, so it comes after the workloads that insert
+*/
+
+BenchWorkload bench_workloads[] = {
+	{ "seq_insert", true, false, bench_sequential_insert },
+	{ "rand_insert", true, false, bench_random_insert },
+	{ "point_lookup", false, false, bench_point_lookup },
+	{ "range_scan", false, false, bench_range_scan },
+	{ "range_count", false, false, bench_range_count },
+	{ "full_scan", false, false, bench_full_scan },
+	{ "parallel_scan", false, false, bench_parallel_scan },
+	{ "mixed", false, false, bench_mixed },
+	{ "concurrent_read", false, true, bench_concurrent_read },
+	{ "email_lookup", false, false, bench_email_lookup },
+};
+#define NUM_BENCH_WORKLOADS (sizeof(bench_workloads) / sizeof(BenchWorkload))
+
+
+/* returns the next number from a xorshift generator -- it's seeded
+from the options so runs can be repeated exactly */
+uint64_t next_random(uint64_t* state) {
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	*state = x;
+	return x;
+}
+
+/* writes the email the benchmark stores under the given id */
+void make_bench_email(uint32_t id, char* email) {
+	snprintf(email, COLUMN_EMAIL_SIZE + 1, "person%u@example.com", id);
+}
+
+/* fills in the row the benchmark stores under the given id -- the
+benchmark uses the first table, whose columns are id, username and
+email */
+void make_bench_row(Schema* schema, uint32_t id, Row* row) {
+	char id_string[16];
+	char username[COLUMN_USERNAME_SIZE + 1];
+	char email[COLUMN_EMAIL_SIZE + 1];
+	snprintf(id_string, sizeof(id_string), "%u", id);
+	snprintf(username, sizeof(username), "user%u", id);
+	make_bench_email(id, email);
+	char* values[] = { id_string, username, email };
+	encode_row(schema, values, row);
+}
+
+
+/* records how long the operation that started at start_ns took */
+void record_latency(BenchResult* result, uint64_t start_ns) {
+	result->latencies[result->num_ops++] = get_time_ns() - start_ns;
+}
+
+/* inserts one row as its own statement, the way the command line does */
+void bench_insert_key(Table* table, uint32_t key) {
+	Row row;
+	make_bench_row(&table->schema, key, &row);
+	Statement statement;
+	statement.type = STATEMENT_INSERT;
+	statement.rows_to_insert = &row;
+	statement.num_rows_to_insert = 1;
+	statement.rows_capacity = 1;
+	execute_statement(&statement, table);
+}
+
+/* inserts ids 1 to num_rows in order */
+void bench_sequential_insert(Table* table, BenchOptions* options, BenchResult* result) {
+	for (uint32_t key = 1; key <= options->num_rows; key++) {
+		uint64_t start = get_time_ns();
+		bench_insert_key(table, key);
+		record_latency(result, start);
+	}
+	result->rows_touched = options->num_rows;
+}
+
+/* inserts ids 1 to num_rows in a shuffled order */
+void bench_random_insert(Table* table, BenchOptions* options, BenchResult* result) {
+	uint32_t* keys = malloc(options->num_rows * sizeof(uint32_t));
+	for (uint32_t i = 0; i < options->num_rows; i++) {
+		keys[i] = i + 1;
+	}
+	uint64_t random_state = options->seed;
+	for (uint32_t i = options->num_rows; i > 1; i--) {
+		uint32_t j = next_random(&random_state) % i;
+		uint32_t swap = keys[i - 1];
+		keys[i - 1] = keys[j];
+		keys[j] = swap;
+	}
+
+	for (uint32_t i = 0; i < options->num_rows; i++) {
+		uint64_t start = get_time_ns();
+		bench_insert_key(table, keys[i]);
+		record_latency(result, start);
+	}
+	result->rows_touched = options->num_rows;
+	free(keys);
+}
+
+/*
+	reads every row from first_key to last_key out of the table
+
+	table: pointer to the Table struct to read
+	first_key: smallest id to read
+	last_key: largest id to read
+	returns: number of rows read
+*/
+uint64_t scan_range(Table* table, uint32_t first_key, uint32_t last_key) {
+	Row row;
+	uint64_t num_rows = 0;
+	Cursor* cursor = find_range_in_table(table, first_key, last_key);
+	while (!(cursor->end_of_table)) {
+		deserialize_row(get_cursor_value(cursor), *get_leaf_cell_length(cursor->node, cursor->cell_num), &row);
+		num_rows++;
+		advance_cursor(cursor);
+	}
+	close_cursor(cursor);
+	return num_rows;
+}
+
+/* looks up num_ops random ids, one at a time */
+void bench_point_lookup(Table* table, BenchOptions* options, BenchResult* result) {
+	uint64_t random_state = options->seed;
+	for (uint32_t i = 0; i < options->num_ops; i++) {
+		uint32_t key = next_random(&random_state) % options->num_rows + 1;
+		uint64_t start = get_time_ns();
+		result->rows_touched += scan_range(table, key, key);
+		record_latency(result, start);
+	}
+}
+
+/* reads num_ops runs of range_length ids, each from a random start */
+void bench_range_scan(Table* table, BenchOptions* options, BenchResult* result) {
+	uint64_t random_state = options->seed;
+	uint32_t num_starts = options->num_rows > options->range_length ?
+		options->num_rows - options->range_length + 1 : 1;
+	for (uint32_t i = 0; i < options->num_ops; i++) {
+		uint32_t first_key = next_random(&random_state) % num_starts + 1;
+		uint64_t start = get_time_ns();
+		result->rows_touched += scan_range(table, first_key, first_key + options->range_length - 1);
+		record_latency(result, start);
+	}
+}
+
+/* counts num_ops random ranges of range_length keys without reading
+their rows */
+void bench_range_count(Table* table, BenchOptions* options, BenchResult* result) {
+	uint64_t random_state = options->seed;
+	uint32_t num_starts = options->num_rows > options->range_length ?
+		options->num_rows - options->range_length + 1 : 1;
+	AggregateTotals totals;
+	for (uint32_t i = 0; i < options->num_ops; i++) {
+		uint32_t first_key = next_random(&random_state) % num_starts + 1;
+		uint64_t start = get_time_ns();
+		total_keys(table, first_key, first_key + options->range_length - 1, false, &totals);
+		result->rows_touched += totals.count;
+		record_latency(result, start);
+	}
+}
+
+/* finds num_ops random rows by email, through the email index */
+void bench_email_lookup(Table* table, BenchOptions* options, BenchResult* result) {
+	if (table->indexes[INDEX_EMAIL] == NULL) {
+		begin_write(table->pager);
+		create_index(table, INDEX_EMAIL);
+		commit_statement(table->pager);
+		end_write(table->pager);
+	}
+
+	uint64_t random_state = options->seed;
+	char email[COLUMN_EMAIL_SIZE + 1];
+	for (uint32_t i = 0; i < options->num_ops; i++) {
+		make_bench_email(next_random(&random_state) % options->num_rows + 1, email);
+		uint64_t start = get_time_ns();
+		uint32_t* ids;
+		uint32_t num_ids = find_ids_in_index(table->indexes[INDEX_EMAIL], hash_index_value(email, strlen(email)),
+			&ids);
+		for (uint32_t j = 0; j < num_ids; j++) {
+			result->rows_touched += scan_range(table, ids[j], ids[j]);
+		}
+		free(ids);
+		record_latency(result, start);
+	}
+}
+
+/* gets the OS to forget the DB file's pages -- the pager's own dirty
+pages are written first, since only clean pages can be dropped */
+void drop_os_cache(Table* table) {
+	Pager* pager = table->pager;
+	checkpoint(pager);
+	fsync(pager->file_descriptor);
+	posix_fadvise(pager->file_descriptor, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+/* reads the whole table num_full_scans times */
+void bench_full_scan(Table* table, BenchOptions* options, BenchResult* result) {
+	for (uint32_t i = 0; i < options->num_full_scans; i++) {
+		if (options->cold) {
+			drop_os_cache(table);
+		}
+		uint64_t start = get_time_ns();
+		result->rows_touched += scan_range(table, 0, UINT32_MAX);
+		record_latency(result, start);
+	}
+}
+
+/* visitor for the parallel scan workload: reads every row of the
+partition and counts them */
+void count_partition_rows(ParallelScan* scan, uint32_t partition) {
+	uint64_t* row_counts = scan->arg;
+	ScanPartition* range = &scan->partitions[partition];
+	row_counts[partition] = scan_range(scan->table, range->first_key, range->last_key);
+}
+
+/* reads the whole table num_full_scans times on the scan threads */
+void bench_parallel_scan(Table* table, BenchOptions* options, BenchResult* result) {
+	for (uint32_t i = 0; i < options->num_full_scans; i++) {
+		if (options->cold) {
+			drop_os_cache(table);
+		}
+		uint64_t start = get_time_ns();
+		ParallelScan* scan = plan_parallel_scan(table, 0, UINT32_MAX);
+		uint32_t num_partitions = scan->num_partitions;
+		uint64_t* row_counts = calloc(num_partitions, sizeof(uint64_t));
+		run_parallel_scan(scan, count_partition_rows, row_counts);
+		for (uint32_t partition = 0; partition < num_partitions; partition++) {
+			result->rows_touched += row_counts[partition];
+		}
+		free(row_counts);
+		record_latency(result, start);
+	}
+}
+
+/* mixes point lookups with inserts of new ids (write_percent of the
+operations are inserts) -- new ids come from a fixed permutation of
+the range right above the loaded rows, so they never collide */
+void bench_mixed(Table* table, BenchOptions* options, BenchResult* result) {
+	uint64_t random_state = options->seed;
+	uint32_t num_inserts = 0;
+	for (uint32_t i = 0; i < options->num_ops; i++) {
+		bool is_insert = (next_random(&random_state) % 100 < options->write_percent);
+		uint64_t start = get_time_ns();
+		if (is_insert) {
+			uint32_t offset = (uint64_t) num_inserts++ * 2654435761u % options->num_ops;
+			bench_insert_key(table, options->num_rows + 1 + offset);
+		} else {
+			uint32_t key = next_random(&random_state) % options->num_rows + 1;
+			result->rows_touched += scan_range(table, key, key);
+		}
+		record_latency(result, start);
+	}
+	result->rows_touched += num_inserts;
+}
+
+/*
+	reader thread of the concurrent workload: mostly point lookups, and
+	a range scan every tenth operation -- the ranges stay inside the
+	loaded rows, so the writer's new ids never change the answer
+
+	arg: pointer to the thread's BenchReader struct
+*/
+void* run_bench_reader(void* arg) {
+	BenchReader* reader = arg;
+	BenchOptions* options = reader->options;
+	uint32_t range_length = options->range_length < options->num_rows ? options->range_length : options->num_rows;
+	uint32_t num_starts = options->num_rows - range_length + 1;
+	for (uint32_t i = 0; i < reader->num_ops; i++) {
+		uint64_t start = get_time_ns();
+		uint64_t num_rows;
+		if (i % 10 == 9) {
+			uint32_t first_key = next_random(&reader->random_state) % num_starts + 1;
+			num_rows = scan_range(reader->table, first_key, first_key + range_length - 1);
+			reader->wrong_answers += (num_rows != range_length);
+		} else {
+			uint32_t key = next_random(&reader->random_state) % options->num_rows + 1;
+			num_rows = scan_range(reader->table, key, key);
+			reader->wrong_answers += (num_rows != 1);
+		}
+		reader->result.rows_touched += num_rows;
+		record_latency(&reader->result, start);
+	}
+	__atomic_store_n(&reader->done, true, __ATOMIC_RELEASE);
+	return NULL;
+}
+
+/* runs num_readers reader threads over the table while this thread
+inserts new ids above the loaded rows, until the readers are done */
+void bench_concurrent_read(Table* table, BenchOptions* options, BenchResult* result) {
+	uint32_t num_readers = options->num_readers > 0 ? options->num_readers : 1;
+	BenchReader* readers = malloc(num_readers * sizeof(BenchReader));
+	pthread_t* threads = malloc(num_readers * sizeof(pthread_t));
+	uint32_t num_ops = 0;
+	for (uint32_t i = 0; i < num_readers; i++) {
+		readers[i].table = table;
+		readers[i].options = options;
+		/* xorshift needs a nonzero seed */
+		readers[i].random_state = options->seed * (i + 1) + i;
+		readers[i].num_ops = options->num_ops / num_readers + (i < options->num_ops % num_readers);
+		readers[i].result.latencies = result->latencies + num_ops;
+		readers[i].result.num_ops = 0;
+		readers[i].result.rows_touched = 0;
+		readers[i].wrong_answers = 0;
+		readers[i].done = false;
+		num_ops += readers[i].num_ops;
+		pthread_create(&threads[i], NULL, run_bench_reader, &readers[i]);
+	}
+
+	/* the new ids come from the same permutation the mixed workload
+	uses, so the writer is spread over the table's right end */
+	uint32_t readers_done = 0;
+	uint32_t num_inserts = 0;
+	while (readers_done < num_readers && num_inserts < options->num_ops) {
+		uint32_t offset = (uint64_t) num_inserts++ * 2654435761u % options->num_ops;
+		bench_insert_key(table, options->num_rows + 1 + offset);
+		readers_done = 0;
+		for (uint32_t i = 0; i < num_readers; i++) {
+			readers_done += __atomic_load_n(&readers[i].done, __ATOMIC_ACQUIRE);
+		}
+	}
+
+	uint64_t wrong_answers = 0;
+	for (uint32_t i = 0; i < num_readers; i++) {
+		pthread_join(threads[i], NULL);
+		result->num_ops += readers[i].result.num_ops;
+		result->rows_touched += readers[i].result.rows_touched;
+		wrong_answers += readers[i].wrong_answers;
+	}
+	result->rows_touched += num_inserts;
+	free(readers);
+	free(threads);
+
+	if (wrong_answers > 0) {
+		printf("The readers got %llu wrong answers while the writer was busy\n",
+			(unsigned long long) wrong_answers);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/* bulk loads ids 1 to num_rows into an empty table */
+void populate_bench_table(Table* table, uint32_t num_rows) {
+	begin_write(table->pager);
+	BulkLoader* loader = begin_bulk_load(table, 1);
+	Row row;
+	for (uint32_t key = 1; key <= num_rows; key++) {
+		make_bench_row(&table->schema, key, &row);
+		bulk_load_row(loader, &row);
+	}
+	finish_bulk_load(loader);
+	end_write(table->pager);
+}
+
+/* qsort() comparator for latencies */
+int compare_latencies(const void* a, const void* b) {
+	uint64_t latency_a = *(uint64_t*)a;
+	uint64_t latency_b = *(uint64_t*)b;
+	return (latency_a > latency_b) - (latency_a < latency_b);
+}
+
+/* returns the given percentile (in thousandths, so 999 is p99.9) of
+the sorted latencies, in nanoseconds */
+uint64_t get_percentile(BenchResult* result, uint32_t per_mille) {
+	if (result->num_ops == 0) {
+		return 0;
+	}
+	return result->latencies[(uint64_t) (result->num_ops - 1) * per_mille / 1000];
+}
+
+/*
+	runs one workload against the DB file and prints what it measured
+
+	workload: pointer to the workload to run
+	options: pointer to the settings for the run
+*/
+void run_workload(BenchWorkload* workload, BenchOptions* options) {
+	if (workload->needs_empty_table) {
+		char wal_path[strlen(options->db_path) + strlen(WAL_SUFFIX) + 1];
+		sprintf(wal_path, "%s%s", options->db_path, WAL_SUFFIX);
+		unlink(options->db_path);
+		unlink(wal_path);
+	}
+
+	/* the read workloads reuse the rows an earlier workload left
+	behind if there are enough of them */
+	Database* database = open_database(options->db_path, &options->database_options);
+	Table* table = database->tables[0];
+	if (!workload->needs_empty_table && scan_range(table, options->num_rows, options->num_rows) == 0) {
+		close_database(database);
+		unlink(options->db_path);
+		database = open_database(options->db_path, &options->database_options);
+		table = database->tables[0];
+		populate_bench_table(table, options->num_rows);
+		checkpoint(table->pager);
+	}
+
+	BenchResult result;
+	uint32_t capacity = options->num_rows > options->num_ops ? options->num_rows : options->num_ops;
+	result.latencies = malloc((capacity + options->num_full_scans) * sizeof(uint64_t));
+	result.num_ops = 0;
+	result.rows_touched = 0;
+	Pager* pager = table->pager;
+	reset_stats(pager);
+
+	uint64_t start = get_time_ns();
+	workload->run(table, options, &result);
+	checkpoint(pager);
+	double seconds = (get_time_ns() - start) / 1e9;
+	Stats stats = pager->stats;
+	uint32_t page_size = pager->page_size;
+	uint32_t cache_frames = pager->num_frames;
+	const char* io_backend = pager->io->name;
+	close_database(database);
+
+	qsort(result.latencies, result.num_ops, sizeof(uint64_t), compare_latencies);
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	printf("{\"workload\": \"%s\", \"rows\": %u, \"ops\": %u, \"rows_touched\": %llu, "
+		"\"seconds\": %.6f, \"ops_per_sec\": %.1f, "
+		"\"p50_us\": %.3f, \"p99_us\": %.3f, \"p999_us\": %.3f, "
+		"\"cache_hits\": %llu, \"cache_misses\": %llu, "
+		"\"pages_read\": %llu, \"pages_read_ahead\": %llu, \"pages_written\": %llu, \"peak_rss_kb\": %ld, "
+		"\"page_size\": %u, \"key_search\": \"%s\", \"read_ahead\": %u, \"cold\": %s, \"io_backend\": \"%s\", "
+		"\"cache_frames\": %u, \"mmap\": %s, \"wal\": %s, \"concurrent\": %s, \"readers\": %u, \"scan_threads\": %u}\n",
+		workload->name, options->num_rows, result.num_ops, (unsigned long long) result.rows_touched,
+		seconds, seconds > 0 ? result.num_ops / seconds : 0,
+		get_percentile(&result, 500) / 1e3, get_percentile(&result, 990) / 1e3,
+		get_percentile(&result, 999) / 1e3,
+		(unsigned long long) stats.cache_hits, (unsigned long long) stats.cache_misses,
+		(unsigned long long) stats.pages_read, (unsigned long long) stats.pages_read_ahead,
+		(unsigned long long) stats.pages_written, usage.ru_maxrss,
+		page_size, get_key_search_kernel()->name, options->database_options.max_read_ahead,
+		options->cold ? "true" : "false", io_backend, cache_frames,
+		options->database_options.use_mmap ? "true" : "false",
+		options->database_options.use_wal ? "true" : "false",
+		options->database_options.concurrent ? "true" : "false", options->num_readers,
+		options->database_options.scan_threads);
+	fflush(stdout);
+	free(result.latencies);
+}
+
+/* */
+int main(int argc, char* argv[]) {
+	BenchOptions options;
+	options.db_path = "bench.db";
+	options.num_rows = 100000;
+	options.num_ops = 100000;
+	options.num_full_scans = 5;
+	options.range_length = 100;
+	options.write_percent = 20;
+	options.num_readers = 4;
+	options.seed = 42;
+	options.cold = false;
+	set_default_options(&options.database_options);
+	char* workload_names = NULL;
+
+	/* the DB flags are the same ones the command line takes */
+	for (int i = 1; i < argc; i++) {
+		bool has_value = (i + 1 < argc);
+		if (strcmp(argv[i], "--db") == 0 && has_value) {
+			options.db_path = argv[++i];
+		} else if (strcmp(argv[i], "--rows") == 0 && has_value) {
+			options.num_rows = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--ops") == 0 && has_value) {
+			options.num_ops = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--full-scans") == 0 && has_value) {
+			options.num_full_scans = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--range-length") == 0 && has_value) {
+			options.range_length = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--write-percent") == 0 && has_value) {
+			options.write_percent = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--readers") == 0 && has_value) {
+			options.num_readers = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+			options.seed = strtoull(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--cold") == 0) {
+			options.cold = true;
+		} else if (strcmp(argv[i], "--workloads") == 0 && has_value) {
+			workload_names = argv[++i];
+		} else if (!parse_database_option(argc, argv, &i, &options.database_options)) {
+			printf("Unknown option '%s'\n", argv[i]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* xorshift gets stuck on 0, and the workloads need rows to read */
+	if (options.seed == 0) {
+		options.seed = 42;
+	}
+	if (options.num_rows == 0 || options.range_length == 0) {
+		printf("The benchmark needs at least one row and one row per range\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* run every workload unless a comma-separated list was given --
+	the ones that need --concurrent are left out without it */
+	if (workload_names == NULL) {
+		for (uint32_t i = 0; i < NUM_BENCH_WORKLOADS; i++) {
+			if (!bench_workloads[i].needs_concurrent || options.database_options.concurrent) {
+				run_workload(&bench_workloads[i], &options);
+			}
+		}
+	} else {
+		for (char* name = strtok(workload_names, ","); name != NULL; name = strtok(NULL, ",")) {
+			uint32_t i = 0;
+			while (i < NUM_BENCH_WORKLOADS && strcmp(bench_workloads[i].name, name) != 0) {
+				i++;
+			}
+			if (i == NUM_BENCH_WORKLOADS) {
+				printf("Never heard of a workload called '%s'\n", name);
+				exit(EXIT_FAILURE);
+			}
+			if (bench_workloads[i].needs_concurrent && !options.database_options.concurrent) {
+				printf("The %s workload has nothing to share without --concurrent\n", name);
+				exit(EXIT_FAILURE);
+			}
+			run_workload(&bench_workloads[i], &options);
+		}
+	}
+
+	char wal_path[strlen(options.db_path) + strlen(WAL_SUFFIX) + 1];
+	sprintf(wal_path, "%s%s", options.db_path, WAL_SUFFIX);
+	unlink(options.db_path);
+	unlink(wal_path);
+	return 0;
+}
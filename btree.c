@@ -52,13 +52,15 @@ NodeType get_node_type(void* node) {
 	return (NodeType)value;
 }
 
-/* sets the node type, number of cells in the leaf node to 0, and 
-the next leaf cell to 0, which represents a leaf with no siblings */
-void initialize_leaf_node(void* node) { 
+/* sets the node type, number of cells in the leaf node to 0, the
+next leaf cell to 0, which represents a leaf with no siblings, and
+the cell heap to empty (it starts at the very end of the page) */
+void initialize_leaf_node(Pager* pager, void* node) { 
 	set_node_type(node, NODE_LEAF);
 	set_node_root(node, false);
 	*get_leaf_num_cells(node) = 0;
 	*get_next_leaf_of_given_leaf(node) = 0;
+	*get_leaf_cell_content_start(node) = pager->page_size;
 }
 
 /* returns pointer to the location of the given node's parent */
@@ -72,22 +74,174 @@ uint32_t* get_leaf_num_cells(void* node) {
 	return (char *) node + LEAF_NODE_NUM_CELLS_OFFSET;
 }
 
-/* returns a pointer to the location of the given cell_num
-in the leaf node  -- this is both a getter and a setter */
-void* get_leaf_cell(void* node, uint32_t cell_num) {
-	return (char *) node + LEAF_NODE_HEADER_SIZE + cell_num * LEAF_NODE_CELL_SIZE;
+/* returns a pointer to the offset where the leaf's cell heap starts
+-- everything from there to the end of the page is rows (or holes
+that removed rows left behind) */
+uint32_t* get_leaf_cell_content_start(void* node) {
+	return node + LEAF_NODE_CELL_CONTENT_START_OFFSET;
+}
+
+/* returns a pointer to the slot of the given cell_num in the leaf
+node  -- this is both a getter and a setter */
+void* get_leaf_slot(void* node, uint32_t cell_num) {
+	return (char *) node + LEAF_NODE_HEADER_SIZE + cell_num * LEAF_NODE_SLOT_SIZE;
 }
 
 /* returns a pointer to the key value of the given cell_num
 in the leaf node  -- this is both a getter and a setter */
 uint32_t* get_leaf_key(void* node, uint32_t cell_num) {
-	return get_leaf_cell(node, cell_num);
+	return get_leaf_slot(node, cell_num) + LEAF_NODE_KEY_OFFSET;
+}
+
+/* returns a pointer to where in the page the given cell's row sits */
+uint16_t* get_leaf_cell_offset(void* node, uint32_t cell_num) {
+	return get_leaf_slot(node, cell_num) + LEAF_NODE_CELL_OFFSET_OFFSET;
+}
+
+/* returns a pointer to the length of the given cell's row */
+uint16_t* get_leaf_cell_length(void* node, uint32_t cell_num) {
+	return get_leaf_slot(node, cell_num) + LEAF_NODE_CELL_LENGTH_OFFSET;
 }
 
 /* returns a pointer to the value of the given cell_num in the
-leaf node  -- this is both a getter and a setter */
+leaf node */
 void* get_leaf_value(void* node, uint32_t cell_num) {
-	return get_leaf_cell(node, cell_num) + LEAF_NODE_KEY_SIZE;
+	return (char *) node + *get_leaf_cell_offset(node, cell_num);
+}
+
+/* returns the number of bytes the leaf's cells take up, slots and
+rows both -- whatever's left of the space for cells is free,
+even if some of it is holes in the heap */
+uint32_t get_leaf_space_used(void* node) {
+	uint32_t num_cells = *get_leaf_num_cells(node);
+	uint32_t space_used = num_cells * LEAF_NODE_SLOT_SIZE;
+	for (uint32_t i = 0; i < num_cells; i++) {
+		space_used += *get_leaf_cell_length(node, i);
+	}
+	return space_used;
+}
+
+/* squeezes the holes out of the leaf's cell heap, so all of its free
+space sits in one gap between the slots and the heap */
+void compact_leaf(Pager* pager, void* node) {
+	char* copy = malloc(pager->page_size);
+	memcpy(copy, node, pager->page_size);
+
+	uint32_t num_cells = *get_leaf_num_cells(node);
+	uint32_t content_start = pager->page_size;
+	for (uint32_t i = 0; i < num_cells; i++) {
+		uint32_t length = *get_leaf_cell_length(node, i);
+		content_start -= length;
+		memcpy((char *) node + content_start, copy + *get_leaf_cell_offset(node, i), length);
+		*get_leaf_cell_offset(node, i) = content_start;
+	}
+	*get_leaf_cell_content_start(node) = content_start;
+	free(copy);
+}
+
+/*
+	adds a cell to a leaf, making room for its slot and its row
+
+	pager: pointer to the Pager the leaf belongs to
+	node: pointer to the leaf, which must have room for the cell
+	cell_num: where the cell goes -- later cells shift right by one
+	key: the cell's key
+	length: number of bytes the cell's row takes
+	returns: pointer to where the caller should put the row
+*/
+void* insert_leaf_cell(Pager* pager, void* node, uint32_t cell_num, uint32_t key, uint32_t length) {
+	uint32_t num_cells = *get_leaf_num_cells(node);
+
+	/* the free space might be scattered over holes in the heap */
+	uint32_t slots_end = LEAF_NODE_HEADER_SIZE + (num_cells + 1) * LEAF_NODE_SLOT_SIZE;
+	if (*get_leaf_cell_content_start(node) < slots_end + length) {
+		compact_leaf(pager, node);
+	}
+
+	uint32_t content_start = *get_leaf_cell_content_start(node) - length;
+	*get_leaf_cell_content_start(node) = content_start;
+
+	/* only the slots move to make room, never the rows */
+	memmove(get_leaf_slot(node, cell_num + 1), get_leaf_slot(node, cell_num),
+		(num_cells - cell_num) * LEAF_NODE_SLOT_SIZE);
+	*get_leaf_key(node, cell_num) = key;
+	*get_leaf_cell_offset(node, cell_num) = content_start;
+	*get_leaf_cell_length(node, cell_num) = length;
+	*get_leaf_num_cells(node) = num_cells + 1;
+	return (char *) node + content_start;
+}
+
+/* fills in a LeafCell for every cell of the leaf, pointing into the
+leaf itself, and returns how many there were */
+uint32_t collect_leaf_cells(void* node, LeafCell* cells) {
+	uint32_t num_cells = *get_leaf_num_cells(node);
+	for (uint32_t i = 0; i < num_cells; i++) {
+		cells[i].key = *get_leaf_key(node, i);
+		cells[i].length = *get_leaf_cell_length(node, i);
+		cells[i].value = get_leaf_value(node, i);
+	}
+	return num_cells;
+}
+
+/* 
+	replaces a leaf's cells with the given ones, leaving the rest of
+	its header alone
+
+	pager: pointer to the Pager the leaf belongs to
+	node: pointer to the leaf
+	cells: pointer to the cells, in key order -- they can't point into
+		the leaf itself, since it gets written over
+	num_cells: number of cells, which must all fit
+*/
+void write_leaf_cells(Pager* pager, void* node, LeafCell* cells, uint32_t num_cells) {
+	*get_leaf_num_cells(node) = 0;
+	*get_leaf_cell_content_start(node) = pager->page_size;
+	for (uint32_t i = 0; i < num_cells; i++) {
+		memcpy(insert_leaf_cell(pager, node, i, cells[i].key, cells[i].length), cells[i].value, cells[i].length);
+	}
+}
+
+/*
+	divides a run of cells into leaves holding about the same number
+	of bytes each, using as few leaves as it can
+
+	pager: pointer to the Pager the leaves belong to
+	cells: pointer to the cells, in key order
+	num_cells: number of cells
+	leaf_ends: set to one past the last cell of each leaf (needs room
+		for num_cells entries)
+	returns: number of leaves
+*/
+uint32_t plan_leaf_split(Pager* pager, LeafCell* cells, uint32_t num_cells, uint32_t* leaf_ends) {
+	uint32_t space_for_cells = pager->leaf_node_space_for_cells;
+	uint32_t space_left = 0;
+	for (uint32_t i = 0; i < num_cells; i++) {
+		space_left += LEAF_NODE_SLOT_SIZE + cells[i].length;
+	}
+	uint32_t target_leaves = (space_left + space_for_cells - 1) / space_for_cells;
+
+	uint32_t num_leaves = 0;
+	uint32_t cell = 0;
+	while (cell < num_cells) {
+		/* aim for an even share of what's left -- a cell goes in if
+		more than half of it fits under the share, and every leaf
+		gets at least one */
+		uint32_t leaves_left = (target_leaves > num_leaves + 1) ? target_leaves - num_leaves : 1;
+		uint32_t share = space_left / leaves_left;
+		uint32_t space = 0;
+		while (cell < num_cells) {
+			uint32_t cell_space = LEAF_NODE_SLOT_SIZE + cells[cell].length;
+			if (space > 0 && (space + cell_space > space_for_cells ||
+				space + cell_space / 2 > share)) {
+				break;
+			}
+			space += cell_space;
+			cell++;
+		}
+		space_left -= space;
+		leaf_ends[num_leaves++] = cell;
+	}
+	return num_leaves;
 }
 
 /*
@@ -99,6 +253,8 @@ void* get_leaf_value(void* node, uint32_t cell_num) {
 	returns: pointer to a Cursor that points to the key's location
 */
 Cursor* find_key_in_leaf(Table* table, uint32_t page_num, uint32_t key) {
+	/* the cursor takes over the latch its caller took on the leaf,
+	which close_cursor() releases */
 	void* node = get_page(table->pager, page_num);
 	uint32_t num_cells = *get_leaf_num_cells(node);
 
@@ -106,30 +262,18 @@ Cursor* find_key_in_leaf(Table* table, uint32_t page_num, uint32_t key) {
 	Cursor* cursor = malloc(sizeof(Cursor));
 	cursor->table = table;
 	cursor->page_num = page_num;
-
-	/* binary search leaf node for key value */
-	uint32_t min_index = 0;
-	uint32_t one_past_max_index = num_cells;
-	while (one_past_max_index != min_index) {
-		uint32_t index = (min_index + one_past_max_index) / 2;
-		uint32_t key_at_index = *get_leaf_key(node, index);
-		
-		/* if we've found the right key, we can stop searching */
-		if (key == key_at_index) {
-			cursor->cell_num = index;
-			return cursor;
-		}
-
-		/* otherwise we update where we're looking (left or right 
-		of the current index) */
-		if (key < key_at_index) {
-			one_past_max_index = index;
-		} else {
-			min_index = index + 1;
-		}
-	}
-
-	cursor->cell_num = min_index;
+	cursor->node = node;
+	cursor->end_of_table = false;
+	cursor->last_key = UINT32_MAX;
+	cursor->read_ahead = 0;
+	cursor->read_ahead_parent = 0;
+	cursor->read_ahead_end = 0;
+
+	/* the keys are every other word of the slot directory, so they
+	can be searched in place -- this lands on the key if it's there,
+	or on the cell it would be inserted at if it isn't */
+	cursor->cell_num = search_keys(get_leaf_key(node, 0), LEAF_NODE_SLOT_SIZE / LEAF_NODE_KEY_SIZE,
+		num_cells, key);
 	return cursor;
 }
 
@@ -148,105 +292,263 @@ uint32_t* get_next_leaf_of_given_leaf(void* node) {
 */
 void insert_cell_in_leaf(Cursor* cursor, uint32_t key, Row* value) {
 	
-	void* node = get_page(cursor->table->pager, cursor->page_num);
-	uint32_t num_cells = *get_leaf_num_cells(node);
+	Pager* pager = cursor->table->pager;
+	void* node = get_page(pager, cursor->page_num);
+	uint32_t length = get_serialized_row_size(value);
 
-	/* check if the node is full (12 cells) before trying to insert 
+	/* check if the node has room for the row before trying to insert
 	-- this is already checked in execute_insert(), so it's a bit 
 	redundant, but I guess we should err on the side of caution */	
-	if (num_cells >= LEAF_NODE_MAX_CELLS) {
-	    split_leaf_and_insert(cursor, key, value);
+	if (get_leaf_space_used(node) + LEAF_NODE_SLOT_SIZE + length > pager->leaf_node_space_for_cells) {
+	    split_leaf_and_insert(cursor, value);
 	    return;
 	}
 
-	/* make room for the new cell if necessary by moving existing 
-	cells to the right until we get to the cell we want to insert
-	to */
-	if (cursor->cell_num < num_cells) {
-		for (uint32_t i = num_cells; i > cursor->cell_num; i--) {
-			memcpy(get_leaf_cell(node, i), get_leaf_cell(node, i - 1),
-			LEAF_NODE_CELL_SIZE);
-		}
-	}
+	mark_page_dirty(pager, cursor->page_num);
 
-	/* insert the key/value pair */
-	*(get_leaf_num_cells(node)) += 1;
-	*(get_leaf_key(node, cursor->cell_num)) = key;
-	serialize_row(value, get_leaf_value(node, cursor->cell_num));
+	/* insert the key/value pair -- the cells after it shift right */
+	serialize_row(value, insert_leaf_cell(pager, node, cursor->cell_num, key, length));
 }
 
 /* 
 	splits a leaf node into two leaf nodes and inserts the new 
-	value into the appropriate node
+	value into the appropriate node -- with rows of any length the
+	halves are split by bytes rather than by cells, which is exactly
+	what inserting a one-row run does when it doesn't fit
 	
 	cursor: pointer to the correct node
-	key: key to insert
-	value: value to insert
+	value: value to insert, whose id is the key
 */
-void split_leaf_and_insert(Cursor* cursor, uint32_t key, Row* value) {
-  	void* destination_node;
-
-	/* get the old leaf node and initialize the new leaf node*/
-	void* old_node = get_page(cursor->table->pager, cursor->page_num);
-	uint32_t old_max = get_max_key_in_node(old_node);
-	uint32_t new_page_num = get_unused_page_num(cursor->table->pager);
-	void* new_node = get_page(cursor->table->pager, new_page_num);
-	initialize_leaf_node(new_node);
-	/* the old leaf's parent becomes the new leaf's parent */
-	*get_node_parent(new_node) = *get_node_parent(old_node);
-	/* the old leaf's sibling becomes the new leaf's sibling */
-	*get_next_leaf_of_given_leaf(new_node) = *get_next_leaf_of_given_leaf(old_node);
-	*get_next_leaf_of_given_leaf(old_node) = new_page_num;
-
-	/* determine which cells should stay in the old leaf node 
-	(half) and which cells should be moved to the new leaf node */
-	for (int32_t i = LEAF_NODE_MAX_CELLS; i >= 0; i--) {
-		if (i >= LEAF_NODE_LEFT_SPLIT_COUNT) {
-			destination_node = new_node;
+void split_leaf_and_insert(Cursor* cursor, Row* value) {
+	insert_rows_in_leaf(cursor->table, cursor->page_num, value, 1);
+}
+
+/* 
+	checks whether any of a sorted run of rows is already in a leaf by
+	walking the two in step
+
+	node: pointer to the leaf
+	rows: pointer to the rows, sorted by id
+	num_rows: number of rows to check
+	returns: true if one of the ids is already in the leaf
+*/
+bool leaf_has_any_key(void* node, Row* rows, uint32_t num_rows) {
+	uint32_t num_cells = *get_leaf_num_cells(node);
+	uint32_t cell = 0;
+	uint32_t row = 0;
+	while (cell < num_cells && row < num_rows) {
+		uint32_t key = *get_leaf_key(node, cell);
+		if (key == rows[row].id) {
+			return true;
+		} else if (key < rows[row].id) {
+			cell++;
 		} else {
-			destination_node = old_node;
+			row++;
 		}
+	}
+	return false;
+}
+
+/* 
+	checks whether a run of rows fits in a leaf without splitting it
+
+	pager: pointer to a populated Pager struct
+	node: pointer to the leaf
+	rows: pointer to the rows
+	num_rows: number of rows
+	returns: true if the rows fit
+*/
+bool rows_fit_in_leaf(Pager* pager, void* node, Row* rows, uint32_t num_rows) {
+	uint32_t space_needed = num_rows * LEAF_NODE_SLOT_SIZE;
+	for (uint32_t row = 0; row < num_rows; row++) {
+		space_needed += get_serialized_row_size(&rows[row]);
+	}
+	return get_leaf_space_used(node) + space_needed <= pager->leaf_node_space_for_cells;
+}
+
+/* 
+	merges a sorted run of rows into a leaf in one pass -- if they don't
+	all fit, the leaf is split once into as many evenly filled leaves as
+	it takes, instead of once per row
 
-		uint32_t index_within_node = i % LEAF_NODE_LEFT_SPLIT_COUNT;
-		void* destination = get_leaf_cell(destination_node, index_within_node);
+	table: pointer to a Table struct for a given DB file
+	page_num: number of the leaf the rows belong in
+	rows: pointer to the rows, sorted by id, none already in the table
+	num_rows: number of rows to insert
+*/
+void insert_rows_in_leaf(Table* table, uint32_t page_num, Row* rows, uint32_t num_rows) {
+	Pager* pager = table->pager;
+	void* node = pin_page(pager, page_num);
+	mark_page_dirty(pager, page_num);
+	uint32_t num_cells = *get_leaf_num_cells(node);
+	uint32_t total_cells = num_cells + num_rows;
+
+	uint32_t rows_length = 0;
+	for (uint32_t row = 0; row < num_rows; row++) {
+		rows_length += get_serialized_row_size(&rows[row]);
+	}
+
+	/* if everything fits, the rows go into the heap in one go and the
+	slots are merged from the back so each existing slot moves at most
+	once */
+	if (rows_fit_in_leaf(pager, node, rows, num_rows)) {
+		uint32_t slots_end = LEAF_NODE_HEADER_SIZE + total_cells * LEAF_NODE_SLOT_SIZE;
+		if (*get_leaf_cell_content_start(node) < slots_end + rows_length) {
+			compact_leaf(pager, node);
+		}
+		uint32_t content_start = *get_leaf_cell_content_start(node) - rows_length;
+		*get_leaf_cell_content_start(node) = content_start;
+
+		int32_t cell = num_cells - 1;
+		int32_t row = num_rows - 1;
+		for (int32_t destination = total_cells - 1; destination >= 0; destination--) {
+			if (row < 0 || (cell >= 0 && *get_leaf_key(node, cell) > rows[row].id)) {
+				memmove(get_leaf_slot(node, destination), get_leaf_slot(node, cell), LEAF_NODE_SLOT_SIZE);
+				cell--;
+			} else {
+				*get_leaf_key(node, destination) = rows[row].id;
+				*get_leaf_cell_offset(node, destination) = content_start;
+				*get_leaf_cell_length(node, destination) = serialize_row(&rows[row], (char *) node + content_start);
+				content_start += *get_leaf_cell_length(node, destination);
+				row--;
+			}
+		}
+		*get_leaf_num_cells(node) = total_cells;
+		unpin_page(pager, page_num);
+		return;
+	}
 
-		/* move the cell to the appropriate leaf node */
-		if (i == cursor->cell_num) {
-			serialize_row(value, get_leaf_value(destination_node, index_within_node));
-			*get_leaf_key(destination_node, index_within_node) = key;
-		} else if (i > cursor->cell_num) {
-			memcpy(destination, get_leaf_cell(old_node, i - 1), LEAF_NODE_CELL_SIZE);
+	/* otherwise merge everything into a list of cells first -- the
+	leaf is copied out since it's about to be written over, and the
+	rows are serialized into a scratch buffer */
+	char* old_node = malloc(pager->page_size);
+	memcpy(old_node, node, pager->page_size);
+	char* row_values = malloc(rows_length);
+	LeafCell* cells = malloc(total_cells * sizeof(LeafCell));
+	uint32_t cell = 0;
+	uint32_t row = 0;
+	char* next_value = row_values;
+	for (uint32_t i = 0; i < total_cells; i++) {
+		if (row == num_rows || (cell < num_cells && *get_leaf_key(old_node, cell) < rows[row].id)) {
+			cells[i].key = *get_leaf_key(old_node, cell);
+			cells[i].length = *get_leaf_cell_length(old_node, cell);
+			cells[i].value = get_leaf_value(old_node, cell);
+			cell++;
 		} else {
-			memcpy(destination, get_leaf_cell(old_node, i), LEAF_NODE_CELL_SIZE);
+			cells[i].key = rows[row].id;
+			cells[i].length = serialize_row(&rows[row], next_value);
+			cells[i].value = next_value;
+			next_value += cells[i].length;
+			row++;
 		}
 	}
-	
-	/* update the cell count on both leaf nodes */
-	*(get_leaf_num_cells(old_node)) = LEAF_NODE_LEFT_SPLIT_COUNT;
-	*(get_leaf_num_cells(new_node)) = LEAF_NODE_RIGHT_SPLIT_COUNT;
 
-	/* if the node we're splitting is the root node, create a new
-	root node -- otherwise, update the parent to include the new
-	internal node */
-	if (is_node_root(old_node)) {
-		return create_new_root(cursor->table, new_page_num);
-	} else {
-		uint32_t parent_page_num = *get_node_parent(old_node);
-		uint32_t new_max = get_max_key_in_node(old_node);
-		void* parent = get_page(cursor->table->pager, parent_page_num);
+	unpin_page(pager, page_num);
+	split_leaf_cells(table, page_num, cells, total_cells);
+	free(cells);
+	free(row_values);
+	free(old_node);
+}
 
-		update_internal_node_key(parent, old_max, new_max);
-		insert_child_into_internal_node(cursor->table, parent_page_num, new_page_num);
-		return;
+/* 
+	writes a run of cells over a leaf they don't fit in, spreading
+	them evenly (by bytes) over the leaf and as many new leaves to its
+	right as it takes, and hooks the new leaves into the tree
+
+	table: pointer to a Table struct for a given DB file
+	page_num: number of the leaf, whose key range the cells fall in
+	cells: pointer to the leaf's new cells, in key order -- they can't
+		point into the leaf itself, since it gets written over
+	num_cells: number of cells
+*/
+void split_leaf_cells(Table* table, uint32_t page_num, LeafCell* cells, uint32_t num_cells) {
+	Pager* pager = table->pager;
+	void* node = pin_page(pager, page_num);
+	mark_page_dirty(pager, page_num);
+
+	/* grab what the parent needs to hear about before the leaf changes */
+	bool splitting_root = is_node_root(node);
+	uint32_t last_next_leaf = *get_next_leaf_of_given_leaf(node);
+
+	/* spread the cells evenly (by bytes) over the old leaf and the new
+	leaves to its right */
+	uint32_t* leaf_ends = malloc(num_cells * sizeof(uint32_t));
+	uint32_t num_leaves = plan_leaf_split(pager, cells, num_cells, leaf_ends);
+	pager->stats.leaf_splits += num_leaves - 1;
+	uint32_t* leaf_page_nums = malloc(num_leaves * sizeof(uint32_t));
+	leaf_page_nums[0] = page_num;
+	uint32_t next_cell = 0;
+	for (uint32_t leaf = 0; leaf < num_leaves; leaf++) {
+		void* leaf_node = node;
+		if (leaf > 0) {
+			leaf_page_nums[leaf] = get_unused_page_num(pager);
+			leaf_node = pin_page(pager, leaf_page_nums[leaf]);
+			mark_page_dirty(pager, leaf_page_nums[leaf]);
+			initialize_leaf_node(pager, leaf_node);
+			*get_node_parent(leaf_node) = *get_node_parent(node);
+			*get_next_leaf_of_given_leaf(leaf_node) = last_next_leaf;
+
+			/* the previous leaf was let go once it was written, so it
+			may have been evicted since */
+			void* previous_leaf = get_page(pager, leaf_page_nums[leaf - 1]);
+			mark_page_dirty(pager, leaf_page_nums[leaf - 1]);
+			*get_next_leaf_of_given_leaf(previous_leaf) = leaf_page_nums[leaf];
+		}
+
+		write_leaf_cells(pager, leaf_node, cells + next_cell, leaf_ends[leaf] - next_cell);
+		next_cell = leaf_ends[leaf];
+
+		/* only the old leaf stays pinned, so a split into thousands of
+		leaves doesn't need thousands of frames */
+		if (leaf > 0) {
+			unpin_page(pager, leaf_page_nums[leaf]);
+		}
+	}
+	free(leaf_ends);
+
+	uint32_t new_max = get_max_key_in_node(pager, node);
+	uint32_t parent_page_num = *get_node_parent(node);
+	unpin_page(pager, page_num);
+
+	/* hook the new leaves into the tree left to right, the same way a
+	single split does */
+	uint32_t first_new_leaf = 1;
+	if (splitting_root) {
+		create_new_root(table, leaf_page_nums[1]);
+		parent_page_num = table->root_page_num;
+		first_new_leaf = 2;
+	} else {
+		void* parent = get_page(pager, parent_page_num);
+		mark_page_dirty(pager, parent_page_num);
+		update_internal_node_key(parent, page_num, new_max);
 	}
+	for (uint32_t leaf = first_new_leaf; leaf < num_leaves; leaf++) {
+		/* a split further up may have moved the previous leaf */
+		void* previous_leaf = get_page(pager, leaf_page_nums[leaf - 1]);
+		parent_page_num = *get_node_parent(previous_leaf);
+		void* leaf_node = get_page(pager, leaf_page_nums[leaf]);
+		mark_page_dirty(pager, leaf_page_nums[leaf]);
+		*get_node_parent(leaf_node) = parent_page_num;
+		uint32_t leaf_max = *get_leaf_key(leaf_node, *get_leaf_num_cells(leaf_node) - 1);
+		insert_child_into_internal_node(table, parent_page_num, leaf_page_nums[leaf - 1], leaf_page_nums[leaf]);
+
+		/* a new leaf can land as the right child of a node that isn't
+		itself on the right edge, which raises that node's max */
+		update_max_key_in_ancestors(table, leaf_page_nums[leaf], leaf_max);
+	}
+
+	free(leaf_page_nums);
 }
 
 /* sets the number of keys in the internal node to 0 and sets the 
-node type */
-void initialize_internal_node(void* node) {
+node type -- the child pointers start after room for as many keys
+as the page size allows */
+void initialize_internal_node(Pager* pager, void* node) {
 	set_node_type(node, NODE_INTERNAL);
 	set_node_root(node, false);
 	*get_internal_node_num_keys(node) = 0;
+	*get_internal_node_children_offset(node) = INTERNAL_NODE_KEYS_OFFSET
+		+ pager->internal_node_max_cells * INTERNAL_NODE_KEY_SIZE;
 }
 
 /* returns a pointer to the location of the num_keys cell
@@ -261,10 +563,16 @@ uint32_t* get_internal_node_right_child(void* node) {
 	return node + INTERNAL_NODE_RIGHT_CHILD_OFFSET;
 }
 
-/* returns a pointer to the location of the given cell_num in the
-given internal node */
+/* returns a pointer to the offset of the child pointer array in the
+internal node */
+uint32_t* get_internal_node_children_offset(void* node) {
+	return node + INTERNAL_NODE_CHILDREN_OFFSET_OFFSET;
+}
+
+/* returns a pointer to the child pointer of the given cell_num in the
+given internal node (the key of the cell is in the key array) */
 uint32_t* get_internal_node_cell(void* node, uint32_t cell_num) {
-	return node + INTERNAL_NODE_HEADER_SIZE + cell_num * INTERNAL_NODE_CELL_SIZE;
+	return node + *get_internal_node_children_offset(node) + cell_num * INTERNAL_NODE_CHILD_SIZE;
 }
 
 /* returns a pointer to the location of the given child_num
@@ -281,72 +589,109 @@ uint32_t* get_internal_node_child(void* node, uint32_t child_num) {
 	}
 }
 
-/* returns a pointer to the location of the given key's cell
+/* returns a pointer to the location of the given key
 in the given internal node */
 uint32_t* get_internal_node_key(void* node, uint32_t key_num) {
-	return (void*) get_internal_node_cell(node, key_num) + INTERNAL_NODE_CHILD_SIZE;
+	return node + INTERNAL_NODE_KEYS_OFFSET + key_num * INTERNAL_NODE_KEY_SIZE;
 }
 
-/* finds old_key in the given node and replaces it with new_key */
-void update_internal_node_key(void* node, uint32_t old_key, uint32_t new_key) {
-	uint32_t old_child_index = find_internal_node_child(node, old_key);
-	*get_internal_node_key(node, old_child_index) = new_key;
- }
+/* 
+	moves a run of cells (keys and their child pointers) between two
+	internal nodes, or within one -- the runs may overlap
+
+	destination_node: pointer to the node the cells move to
+	destination: index of the first cell in destination_node
+	source_node: pointer to the node the cells come from
+	source: index of the first cell in source_node
+	num_cells: number of cells to move
+*/
+void move_internal_node_cells(void* destination_node, uint32_t destination, void* source_node, uint32_t source, uint32_t num_cells) {
+	memmove(get_internal_node_key(destination_node, destination), get_internal_node_key(source_node, source),
+		num_cells * INTERNAL_NODE_KEY_SIZE);
+	memmove(get_internal_node_cell(destination_node, destination), get_internal_node_cell(source_node, source),
+		num_cells * INTERNAL_NODE_CHILD_SIZE);
+}
+
+/* finds the given child in the node and gives it new_key -- by page
+rather than by key, since an index's keys can repeat */
+void update_internal_node_key(void* node, uint32_t child_page_num, uint32_t new_key) {
+	uint32_t child_index = find_child_index(node, child_page_num);
+	/* the right child doesn't have a key of its own to update */
+	if (child_index < *get_internal_node_num_keys(node)) {
+		*get_internal_node_key(node, child_index) = new_key;
+	}
+}
 
 /* 
-	inserts a child/key pair into the given parent node
+	inserts a child/key pair into the given parent node, right after
+	the sibling the child was split off from
 
 	table: pointer to a Table struct for a given DB file
 	parent_page_num: location of the parent node
+	left_page_num: location of the sibling the child goes after
 	child_page_num: location of the child node
 */
-void insert_child_into_internal_node(Table* table, uint32_t parent_page_num, uint32_t child_page_num) {
-
-	/* get the information needed for the insertion */
-	void* parent = get_page(table->pager, parent_page_num);
-	void* child = get_page(table->pager, child_page_num);
-	uint32_t child_max_key = get_max_key_in_node(child);
-	uint32_t index = find_internal_node_child(parent, child_max_key);
-
-	/* update the cell that keeps track of the number of key in
-	the parent node */
-	uint32_t original_num_keys = *get_internal_node_num_keys(parent);
-	*get_internal_node_num_keys(parent) = original_num_keys + 1;
+void insert_child_into_internal_node(Table* table, uint32_t parent_page_num, uint32_t left_page_num, uint32_t child_page_num) {
+	Pager* pager = table->pager;
 
 	/* if the internal node is at max capacity, split it */
-	if (original_num_keys >= INTERNAL_NODE_MAX_CELLS) {
-		split_internal_node_and_insert_child(table, parent_page_num, child_page_num);
+	void* parent = pin_page(pager, parent_page_num);
+	uint32_t num_keys = *get_internal_node_num_keys(parent);
+	if (num_keys >= pager->internal_node_max_cells) {
+		unpin_page(pager, parent_page_num);
+		split_internal_node_and_insert_child(table, parent_page_num, left_page_num, child_page_num);
 		return;
 	}
 
-	/* get the right child so we can compare its key to the 
-	one we're inserting -- this handles the case where the
-	new key we're inserting will be the highest key */
-	uint32_t right_child_page_num = *get_internal_node_right_child(parent);
-	void* right_child = get_page(table->pager, right_child_page_num);
-
-	/* if the new key will be the biggest, the new child will 
-	replace the current right child as the rightmost child -- so
-	we can just add it to the end of the current children in the 
-	internal node */
-	if (child_max_key > get_max_key_in_node(right_child)) {
-		*get_internal_node_child(parent, original_num_keys) = right_child_page_num;
-		*get_internal_node_key(parent, original_num_keys) =
-		get_max_key_in_node(right_child);
+	/* get the information needed for the insertion, and point the
+	child at its new parent */
+	void* child = pin_page(pager, child_page_num);
+	uint32_t child_max_key = get_max_key_in_node(pager, child);
+	mark_page_dirty(pager, child_page_num);
+	*get_node_parent(child) = parent_page_num;
+	unpin_page(pager, child_page_num);
+	mark_page_dirty(pager, parent_page_num);
+
+	/* if the sibling is the right child, the new child will
+	replace it as the rightmost child -- so the sibling can just be
+	added to the end of the current children in the internal node */
+	uint32_t index = find_child_index(parent, left_page_num);
+	if (index == num_keys) {
+		*get_internal_node_cell(parent, num_keys) = left_page_num;
+		*get_internal_node_key(parent, num_keys) = get_max_key_in_node(pager, get_page(pager, left_page_num));
 		*get_internal_node_right_child(parent) = child_page_num;
 	} 
-	/* if the new key will not be the biggest, we need to move 
-	some children back to make room for the new child; so we shift
-	each of the cells after the insertion index back one spot */
+	/* otherwise we need to move some children back to make room for
+	the new child; so we shift each of the cells after the sibling
+	back one spot */
 	else {
-		for (uint32_t i = original_num_keys; i > index; i--) {
-			void* destination = get_internal_node_cell(parent, i);
-			void* source = get_internal_node_cell(parent, i - 1);
-			memcpy(destination, source, INTERNAL_NODE_CELL_SIZE);
-		}
-		*get_internal_node_child(parent, index) = child_page_num;
-		*get_internal_node_key(parent, index) = child_max_key;
+		move_internal_node_cells(parent, index + 2, parent, index + 1, num_keys - index - 1);
+		*get_internal_node_cell(parent, index + 1) = child_page_num;
+		*get_internal_node_key(parent, index + 1) = child_max_key;
+	}
+
+	/* update the cell that keeps track of the number of keys in
+	the parent node */
+	*get_internal_node_num_keys(parent) = num_keys + 1;
+	unpin_page(pager, parent_page_num);
+}
+
+/* 
+	fills an internal node with the given children -- every child but
+	the last gets a cell with its max key, the last is the right child
+
+	node: pointer to the internal node
+	children: page numbers of the children, in key order
+	keys: max key of each child
+	num_children: number of children
+*/
+void set_internal_node_children(void* node, uint32_t* children, uint32_t* keys, uint32_t num_children) {
+	*get_internal_node_num_keys(node) = num_children - 1;
+	for (uint32_t i = 0; i < num_children - 1; i++) {
+		*get_internal_node_cell(node, i) = children[i];
+		*get_internal_node_key(node, i) = keys[i];
 	}
+	*get_internal_node_right_child(node) = children[num_children - 1];
 }
 
 /* 
@@ -355,60 +700,79 @@ void insert_child_into_internal_node(Table* table, uint32_t parent_page_num, uin
 	
 	table: pointer to a Table struct for a given DB file
 	parent_page_num: location of the node we're splitting
+	left_page_num: location of the sibling the child goes after
 	child_page_num: location of the child node
 */
-void split_internal_node_and_insert_child(Table* table, uint32_t parent_page_num, uint32_t child_page_num) {
-
-  	void* destination_node;
-	void* parent_node_to_split = get_page(table->pager, parent_page_num);
-	void* child_node = get_page(table->pager, child_page_num);
-	uint32_t old_max = get_max_key_in_node(parent_node_to_split);
-	uint32_t child_node_to_insert_max_key = get_max_key_in_node(child_node);
-
-	/* initialize the new node */
-	uint32_t new_page_num = get_unused_page_num(table->pager);
-	void* new_node = get_page(table->pager, new_page_num);
-	initialize_internal_node(new_node);
+void split_internal_node_and_insert_child(Table* table, uint32_t parent_page_num, uint32_t left_page_num, uint32_t child_page_num) {
+	Pager* pager = table->pager;
+	pager->stats.internal_splits++;
+
+	/* the node being split stays pinned until its children have been
+	divided up */
+	void* old_node = pin_page(pager, parent_page_num);
+	uint32_t old_max = get_max_key_in_node(pager, old_node);
+	uint32_t child_max_key = get_max_key_in_node(pager, get_page(pager, child_page_num));
+
+	/* line up all of the children (the old ones plus the new one,
+	right after its sibling) in key order; the old right child's key
+	is the old node's max */
+	uint32_t num_keys = *get_internal_node_num_keys(old_node);
+	uint32_t* children = malloc((pager->internal_node_max_cells + 2) * sizeof(uint32_t));
+	uint32_t* keys = malloc((pager->internal_node_max_cells + 2) * sizeof(uint32_t));
+	uint32_t num_children = 0;
+	for (uint32_t i = 0; i <= num_keys; i++) {
+		children[num_children] = *get_internal_node_child(old_node, i);
+		keys[num_children++] = (i < num_keys) ? *get_internal_node_key(old_node, i) : old_max;
+		if (children[num_children - 1] == left_page_num) {
+			children[num_children] = child_page_num;
+			keys[num_children++] = child_max_key;
+		}
+	}
+
+	/* initialize the new node, which takes the right half */
+	uint32_t new_page_num = get_unused_page_num(pager);
+	void* new_node = pin_page(pager, new_page_num);
+	mark_page_dirty(pager, parent_page_num);
+	mark_page_dirty(pager, new_page_num);
+	initialize_internal_node(pager, new_node);
 	/* the old node's parent becomes the new node's parent */
-	*get_node_parent(new_node) = *get_node_parent(parent_node_to_split);
+	*get_node_parent(new_node) = *get_node_parent(old_node);
 
-	/* determine which child nodes should stay in the old node 
-	(half) and which should be moved to the new internal node */
-	for (int32_t i = INTERNAL_NODE_MAX_CELLS; i >= 0; i--) {
-		if (i >= INTERNAL_NODE_LEFT_SPLIT_COUNT) {
-			destination_node = new_node;
-		} else {
-			destination_node = parent_node_to_split;
+	uint32_t left_count = num_children - num_children / 2;
+	set_internal_node_children(old_node, children, keys, left_count);
+	set_internal_node_children(new_node, children + left_count, keys + left_count,
+		num_children - left_count);
+
+	/* every child that moved (and the new child) needs to know its
+	new parent */
+	for (uint32_t i = 0; i < num_children; i++) {
+		uint32_t new_parent = (i < left_count) ? parent_page_num : new_page_num;
+		if (new_parent != parent_page_num || children[i] == child_page_num) {
+			void* child = get_page(pager, children[i]);
+			mark_page_dirty(pager, children[i]);
+			*get_node_parent(child) = new_parent;
 		}
-
-		uint32_t index_within_node = i % INTERNAL_NODE_LEFT_SPLIT_COUNT;
-		void* destination = get_internal_node_cell(destination_node, index_within_node);
-		memcpy(destination, get_internal_node_cell(parent_node_to_split, i), INTERNAL_NODE_CELL_SIZE);
 	}
 
-	/* determine which node to insert the new child into */
-	if (get_max_key_in_node(parent_node_to_split) > child_node_to_insert_max_key) {
-		insert_child_into_internal_node(table, parent_page_num, child_page_num);
-	} else {
-		insert_child_into_internal_node(table, new_page_num, child_page_num);
-	}
-	
-	/* update the key count on both internal nodes */
-	*(get_internal_node_num_keys(parent_node_to_split)) = INTERNAL_NODE_LEFT_SPLIT_COUNT;
-	*(get_internal_node_num_keys(new_node)) = INTERNAL_NODE_RIGHT_SPLIT_COUNT;
+	/* grab what we still need from the split node before unpinning */
+	bool splitting_root = is_node_root(old_node);
+	uint32_t grandparent_page_num = *get_node_parent(old_node);
+	uint32_t new_max = keys[left_count - 1];
+	unpin_page(pager, new_page_num);
+	unpin_page(pager, parent_page_num);
+	free(children);
+	free(keys);
 
 	/* if the node we're splitting is the root node, create a new
 	root node -- otherwise, update the parent to include the new
 	internal node */
-	if (is_node_root(parent_node_to_split)) {
-		return create_new_root(table, new_page_num);
+	if (splitting_root) {
+		create_new_root(table, new_page_num);
 	} else {
-		uint32_t parent_page_num = *get_node_parent(parent_node_to_split);
-		uint32_t new_max = get_max_key_in_node(parent_node_to_split);
-		void* parent = get_page(table->pager, parent_page_num);
-		update_internal_node_key(parent, old_max, new_max);
-		insert_child_into_internal_node(table, parent_page_num, new_page_num);
-		return;
+		void* grandparent = get_page(pager, grandparent_page_num);
+		mark_page_dirty(pager, grandparent_page_num);
+		update_internal_node_key(grandparent, parent_page_num, new_max);
+		insert_child_into_internal_node(table, grandparent_page_num, parent_page_num, new_page_num);
 	}
 }
 
@@ -434,23 +798,40 @@ bool is_node_root(void* node) {
 	returns: pointer to a Cursor that points to the key's location
 */
 void create_new_root(Table* table, uint32_t right_child_page_num) {
+	table->pager->stats.root_splits++;
 
-	/* get the new root node's children */
-	void* right_child = get_page(table->pager, right_child_page_num);
+	/* get the new root node's children; all three nodes stay pinned
+	while they're rewired */
+	void* right_child = pin_page(table->pager, right_child_page_num);
 	uint32_t left_child_page_num = get_unused_page_num(table->pager);
-	void* left_child = get_page(table->pager, left_child_page_num);
+	void* left_child = pin_page(table->pager, left_child_page_num);
 	
 	/* copy the old root to the left child */
-	void* root = get_page(table->pager, table->root_page_num);
-	memcpy(left_child, root, PAGE_SIZE);
+	void* root = pin_page(table->pager, table->root_page_num);
+	mark_page_dirty(table->pager, right_child_page_num);
+	mark_page_dirty(table->pager, left_child_page_num);
+	mark_page_dirty(table->pager, table->root_page_num);
+	memcpy(left_child, root, table->pager->page_size);
 	set_node_root(left_child, false);
 
+	/* if the old root was an internal node, its children now live
+	under the left child */
+	if (get_node_type(left_child) == NODE_INTERNAL) {
+		uint32_t num_keys = *get_internal_node_num_keys(left_child);
+		for (uint32_t i = 0; i <= num_keys; i++) {
+			uint32_t grandchild_page_num = *get_internal_node_child(left_child, i);
+			void* grandchild = get_page(table->pager, grandchild_page_num);
+			mark_page_dirty(table->pager, grandchild_page_num);
+			*get_node_parent(grandchild) = left_child_page_num;
+		}
+	}
+
 	/* initialize the new root node with its two children */
-	initialize_internal_node(root);
+	initialize_internal_node(table->pager, root);
 	set_node_root(root, true);
 	*get_internal_node_num_keys(root) = 1;
 	*get_internal_node_child(root, 0) = left_child_page_num;
-	uint32_t left_child_max_key = get_max_key_in_node(left_child);
+	uint32_t left_child_max_key = get_max_key_in_node(table->pager, left_child);
 	*get_internal_node_key(root, 0) = left_child_max_key;
 	*get_internal_node_right_child(root) = right_child_page_num;
 	
@@ -458,29 +839,384 @@ void create_new_root(Table* table, uint32_t right_child_page_num) {
 	*get_node_parent(left_child) = table->root_page_num;
 	*get_node_parent(right_child) = table->root_page_num;
 
+	unpin_page(table->pager, table->root_page_num);
+	unpin_page(table->pager, left_child_page_num);
+	unpin_page(table->pager, right_child_page_num);
 }
 
-/* returns the max key in the given node (the right key for
-internal nodes and the key at the max index for leaf nodes) */
-uint32_t get_max_key_in_node(void* node) {
-	switch (get_node_type(node)) {
-		case NODE_INTERNAL:
-			return *get_internal_node_key(node, *get_internal_node_num_keys(node) - 1);
-		case NODE_LEAF:
-			return *get_leaf_key(node, *get_leaf_num_cells(node) - 1);
+/* returns the position of the given child among the node's children
+(the right child comes last, at num_keys) */
+uint32_t find_child_index(void* node, uint32_t child_page_num) {
+	uint32_t num_keys = *get_internal_node_num_keys(node);
+	for (uint32_t i = 0; i < num_keys; i++) {
+		if (*get_internal_node_cell(node, i) == child_page_num) {
+			return i;
+		}
+	}
+	return num_keys;
+}
+
+/* 
+	records a node's new max key in the tree above it -- the key lives
+	in the first ancestor the node isn't the right child of (if there's
+	no such ancestor, the node is on the right edge and has no key)
+
+	table: pointer to a Table struct for a given DB file
+	page_num: number of the node whose max changed
+	max_key: the node's new max key
+*/
+void update_max_key_in_ancestors(Table* table, uint32_t page_num, uint32_t max_key) {
+	Pager* pager = table->pager;
+	void* node = get_page(pager, page_num);
+	while (!is_node_root(node)) {
+		uint32_t parent_page_num = *get_node_parent(node);
+		void* parent = get_page(pager, parent_page_num);
+		uint32_t index = find_child_index(parent, page_num);
+		if (index < *get_internal_node_num_keys(parent)) {
+			mark_page_dirty(pager, parent_page_num);
+			*get_internal_node_key(parent, index) = max_key;
+			return;
+		}
+		page_num = parent_page_num;
+		node = parent;
+	}
+}
+
+/* 
+	removes a child whose contents were just merged into the child to
+	its left, then rebalances the parent if that leaves it too empty
+
+	table: pointer to a Table struct for a given DB file
+	parent_page_num: location of the parent node
+	child_index: position of the removed child (never 0)
+*/
+void remove_child_from_internal_node(Table* table, uint32_t parent_page_num, uint32_t child_index) {
+	Pager* pager = table->pager;
+	void* parent = pin_page(pager, parent_page_num);
+	mark_page_dirty(pager, parent_page_num);
+	uint32_t num_keys = *get_internal_node_num_keys(parent);
+
+	/* if the right child goes, its left neighbour becomes the right
+	child; otherwise the left neighbour takes over the removed child's
+	key (it holds that child's keys now) */
+	if (child_index == num_keys) {
+		*get_internal_node_right_child(parent) = *get_internal_node_cell(parent, num_keys - 1);
+	} else {
+		*get_internal_node_key(parent, child_index - 1) = *get_internal_node_key(parent, child_index);
+		move_internal_node_cells(parent, child_index, parent, child_index + 1, num_keys - child_index - 1);
+	}
+	num_keys--;
+	*get_internal_node_num_keys(parent) = num_keys;
+
+	bool is_root = is_node_root(parent);
+	unpin_page(pager, parent_page_num);
+
+	/* a root with a single child hands its place to that child */
+	if (is_root && num_keys == 0) {
+		collapse_root(table);
+	} else if (!is_root && num_keys < pager->internal_node_min_cells) {
+		rebalance_internal_node(table, parent_page_num);
+	}
+}
+
+/* 
+	checks whether removing a run of cells changes nothing but the
+	leaf: the leaf's max key stays put and it stays full enough not
+	to need rebalancing
+
+	pager: pointer to a populated Pager struct
+	node: pointer to the leaf
+	first_cell: first cell to remove
+	end_cell: one past the last cell to remove
+	returns: true if only the leaf changes
+*/
+bool delete_stays_in_leaf(Pager* pager, void* node, uint32_t first_cell, uint32_t end_cell) {
+	if (is_node_root(node)) {
+		return true;
+	}
+	if (end_cell == *get_leaf_num_cells(node)) {
+		return false;
+	}
+	uint32_t space_removed = (end_cell - first_cell) * LEAF_NODE_SLOT_SIZE;
+	for (uint32_t cell = first_cell; cell < end_cell; cell++) {
+		space_removed += *get_leaf_cell_length(node, cell);
 	}
+	return get_leaf_space_used(node) - space_removed >= pager->leaf_node_min_space_used;
 }
 
-/* prints the constants currently being used */
-void print_constants() {
+/* 
+	removes a run of cells from a leaf and rebalances the leaf if that
+	leaves it too empty
+
+	table: pointer to a Table struct for a given DB file
+	page_num: number of the leaf
+	first_cell: first cell to remove
+	end_cell: one past the last cell to remove
+*/
+void delete_cells_in_leaf(Table* table, uint32_t page_num, uint32_t first_cell, uint32_t end_cell) {
+	Pager* pager = table->pager;
+	void* node = pin_page(pager, page_num);
+	mark_page_dirty(pager, page_num);
+
+	uint32_t num_cells = *get_leaf_num_cells(node);
+	bool max_deleted = (end_cell == num_cells);
+	/* the removed rows are left in the heap as holes until the leaf
+	next needs the room */
+	memmove(get_leaf_slot(node, first_cell), get_leaf_slot(node, end_cell),
+		(num_cells - end_cell) * LEAF_NODE_SLOT_SIZE);
+	num_cells -= end_cell - first_cell;
+	*get_leaf_num_cells(node) = num_cells;
+
+	bool is_root = is_node_root(node);
+	uint32_t new_max = (num_cells > 0) ? *get_leaf_key(node, num_cells - 1) : 0;
+	bool underfull = get_leaf_space_used(node) < pager->leaf_node_min_space_used;
+	unpin_page(pager, page_num);
+
+	/* the root leaf is allowed to be as empty as it likes */
+	if (is_root) {
+		return;
+	}
+
+	/* the keys above have to keep matching the leaf's max (an empty
+	leaf is about to be merged away, and the merge sorts out its key) */
+	if (max_deleted && num_cells > 0) {
+		update_max_key_in_ancestors(table, page_num, new_max);
+	}
+	if (underfull) {
+		rebalance_leaf(table, page_num);
+	}
+}
+
+/* 
+	fixes up a leaf that's too empty by merging it with a sibling (if
+	they fit in one leaf) or by evening out the bytes between them
+
+	table: pointer to a Table struct for a given DB file
+	page_num: number of the leaf
+*/
+void rebalance_leaf(Table* table, uint32_t page_num) {
+	Pager* pager = table->pager;
+	uint32_t parent_page_num = *get_node_parent(get_page(pager, page_num));
+	void* parent = pin_page(pager, parent_page_num);
+	mark_page_dirty(pager, parent_page_num);
+
+	/* pair the leaf with a sibling under the same parent -- the one
+	to its left if there is one */
+	uint32_t index = find_child_index(parent, page_num);
+	uint32_t left_index = (index > 0) ? index - 1 : index;
+	uint32_t left_page_num = *get_internal_node_child(parent, left_index);
+	uint32_t right_page_num = *get_internal_node_child(parent, left_index + 1);
+	void* left = pin_page(pager, left_page_num);
+	void* right = pin_page(pager, right_page_num);
+	mark_page_dirty(pager, left_page_num);
+	mark_page_dirty(pager, right_page_num);
+	uint32_t left_cells = *get_leaf_num_cells(left);
+	uint32_t right_cells = *get_leaf_num_cells(right);
+
+	if (get_leaf_space_used(left) + get_leaf_space_used(right) <= pager->leaf_node_space_for_cells) {
+		/* everything fits in the left leaf, so the right one goes */
+		pager->stats.leaf_merges++;
+		for (uint32_t i = 0; i < right_cells; i++) {
+			uint32_t length = *get_leaf_cell_length(right, i);
+			memcpy(insert_leaf_cell(pager, left, left_cells + i, *get_leaf_key(right, i), length),
+				get_leaf_value(right, i), length);
+		}
+		*get_next_leaf_of_given_leaf(left) = *get_next_leaf_of_given_leaf(right);
+		uint32_t merged_max = *get_leaf_key(left, left_cells + right_cells - 1);
+
+		unpin_page(pager, right_page_num);
+		unpin_page(pager, left_page_num);
+		unpin_page(pager, parent_page_num);
+
+		/* the left leaf takes over the right one's key below, so that
+		key has to be the merged max (it isn't if the right leaf was
+		emptied) */
+		update_max_key_in_ancestors(table, right_page_num, merged_max);
+		free_page(pager, right_page_num);
+		remove_child_from_internal_node(table, parent_page_num, left_index + 1);
+		return;
+	}
+
+	/* otherwise give each leaf about half of the bytes -- both are
+	copied out first, since both get written over */
+	char* old_left = malloc(pager->page_size);
+	char* old_right = malloc(pager->page_size);
+	memcpy(old_left, left, pager->page_size);
+	memcpy(old_right, right, pager->page_size);
+	LeafCell* cells = malloc((left_cells + right_cells) * sizeof(LeafCell));
+	uint32_t* leaf_ends = malloc((left_cells + right_cells) * sizeof(uint32_t));
+	collect_leaf_cells(old_left, cells);
+	collect_leaf_cells(old_right, cells + left_cells);
+
+	/* they don't fit in one leaf, and one of them is under a quarter
+	full, so this always comes out as two leaves */
+	plan_leaf_split(pager, cells, left_cells + right_cells, leaf_ends);
+	write_leaf_cells(pager, left, cells, leaf_ends[0]);
+	write_leaf_cells(pager, right, cells + leaf_ends[0], left_cells + right_cells - leaf_ends[0]);
+	free(leaf_ends);
+	free(cells);
+	free(old_right);
+	free(old_left);
+
+	/* the left leaf's max changed, so its key in the parent does too */
+	*get_internal_node_key(parent, left_index) = get_max_key_in_node(pager, left);
+
+	unpin_page(pager, right_page_num);
+	unpin_page(pager, left_page_num);
+	unpin_page(pager, parent_page_num);
+}
+
+/* 
+	fixes up an internal node that's too empty by merging it with a
+	sibling (if they fit in one node) or by rotating children through
+	the parent until the two are even
+
+	table: pointer to a Table struct for a given DB file
+	page_num: number of the internal node
+*/
+void rebalance_internal_node(Table* table, uint32_t page_num) {
+	Pager* pager = table->pager;
+	uint32_t parent_page_num = *get_node_parent(get_page(pager, page_num));
+	void* parent = pin_page(pager, parent_page_num);
+	mark_page_dirty(pager, parent_page_num);
+
+	uint32_t index = find_child_index(parent, page_num);
+	uint32_t left_index = (index > 0) ? index - 1 : index;
+	uint32_t left_page_num = *get_internal_node_child(parent, left_index);
+	uint32_t right_page_num = *get_internal_node_child(parent, left_index + 1);
+	void* left = pin_page(pager, left_page_num);
+	void* right = pin_page(pager, right_page_num);
+	mark_page_dirty(pager, left_page_num);
+	mark_page_dirty(pager, right_page_num);
+	uint32_t left_keys = *get_internal_node_num_keys(left);
+	uint32_t right_keys = *get_internal_node_num_keys(right);
+
+	/* the parent's key for the left node bounds the left node's right
+	child, so it's the key that child gets if it moves into a cell */
+	uint32_t separator = *get_internal_node_key(parent, left_index);
+
+	if (left_keys + 1 + right_keys <= pager->internal_node_max_cells) {
+		pager->stats.internal_merges++;
+		*get_internal_node_cell(left, left_keys) = *get_internal_node_right_child(left);
+		*get_internal_node_key(left, left_keys) = separator;
+		move_internal_node_cells(left, left_keys + 1, right, 0, right_keys);
+		*get_internal_node_right_child(left) = *get_internal_node_right_child(right);
+		*get_internal_node_num_keys(left) = left_keys + 1 + right_keys;
+
+		/* the right node's children all move to the left node */
+		for (uint32_t i = left_keys + 1; i <= left_keys + 1 + right_keys; i++) {
+			uint32_t child_page_num = *get_internal_node_child(left, i);
+			void* child = get_page(pager, child_page_num);
+			mark_page_dirty(pager, child_page_num);
+			*get_node_parent(child) = left_page_num;
+		}
+
+		unpin_page(pager, right_page_num);
+		unpin_page(pager, left_page_num);
+		unpin_page(pager, parent_page_num);
+		free_page(pager, right_page_num);
+		remove_child_from_internal_node(table, parent_page_num, left_index + 1);
+		return;
+	}
+
+	/* move the left node's right child over to the front of the right node */
+	while (left_keys > right_keys + 1) {
+		uint32_t moved_page_num = *get_internal_node_right_child(left);
+		move_internal_node_cells(right, 1, right, 0, right_keys);
+		*get_internal_node_cell(right, 0) = moved_page_num;
+		*get_internal_node_key(right, 0) = separator;
+		right_keys++;
+
+		*get_internal_node_right_child(left) = *get_internal_node_cell(left, left_keys - 1);
+		separator = *get_internal_node_key(left, left_keys - 1);
+		left_keys--;
+
+		void* moved = get_page(pager, moved_page_num);
+		mark_page_dirty(pager, moved_page_num);
+		*get_node_parent(moved) = right_page_num;
+	}
+
+	/* move the right node's first child over to the end of the left node */
+	while (right_keys > left_keys + 1) {
+		uint32_t moved_page_num = *get_internal_node_cell(right, 0);
+		*get_internal_node_cell(left, left_keys) = *get_internal_node_right_child(left);
+		*get_internal_node_key(left, left_keys) = separator;
+		*get_internal_node_right_child(left) = moved_page_num;
+		left_keys++;
+
+		separator = *get_internal_node_key(right, 0);
+		move_internal_node_cells(right, 0, right, 1, right_keys - 1);
+		right_keys--;
+
+		void* moved = get_page(pager, moved_page_num);
+		mark_page_dirty(pager, moved_page_num);
+		*get_node_parent(moved) = left_page_num;
+	}
+
+	*get_internal_node_num_keys(left) = left_keys;
+	*get_internal_node_num_keys(right) = right_keys;
+	*get_internal_node_key(parent, left_index) = separator;
+
+	unpin_page(pager, right_page_num);
+	unpin_page(pager, left_page_num);
+	unpin_page(pager, parent_page_num);
+}
+
+/* 
+	replaces a root that's down to a single child with that child --
+	the root has to stay on its page, so the child is copied up
+
+	table: pointer to a Table struct for a given DB file
+*/
+void collapse_root(Table* table) {
+	Pager* pager = table->pager;
+	void* root = pin_page(pager, table->root_page_num);
+	uint32_t child_page_num = *get_internal_node_right_child(root);
+	void* child = pin_page(pager, child_page_num);
+	mark_page_dirty(pager, table->root_page_num);
+	memcpy(root, child, pager->page_size);
+	set_node_root(root, true);
+
+	/* the child's children now hang off the root */
+	if (get_node_type(root) == NODE_INTERNAL) {
+		uint32_t num_keys = *get_internal_node_num_keys(root);
+		for (uint32_t i = 0; i <= num_keys; i++) {
+			uint32_t grandchild_page_num = *get_internal_node_child(root, i);
+			void* grandchild = get_page(pager, grandchild_page_num);
+			mark_page_dirty(pager, grandchild_page_num);
+			*get_node_parent(grandchild) = table->root_page_num;
+		}
+	}
+
+	unpin_page(pager, child_page_num);
+	unpin_page(pager, table->root_page_num);
+	free_page(pager, child_page_num);
+}
+
+/* returns the max key under the given node -- for an internal node
+that's the max key of its right child, so we follow the right children
+down to a leaf */
+uint32_t get_max_key_in_node(Pager* pager, void* node) {
+	while (get_node_type(node) == NODE_INTERNAL) {
+		node = get_page(pager, *get_internal_node_right_child(node));
+	}
+	return *get_leaf_key(node, *get_leaf_num_cells(node) - 1);
+}
+
+/* prints the constants currently being used, including the ones
+that follow from the DB's page size */
+void print_constants(Pager* pager) {
+	printf("PAGE_SIZE: %u\n", pager->page_size);
 	printf("ROW_SIZE: %ld\n", ROW_SIZE);
 	printf("COMMON_NODE_HEADER_SIZE: %ld\n", COMMON_NODE_HEADER_SIZE);
 	printf("LEAF_NODE_HEADER_SIZE: %ld\n", LEAF_NODE_HEADER_SIZE);
-	printf("LEAF_NODE_CELL_SIZE: %ld\n", LEAF_NODE_CELL_SIZE);
-	printf("LEAF_NODE_SPACE_FOR_CELLS: %ld\n", LEAF_NODE_SPACE_FOR_CELLS);
-	printf("LEAF_NODE_MAX_CELLS: %ld\n", LEAF_NODE_MAX_CELLS);
+	printf("LEAF_NODE_SLOT_SIZE: %ld\n", LEAF_NODE_SLOT_SIZE);
+	printf("LEAF_NODE_MAX_CELL_SIZE: %ld\n", LEAF_NODE_MAX_CELL_SIZE);
+	printf("LEAF_NODE_SPACE_FOR_CELLS: %u\n", pager->leaf_node_space_for_cells);
+	printf("LEAF_NODE_MAX_CELLS: %u\n", pager->leaf_node_max_cells);
 	printf("INTERNAL_NODE_HEADER_SIZE: %ld\n", INTERNAL_NODE_HEADER_SIZE);
 	printf("INTERNAL_NODE_CELL_SIZE: %ld\n", INTERNAL_NODE_CELL_SIZE);
+	printf("INTERNAL_NODE_MAX_CELLS: %u\n", pager->internal_node_max_cells);
 }
 
 /* helper function to indent node key numbers in the B-tree
@@ -493,7 +1229,8 @@ void indent(uint32_t level) {
 
 /* prints a visualization of the B-tree */
 void print_tree(Pager* pager, uint32_t page_num, uint32_t indentation_level) {
-	void* node = get_page(pager, page_num);
+	/* the node stays pinned while its children are printed */
+	void* node = pin_page(pager, page_num);
 	uint32_t num_keys, child;
 
 	switch (get_node_type(node)) {
@@ -524,6 +1261,8 @@ void print_tree(Pager* pager, uint32_t page_num, uint32_t indentation_level) {
 			print_tree(pager, child, indentation_level + 1);
 			break;
 	}
+
+	unpin_page(pager, page_num);
 }
 
 
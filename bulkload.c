@@ -0,0 +1,355 @@
+/*
+
+This program implements bulk loading for a minimalistic SQLite DB
+based on a tutorial at https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+
+/*
+	rows that arrive sorted are packed into leaves left to right and
+	each finished node is handed to the level above, so every page is
+	written once and the tree never needs fixing up afterwards
+*/
+
+
+/*
+	starts a bulk load into an empty table -- in concurrent mode, the
+	caller has to be the writer until the load is finished
+
+	table: pointer to the Table struct to load
+	fill_factor: fraction (0-1] of each node to fill; leaving room
+		makes later inserts into the loaded range split less
+	returns: pointer to a BulkLoader struct, or NULL if the table
+		already has rows
+*/
+BulkLoader* begin_bulk_load(Table* table, double fill_factor) {
+	void* root = get_page(table->pager, table->root_page_num);
+	if (get_node_type(root) != NODE_LEAF || *get_leaf_num_cells(root) != 0) {
+		release_write_latches(table->pager);
+		return NULL;
+	}
+
+	if (fill_factor <= 0 || fill_factor > 1) {
+		fill_factor = 1;
+	}
+
+	BulkLoader* loader = malloc(sizeof(BulkLoader));
+	loader->table = table;
+
+	/* every leaf gets at least one row and every internal node gets
+	at least two children, however low the fill factor */
+	Pager* pager = table->pager;
+	loader->leaf_capacity = pager->leaf_node_space_for_cells * fill_factor;
+	loader->internal_capacity = (pager->internal_node_max_cells + 1) * fill_factor;
+	if (loader->internal_capacity < 2) {
+		loader->internal_capacity = 2;
+	}
+
+	/* the first leaf is the (empty) root itself */
+	loader->leaf_page_num = table->root_page_num;
+	loader->leaf_in_root = true;
+	loader->rows_in_leaf = 0;
+	loader->space_in_leaf = 0;
+	loader->num_rows = 0;
+	loader->last_key = 0;
+	loader->duplicate_keys = false;
+	loader->levels = NULL;
+	loader->num_levels = 0;
+
+	return loader;
+}
+
+/*
+	appends one cell to the tree being built; keys must arrive in
+	strictly increasing order, unless the loader takes duplicate keys
+
+	loader: pointer to a BulkLoader struct from begin_bulk_load()
+	key: the cell's key
+	length: number of bytes the cell's value takes
+	value: set to where the caller should put the value
+	returns: status code signifying the success of the append
+*/
+ExecuteResult append_bulk_cell(BulkLoader* loader, uint32_t key, uint32_t length, void** value) {
+	Pager* pager = loader->table->pager;
+
+	if (loader->num_rows > 0 && (key < loader->last_key ||
+		(key == loader->last_key && !loader->duplicate_keys))) {
+		return key == loader->last_key ? EXECUTE_DUPLICATE_KEY : EXECUTE_UNSORTED_INPUT;
+	}
+
+	uint32_t cell_space = LEAF_NODE_SLOT_SIZE + length;
+	if (loader->rows_in_leaf > 0 && loader->space_in_leaf + cell_space > loader->leaf_capacity) {
+		start_next_bulk_leaf(loader);
+	}
+
+	/* the cell always goes at the end of the current leaf */
+	void* leaf = get_page(pager, loader->leaf_page_num);
+	mark_page_dirty(pager, loader->leaf_page_num);
+	*value = insert_leaf_cell(pager, leaf, loader->rows_in_leaf, key, length);
+
+	loader->rows_in_leaf++;
+	loader->space_in_leaf += cell_space;
+	loader->num_rows++;
+	loader->last_key = key;
+	return EXECUTE_SUCCESS;
+}
+
+/*
+	appends one row to the tree being built; rows must arrive in
+	strictly increasing id order
+
+	loader: pointer to a BulkLoader struct from begin_bulk_load()
+	row: pointer to the Row to append
+	returns: status code signifying the success of the append
+*/
+ExecuteResult bulk_load_row(BulkLoader* loader, Row* row) {
+	void* value;
+	ExecuteResult result = append_bulk_cell(loader, row->id, get_serialized_row_size(row), &value);
+	if (result == EXECUTE_SUCCESS) {
+		serialize_row(row, value);
+	}
+	return result;
+}
+
+/*
+	finishes the current leaf, hands it to the level above, and
+	starts a new leaf to its right
+
+	loader: pointer to a BulkLoader struct
+*/
+void start_next_bulk_leaf(BulkLoader* loader) {
+	Table* table = loader->table;
+	Pager* pager = table->pager;
+
+	/* once there are two leaves, the first one can't stay in the
+	root page, so it moves to a page of its own */
+	if (loader->leaf_in_root) {
+		uint32_t moved_page_num = get_unused_page_num(pager);
+		void* moved_leaf = pin_page(pager, moved_page_num);
+		void* root = get_page(pager, table->root_page_num);
+		memcpy(moved_leaf, root, pager->page_size);
+		set_node_root(moved_leaf, false);
+		mark_page_dirty(pager, moved_page_num);
+		unpin_page(pager, moved_page_num);
+		loader->leaf_page_num = moved_page_num;
+		loader->leaf_in_root = false;
+	}
+
+	uint32_t next_page_num = get_unused_page_num(pager);
+	void* next_leaf = get_page(pager, next_page_num);
+	mark_page_dirty(pager, next_page_num);
+	initialize_leaf_node(pager, next_leaf);
+
+	void* leaf = get_page(pager, loader->leaf_page_num);
+	mark_page_dirty(pager, loader->leaf_page_num);
+	*get_next_leaf_of_given_leaf(leaf) = next_page_num;
+
+	add_bulk_child(loader, 0, loader->leaf_page_num, loader->last_key);
+	loader->leaf_page_num = next_page_num;
+	loader->rows_in_leaf = 0;
+	loader->space_in_leaf = 0;
+
+	/* with the WAL on, commit every finished leaf so the load never
+	holds more uncommitted pages than the cache can keep -- the root
+	is only rewritten at the end, so a crash leaves the table as it
+	was after the first leaf */
+	commit_statement(pager);
+	release_write_latches(pager);
+}
+
+/*
+	gives a finished node to the given level of internal nodes,
+	writing out a node once the level has more children than fit
+
+	loader: pointer to a BulkLoader struct
+	level: level of the parent (0 is the level right above the leaves)
+	child_page_num: page number of the finished node
+	child_max_key: largest key under the finished node
+*/
+void add_bulk_child(BulkLoader* loader, uint32_t level, uint32_t child_page_num, uint32_t child_max_key) {
+	if (level == loader->num_levels) {
+		loader->num_levels++;
+		loader->levels = realloc(loader->levels, loader->num_levels * sizeof(BulkLevel));
+		BulkLevel* new_level = &loader->levels[level];
+		new_level->children = malloc((loader->internal_capacity + 2) * sizeof(BulkChild));
+		new_level->num_children = 0;
+		new_level->num_nodes_written = 0;
+	}
+
+	BulkLevel* bulk_level = &loader->levels[level];
+	bulk_level->children[bulk_level->num_children].page_num = child_page_num;
+	bulk_level->children[bulk_level->num_children].max_key = child_max_key;
+	bulk_level->num_children++;
+
+	/* keep two children back so the last node is never left alone */
+	if (bulk_level->num_children == loader->internal_capacity + 2) {
+		write_bulk_node(loader, level, 0, loader->internal_capacity,
+			get_unused_page_num(loader->table->pager));
+		/* writing may have grown the levels array, so look it up again */
+		bulk_level = &loader->levels[level];
+		memmove(bulk_level->children, bulk_level->children + loader->internal_capacity,
+			2 * sizeof(BulkChild));
+		bulk_level->num_children = 2;
+	}
+}
+
+/*
+	writes an internal node holding some of a level's buffered
+	children and passes it up to the next level (unless it's the root)
+
+	loader: pointer to a BulkLoader struct
+	level: level the node belongs to
+	first_child: index of the node's first child in the level buffer
+	num_children: number of children the node gets
+	page_num: page to write the node to
+*/
+void write_bulk_node(BulkLoader* loader, uint32_t level, uint32_t first_child, uint32_t num_children, uint32_t page_num) {
+	Table* table = loader->table;
+	Pager* pager = table->pager;
+	BulkChild* children = loader->levels[level].children + first_child;
+	bool is_root = (page_num == table->root_page_num);
+
+	void* node = pin_page(pager, page_num);
+	mark_page_dirty(pager, page_num);
+	initialize_internal_node(pager, node);
+	set_node_root(node, is_root);
+
+	/* every child but the last gets a cell; the last is the right child */
+	*get_internal_node_num_keys(node) = num_children - 1;
+	for (uint32_t i = 0; i < num_children - 1; i++) {
+		*get_internal_node_child(node, i) = children[i].page_num;
+		*get_internal_node_key(node, i) = children[i].max_key;
+	}
+	*get_internal_node_right_child(node) = children[num_children - 1].page_num;
+
+	for (uint32_t i = 0; i < num_children; i++) {
+		void* child = get_page(pager, children[i].page_num);
+		mark_page_dirty(pager, children[i].page_num);
+		*get_node_parent(child) = page_num;
+	}
+	unpin_page(pager, page_num);
+
+	/* finishing one node can finish a node on every level above it,
+	so commit each one on its own to keep the WAL's share of the
+	cache down to a node and its children */
+	commit_statement(pager);
+	release_write_latches(pager);
+
+	loader->levels[level].num_nodes_written++;
+	if (!is_root) {
+		add_bulk_child(loader, level + 1, page_num, children[num_children - 1].max_key);
+	}
+}
+
+/*
+	finishes the tree: the last leaf and every level's leftover
+	children are written out, ending with the root, and the loader is
+	freed
+
+	loader: pointer to a BulkLoader struct
+	returns: number of rows loaded
+*/
+uint64_t finish_bulk_load(BulkLoader* loader) {
+	Table* table = loader->table;
+	uint64_t num_rows = loader->num_rows;
+
+	/* a single leaf is already sitting in the root page */
+	if (!loader->leaf_in_root) {
+		add_bulk_child(loader, 0, loader->leaf_page_num, loader->last_key);
+
+		/* a level that never wrote a node is the top one; if its
+		children all fit in one node, that node is the root */
+		for (uint32_t level = 0; level < loader->num_levels; level++) {
+			BulkLevel* bulk_level = &loader->levels[level];
+			uint32_t num_children = bulk_level->num_children;
+			bool is_top = (bulk_level->num_nodes_written == 0);
+
+			/* the leftovers can overshoot the fill factor by one, which
+			is fine as long as they fit -- halving three children would
+			leave a node with just one */
+			if (num_children <= table->pager->internal_node_max_cells + 1) {
+				uint32_t page_num = is_top ? table->root_page_num : get_unused_page_num(table->pager);
+				write_bulk_node(loader, level, 0, num_children, page_num);
+			} else {
+				/* too many for one node, so split them in half */
+				uint32_t left_count = num_children / 2;
+				write_bulk_node(loader, level, 0, left_count, get_unused_page_num(table->pager));
+				write_bulk_node(loader, level, left_count, num_children - left_count,
+					get_unused_page_num(table->pager));
+			}
+			/* writing may have added another level above this one */
+			bulk_level = &loader->levels[level];
+			free(bulk_level->children);
+		}
+	}
+
+	commit_statement(table->pager);
+	release_write_latches(table->pager);
+	free(loader->levels);
+	free(loader);
+	return num_rows;
+}
+
+/*
+	loads rows from a text file into an empty table -- each line of
+	the file holds one row as a value for each of the table's columns,
+	like "id username email", sorted by id
+
+	table: pointer to the Table struct to load
+	path: pointer to a string containing the file's path
+	fill_factor: fraction (0-1] of each node to fill
+	num_rows: set to the number of rows loaded
+	returns: status code signifying the success of the load
+*/
+ExecuteResult bulk_load_file(Table* table, const char* path, double fill_factor, uint64_t* num_rows) {
+	*num_rows = 0;
+	FILE* file = fopen(path, "r");
+	if (file == NULL) {
+		return EXECUTE_FILE_ERROR;
+	}
+
+	/* in concurrent mode, the load is the writer until it finishes */
+	begin_write(table->pager);
+	BulkLoader* loader = begin_bulk_load(table, fill_factor);
+	if (loader == NULL) {
+		end_write(table->pager);
+		fclose(file);
+		return EXECUTE_TABLE_NOT_EMPTY;
+	}
+
+	/* a bad row stops the load, but the rows before it are kept */
+	ExecuteResult result = EXECUTE_SUCCESS;
+	char* line = NULL;
+	size_t line_capacity = 0;
+	Row row;
+	char* values[MAX_COLUMNS];
+	while (result == EXECUTE_SUCCESS && getline(&line, &line_capacity, file) != -1) {
+		values[0] = strtok(line, " \n");
+		if (values[0] == NULL) {
+			continue;
+		}
+		for (uint32_t i = 1; i < table->schema.num_columns; i++) {
+			values[i] = strtok(NULL, " \n");
+		}
+		if (encode_row(&table->schema, values, &row) != RECOGNIZED) {
+			result = EXECUTE_BAD_ROW;
+		} else {
+			result = bulk_load_row(loader, &row);
+		}
+	}
+
+	free(line);
+	fclose(file);
+	*num_rows = finish_bulk_load(loader);
+
+	/* the table was empty, so any indexes on it are too, and they're
+	built from the loaded rows in one go */
+	build_indexes(table);
+	end_write(table->pager);
+	return result;
+}
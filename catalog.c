@@ -0,0 +1,197 @@
+/*
+
+This program implements the catalog of tables for a minimalistic
+SQLite DB based on a tutorial at https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+
+/*
+	the header page lists every table in the file in fixed-size entries
+	that never move, and the tables share one pager; the first entry is
+	the table every file starts with, which statements that don't name
+	a table (and the mk_ commands) are about
+*/
+
+
+/* returns a pointer to the given entry of the catalog in the header
+page */
+void* get_catalog_entry(void* header, uint32_t entry_num) {
+	return header + DB_CATALOG_OFFSET + entry_num * CATALOG_ENTRY_SIZE;
+}
+
+/* returns a pointer to the root page number of the column's index in
+a catalog entry -- this is both a getter and a setter */
+uint32_t* get_catalog_index_root(void* entry, IndexColumn column) {
+	return entry + CATALOG_INDEX_ROOTS_OFFSET + column * CATALOG_INDEX_ROOT_SIZE;
+}
+
+/* returns a pointer to the table's root page number in a catalog
+entry -- this is both a getter and a setter */
+uint32_t* get_catalog_root_page(void* entry) {
+	return entry + CATALOG_ROOT_PAGE_OFFSET;
+}
+
+/* returns a pointer to the table's name in a catalog entry */
+char* get_catalog_name(void* entry) {
+	return entry + CATALOG_NAME_OFFSET;
+}
+
+/* returns a pointer to the number of columns in a catalog entry
+(0 for the first table's columns) -- this is both a getter and a
+setter */
+uint32_t* get_catalog_num_columns(void* entry) {
+	return entry + CATALOG_NUM_COLUMNS_OFFSET;
+}
+
+/* returns a pointer to the given column of a catalog entry */
+void* get_catalog_column(void* entry, uint32_t column_num) {
+	return entry + CATALOG_COLUMNS_OFFSET + column_num * CATALOG_COLUMN_SIZE;
+}
+
+/*
+	writes a table's columns into its catalog entry
+
+	entry: pointer to the table's catalog entry
+	schema: pointer to the table's Schema struct
+*/
+void write_catalog_schema(void* entry, Schema* schema) {
+	*get_catalog_num_columns(entry) = schema->num_columns;
+	for (uint32_t i = 0; i < schema->num_columns; i++) {
+		void* column = get_catalog_column(entry, i);
+		memcpy(column + CATALOG_COLUMN_NAME_OFFSET, schema->columns[i].name, CATALOG_COLUMN_NAME_SIZE);
+		*(uint8_t*) (column + CATALOG_COLUMN_TYPE_OFFSET) = schema->columns[i].type;
+		*(uint8_t*) (column + CATALOG_COLUMN_SIZE_OFFSET) = schema->columns[i].size;
+	}
+}
+
+/*
+	reads a table's columns out of its catalog entry and works out
+	their row layout
+
+	entry: pointer to the table's catalog entry
+	schema: pointer to the Schema struct to fill in
+*/
+void read_catalog_schema(void* entry, Schema* schema) {
+	schema->num_columns = *get_catalog_num_columns(entry);
+	if (schema->num_columns == 0) {
+		set_default_schema(schema);
+		return;
+	}
+	for (uint32_t i = 0; i < schema->num_columns; i++) {
+		void* column = get_catalog_column(entry, i);
+		memcpy(schema->columns[i].name, column + CATALOG_COLUMN_NAME_OFFSET, CATALOG_COLUMN_NAME_SIZE);
+		schema->columns[i].type = *(uint8_t*) (column + CATALOG_COLUMN_TYPE_OFFSET);
+		schema->columns[i].size = *(uint8_t*) (column + CATALOG_COLUMN_SIZE_OFFSET);
+	}
+	compile_schema(schema);
+}
+
+/*
+	sets up a Table struct for a table in the catalog, along with its
+	indexes
+
+	pager: pointer to a populated Pager struct
+	header: pointer to the header page
+	entry_num: number of the table's entry in the catalog
+	returns: pointer to the Table struct, which close_catalog() frees
+*/
+Table* open_table(Pager* pager, void* header, uint32_t entry_num) {
+	void* entry = get_catalog_entry(header, entry_num);
+	Table* table = calloc(1, sizeof(Table));
+	table->pager = pager;
+	table->root_page_num = *get_catalog_root_page(entry);
+	table->catalog_entry = entry_num;
+	memcpy(table->name, get_catalog_name(entry), CATALOG_NAME_SIZE);
+	table->name[TABLE_NAME_MAX_LENGTH] = '\0';
+	read_catalog_schema(entry, &table->schema);
+	open_indexes(table);
+	return table;
+}
+
+/*
+	sets up a Table struct for every table in the catalog
+
+	database: pointer to a Database struct whose pager is open
+*/
+void open_catalog(Database* database) {
+	Pager* pager = database->pager;
+	database->num_tables = 0;
+	for (uint32_t i = 0; i < MAX_TABLES; i++) {
+		void* header = get_page(pager, DB_HEADER_PAGE_NUM);
+		if (*get_catalog_root_page(get_catalog_entry(header, i)) == 0) {
+			break;
+		}
+		database->tables[i] = open_table(pager, header, i);
+		database->num_tables++;
+	}
+}
+
+/* frees what open_catalog() and create_table() set up */
+void close_catalog(Database* database) {
+	for (uint32_t i = 0; i < database->num_tables; i++) {
+		close_indexes(database->tables[i]);
+		free(database->tables[i]);
+	}
+}
+
+/*
+	finds the table with the given name
+
+	database: pointer to a Database struct with the tables
+	name: pointer to a string containing the table's name
+	returns: pointer to the table's Table struct, or NULL if there's
+		no table by that name
+*/
+Table* find_table(Database* database, const char* name) {
+	uint32_t num_tables = __atomic_load_n(&database->num_tables, __ATOMIC_ACQUIRE);
+	for (uint32_t i = 0; i < num_tables; i++) {
+		if (strcmp(database->tables[i]->name, name) == 0) {
+			return database->tables[i];
+		}
+	}
+	return NULL;
+}
+
+/*
+	creates an empty table and adds it to the catalog
+
+	database: pointer to a Database struct with the tables
+	name: pointer to a string containing the new table's name
+	schema: pointer to a Schema struct with the new table's columns
+	returns: status code signifying the success of execution
+*/
+ExecuteResult create_table(Database* database, const char* name, Schema* schema) {
+	if (find_table(database, name) != NULL) {
+		return EXECUTE_TABLE_EXISTS;
+	}
+	if (database->num_tables == MAX_TABLES) {
+		return EXECUTE_CATALOG_FULL;
+	}
+
+	Pager* pager = database->pager;
+	uint32_t root_page_num = get_unused_page_num(pager);
+	void* root = get_page(pager, root_page_num);
+	mark_page_dirty(pager, root_page_num);
+	initialize_leaf_node(pager, root);
+	set_node_root(root, true);
+
+	uint32_t entry_num = database->num_tables;
+	void* header = get_page(pager, DB_HEADER_PAGE_NUM);
+	mark_page_dirty(pager, DB_HEADER_PAGE_NUM);
+	void* entry = get_catalog_entry(header, entry_num);
+	memset(entry, 0, CATALOG_ENTRY_SIZE);
+	*get_catalog_root_page(entry) = root_page_num;
+	strcpy(get_catalog_name(entry), name);
+	write_catalog_schema(entry, schema);
+
+	/* the table is set up before it's counted, so readers can't find
+	half of it */
+	database->tables[entry_num] = open_table(pager, header, entry_num);
+	__atomic_store_n(&database->num_tables, entry_num + 1, __ATOMIC_RELEASE);
+	return EXECUTE_SUCCESS;
+}
@@ -19,10 +19,14 @@ at Olin College of Engineering.
 */
 Cursor* get_table_start(Table* table) {
 	Cursor* cursor = find_key_in_table(table, 0);
-	void* node = get_page(table->pager, cursor->page_num);
-	uint32_t num_cells = *get_leaf_num_cells(node);
+	uint32_t num_cells = *get_leaf_num_cells(cursor->node);
 	cursor->end_of_table = (num_cells == 0);
 
+	/* a full scan is going to read every leaf, so it can start
+	asking for the ones after the first straight away */
+	cursor->read_ahead = FULL_SCAN_READ_AHEAD;
+	read_ahead_leaves(cursor);
+
 	return cursor;
 }
 
@@ -37,7 +41,7 @@ Cursor* get_table_start(Table* table) {
 */
 Cursor* find_key_in_table(Table* table, uint32_t key) {
 	uint32_t root_page_num = table->root_page_num;
-	void* root_node = get_page(table->pager, root_page_num);
+	void* root_node = latch_page(table->pager, root_page_num);
 
 	/* determine if we need to search for the relevant leaf node */
 	if (get_node_type(root_node) == NODE_LEAF) {
@@ -47,6 +51,28 @@ Cursor* find_key_in_table(Table* table, uint32_t key) {
 	}
 }
 
+/* 
+	creates a Cursor for the first row with a key of at least
+	first_key, which stops walking the leaves once it passes last_key
+
+	table: pointer to a Table struct for a given DB file
+	first_key: smallest key the Cursor should return
+	last_key: biggest key the Cursor should return
+
+	returns: pointer to a Cursor struct for the given Table
+*/
+Cursor* find_range_in_table(Table* table, uint32_t first_key, uint32_t last_key) {
+	Cursor* cursor = find_key_in_table(table, first_key);
+	cursor->last_key = last_key;
+	/* most ranges end in the leaf they start in, so nothing is read
+	ahead until the cursor moves on to a second leaf */
+	cursor->read_ahead = RANGE_SCAN_READ_AHEAD;
+
+	/* the first key might sit past the end of the leaf it led us to */
+	settle_cursor(cursor);
+	return cursor;
+}
+
 /* 
 	recursively searches for the node with the given key by
 	moving down the table (parent to child)
@@ -59,29 +85,18 @@ Cursor* find_key_in_table(Table* table, uint32_t key) {
 uint32_t find_internal_node_child(void* node, uint32_t key) {
 	uint32_t num_keys = *get_internal_node_num_keys(node);
 
-	uint32_t min_index = 0;
-	/* because of the right child pointer, there is one more 
-	child than key */
-	uint32_t max_index = num_keys; 
-
-	/* use binary search to identify which child node to search */
-	while (min_index != max_index) {
-		uint32_t index = (min_index + max_index) / 2;
-		uint32_t key_to_right = *get_internal_node_key(node, index);
-		/* decide which direction to search in next (left or right) */
-		if (key_to_right >= key) {
-			max_index = index;
-		} else {
-			min_index = index + 1;
-		}
-	}
-
-	return min_index;
+	/* the keys sit together ahead of the child pointers, and the
+	right child (at num_keys) is the one to take if every key is
+	smaller than the one we want */
+	return search_keys(get_internal_node_key(node, 0), 1, num_keys, key);
 }
 
 
 /* 
-	finds the internal node with the given key 
+	finds the internal node with the given key -- the node comes
+	latched, and the latch is handed down to the child before the
+	node lets go of it (crabbing), so a writer can't change the child
+	in between
 
 	table: pointer to a Table struct for a given DB file
 	page_num: int that maps to the node we're currently looking at
@@ -96,7 +111,8 @@ Cursor* find_internal_node(Table* table, uint32_t page_num, uint32_t key) {
 	/* get the child we want to search, then search it*/
 	uint32_t child_index = find_internal_node_child(node, key);
 	uint32_t child_num = *get_internal_node_child(node, child_index);
-	void* child = get_page(table->pager, child_num);
+	void* child = latch_page(table->pager, child_num);
+	unlatch_page(table->pager, page_num);
 	
 	switch (get_node_type(child)) {
 		case NODE_LEAF:
@@ -106,6 +122,38 @@ Cursor* find_internal_node(Table* table, uint32_t page_num, uint32_t key) {
 	}
 }
 
+/* 
+	walks down the tree to the leaf the given key belongs in, keeping
+	track of the separator keys passed along the way -- every key up to
+	the smallest separator we went left of belongs in the same leaf
+
+	table: pointer to a Table struct for a given DB file
+	key: int that maps to some value
+	upper_bound: set to the biggest key the leaf may hold
+	has_upper_bound: set to false when the leaf is the last one in the
+		table (any bigger key belongs in it too)
+	returns: page number of the leaf
+*/
+uint32_t find_leaf_with_bound(Table* table, uint32_t key, uint32_t* upper_bound, bool* has_upper_bound) {
+	uint32_t page_num = table->root_page_num;
+	void* node = get_page(table->pager, page_num);
+	*has_upper_bound = false;
+
+	while (get_node_type(node) == NODE_INTERNAL) {
+		uint32_t child_index = find_internal_node_child(node, key);
+		/* going left of a key caps what the child can hold; the right
+		child just inherits the cap from further up */
+		if (child_index < *get_internal_node_num_keys(node)) {
+			*upper_bound = *get_internal_node_key(node, child_index);
+			*has_upper_bound = true;
+		}
+		page_num = *get_internal_node_child(node, child_index);
+		node = get_page(table->pager, page_num);
+	}
+
+	return page_num;
+}
+
 /* 
 	finds the memory location of the cursor's page + cell number
 
@@ -113,22 +161,19 @@ Cursor* find_internal_node(Table* table, uint32_t page_num, uint32_t key) {
 	returns: pointer to the location of the cell
 */
 void* get_cursor_value(Cursor* cursor) {
-	uint32_t page_num = cursor->page_num;
-	void* page = get_page(cursor->table->pager, page_num);
-	return get_leaf_value(page, cursor->cell_num);
+	return get_leaf_value(cursor->node, cursor->cell_num);
 }
 
 /* 
-	increments the cell number of the given Cursor by one or
-	points to the next node if there are no more cells in the
-	current node/page
+	moves the Cursor off the end of its leaf onto the next leaf if it
+	needs to, and marks the end of the table once there are no more
+	leaves or the Cursor has passed its last key
 
 	cursor: pointer to a Cursor struct for the current Table
 */
-void advance_cursor(Cursor* cursor) {
+void settle_cursor(Cursor* cursor) {
 	uint32_t page_num = cursor->page_num;
-	void* node = get_page(cursor->table->pager, page_num);
-	cursor->cell_num += 1;
+	void* node = cursor->node;
 
 	/* check to see if the cell_num is out of the table (too high) */
 	if (cursor->cell_num >= (*get_leaf_num_cells(node))) {
@@ -139,10 +184,139 @@ void advance_cursor(Cursor* cursor) {
 		table) */
 		if (next_page_num == 0) {
 			cursor->end_of_table = true;
-		} else {
-			/* point the cursor at the current leaf's sibling */
-			cursor->page_num = next_page_num;
-			cursor->cell_num = 0;
+			return;
+		}
+		/* point the cursor at the current leaf's sibling, moving
+		the cursor's latch along with it -- leaves are latched left
+		to right, against the writer's top-down order, so if the
+		writer has the sibling, the cursor lets go and comes back
+		down from the root to the key after this leaf's last one */
+		void* next_node = try_latch_page(cursor->table->pager, next_page_num);
+		if (next_node == NULL) {
+			uint32_t num_cells = *get_leaf_num_cells(node);
+			uint32_t last_key = (num_cells > 0) ? *get_leaf_key(node, num_cells - 1) : cursor->last_key;
+			if (last_key >= cursor->last_key) {
+				cursor->end_of_table = true;
+				return;
+			}
+			unlatch_page(cursor->table->pager, page_num);
+			Cursor* resumed = find_key_in_table(cursor->table, last_key + 1);
+			cursor->page_num = resumed->page_num;
+			cursor->node = resumed->node;
+			cursor->cell_num = resumed->cell_num;
+			free(resumed);
+			settle_cursor(cursor);
+			return;
 		}
+		node = next_node;
+		unlatch_page(cursor->table->pager, page_num);
+		cursor->page_num = next_page_num;
+		cursor->node = next_node;
+		cursor->cell_num = 0;
+		read_ahead_leaves(cursor);
 	}
-}
\ No newline at end of file
+
+	/* keys only grow from here, so one past the range is the end */
+	if (*get_leaf_key(node, cursor->cell_num) > cursor->last_key) {
+		cursor->end_of_table = true;
+	}
+}
+
+/* 
+	increments the cell number of the given Cursor by one or
+	points to the next node if there are no more cells in the
+	current node/page
+
+	cursor: pointer to a Cursor struct for the current Table
+*/
+void advance_cursor(Cursor* cursor) {
+	cursor->cell_num += 1;
+	settle_cursor(cursor);
+}
+
+/* 
+	releases the Cursor's latch on its current leaf and frees it
+
+	cursor: pointer to a Cursor struct for the current Table
+*/
+void close_cursor(Cursor* cursor) {
+	unlatch_page(cursor->table->pager, cursor->page_num);
+	free(cursor);
+}
+
+/* 
+	reads the leaves after the cursor's leaf into the buffer pool
+	ahead of time, so a scan finds them in memory instead of waiting
+	on the disk for each one -- the page numbers come from the parent
+	node, since following the next_leaf pointers would mean reading
+	the leaves
+
+	the leaves are asked for in batches: nothing happens until half
+	of the ones asked for have been passed, and the window doubles
+	every time the cursor moves on to another leaf
+
+	cursor: pointer to a Cursor struct for the current Table
+*/
+void read_ahead_leaves(Cursor* cursor) {
+	Pager* pager = cursor->table->pager;
+	uint32_t window = cursor->read_ahead;
+	if (window > pager->max_read_ahead) {
+		window = pager->max_read_ahead;
+	}
+	/* leaves read ahead take up frames, so leave most of the pool to
+	the pages that are actually in use */
+	if (window > pager->num_frames / 4) {
+		window = pager->num_frames / 4;
+	}
+	void* leaf = cursor->node;
+	if (window == 0 || is_node_root(leaf) || *get_leaf_num_cells(leaf) == 0) {
+		return;
+	}
+
+	/* the parent's key for a leaf is the leaf's max key, so searching
+	the parent for it finds the leaf's place among the children (or,
+	in an index, where keys repeat, one of the leaves before it) --
+	the parent is latched bottom-up, against the writer's order, so
+	read-ahead is skipped if the writer has it */
+	uint32_t parent_page_num = *get_node_parent(leaf);
+	void* parent = try_latch_page(pager, parent_page_num);
+	if (parent == NULL) {
+		return;
+	}
+	uint32_t num_keys = *get_internal_node_num_keys(parent);
+	uint32_t index = find_internal_node_child(parent, *get_leaf_key(leaf, *get_leaf_num_cells(leaf) - 1));
+	if (*get_internal_node_child(parent, index) != cursor->page_num) {
+		index = find_child_index(parent, cursor->page_num);
+	}
+	if (parent_page_num != cursor->read_ahead_parent || cursor->read_ahead_end <= index) {
+		cursor->read_ahead_parent = parent_page_num;
+		cursor->read_ahead_end = index + 1;
+	}
+	cursor->read_ahead = window * 2;
+
+	uint32_t leaves_ahead = cursor->read_ahead_end - index - 1;
+	if (leaves_ahead > window / 2) {
+		unlatch_page(pager, parent_page_num);
+		return;
+	}
+
+	/* the pager reads the leaves that aren't cached yet in one batch,
+	with neighbouring pages going out together -- reading them may
+	evict the parent, so the page numbers are all gathered first */
+	uint32_t* page_nums = malloc(window * sizeof(uint32_t));
+	uint32_t num_pages = 0;
+	uint32_t child = cursor->read_ahead_end;
+	for (; child <= num_keys && child <= index + window; child++) {
+		/* every key in this child is past the key to its left, so
+		once that key is past the range, so is the rest of the node */
+		if (child > 0 && *get_internal_node_key(parent, child - 1) >= cursor->last_key) {
+			break;
+		}
+
+		page_nums[num_pages++] = *get_internal_node_child(parent, child);
+	}
+	unlatch_page(pager, parent_page_num);
+	read_ahead_pages(pager, page_nums, num_pages);
+	free(page_nums);
+	cursor->read_ahead_end = child;
+}
@@ -26,7 +26,7 @@ InputBuffer* new_input_buffer() {
 
 /* prints a prompt to the user to enter a command */
 void print_prompt() { 
-	printf("db > "); 
+	print_message("db > "); 
 }
 
 /*
@@ -36,6 +36,9 @@ void print_prompt() {
 */
 void read_input(InputBuffer* input_buffer) {
 
+	/* whoever's typing needs to see the prompt and the last results */
+	flush_output_for_input();
+
 	/* getline() reads a stream line-by-line into a provided buffer;
 	it returns the number of characters read, including the delimiter */
 	ssize_t bytes_read =
@@ -43,7 +46,7 @@ void read_input(InputBuffer* input_buffer) {
 
 	/* make sure the input buffer isn't NULL by checking bytes_read */
 	if (bytes_read <= 0) {
-		printf("Error reading input\n");
+		print_message("Error reading input\n");
 		exit(EXIT_FAILURE);
 	}
 
@@ -53,23 +56,106 @@ void read_input(InputBuffer* input_buffer) {
 }
 
 /* 
-	implements a command if recognized; otherwise, returns a failure code
+	loads a sorted file of rows into an empty table -- the command looks
+	like "mk_bulkload <path> [fill_factor]"
 
 	input_buffer: pointer to InputBuffer with command
 	table: pointer to Table struct with DB data
+*/
+void implement_bulk_load(InputBuffer* input_buffer, Table* table) {
+	strtok(input_buffer->buffer, " ");
+	char* path = strtok(NULL, " ");
+	char* fill_string = strtok(NULL, " ");
+	if (path == NULL) {
+		printf("That syntax is wack\n");
+		return;
+	}
+	double fill_factor = (fill_string == NULL) ? 1.0 : atof(fill_string);
+
+	uint64_t num_rows;
+	switch (bulk_load_file(table, path, fill_factor, &num_rows)) {
+		case (EXECUTE_SUCCESS):
+			break;
+		case (EXECUTE_FILE_ERROR):
+			printf("Error: couldn't find anything to load at '%s'\n", path);
+			return;
+		case (EXECUTE_TABLE_NOT_EMPTY):
+			printf("Error: bulk loads only go into empty tables\n");
+			return;
+		case (EXECUTE_UNSORTED_INPUT):
+			printf("Error: bulk loads like their ids in order\n");
+			break;
+		case (EXECUTE_DUPLICATE_KEY):
+			printf("Error: I don't like seconds\n");
+			break;
+		default:
+			printf("Error: that file has a row I can't read\n");
+			break;
+	}
+	printf("Loaded %llu rows\n", (unsigned long long) num_rows);
+}
+
+/* 
+	starts or stops the periodic stats dump -- the command looks like
+	"mk_stats_dump <path> <seconds>" or "mk_stats_dump off"
+
+	input_buffer: pointer to InputBuffer with command
+	table: pointer to Table struct with DB data
+*/
+void implement_stats_dump(InputBuffer* input_buffer, Table* table) {
+	strtok(input_buffer->buffer, " ");
+	char* path = strtok(NULL, " ");
+	char* interval_string = strtok(NULL, " ");
+	if (path != NULL && strcmp(path, "off") == 0 && interval_string == NULL) {
+		stop_stats_dump(table->pager);
+		return;
+	}
+	if (path == NULL || interval_string == NULL || atof(interval_string) <= 0) {
+		printf("That syntax is wack\n");
+		return;
+	}
+
+	if (!start_stats_dump(table->pager, path, atof(interval_string))) {
+		printf("Error: couldn't open '%s' to dump stats into\n", path);
+	}
+}
+
+/* 
+	implements a command if recognized; otherwise, returns a failure code
+
+	input_buffer: pointer to InputBuffer with command
+	database: pointer to Database struct with DB data
 	returns: a command result code
 */
-MetaCommandResult implement_command(InputBuffer* input_buffer, Table* table) {
+MetaCommandResult implement_command(InputBuffer* input_buffer, Database* database) {
+	/* the commands are about the first table, or the whole file */
+	Table* table = database->tables[0];
 	if (strcmp(input_buffer->buffer, "mk_exit") == 0) {
-		close_database(table);
+		close_database(database);
 		exit(EXIT_SUCCESS);
 	} else if (strcmp(input_buffer->buffer, "mk_btree") == 0) {
 		printf("Tree:\n");
-		print_tree(table->pager, 0, 0);
+		print_tree(table->pager, table->root_page_num, 0);
+		return META_COMMAND_SUCCESS;
+	} else if (strcmp(input_buffer->buffer, "mk_checkpoint") == 0) {
+		checkpoint(table->pager);
+		return META_COMMAND_SUCCESS;
+	} else if (strncmp(input_buffer->buffer, "mk_bulkload ", 12) == 0) {
+		implement_bulk_load(input_buffer, table);
+		return META_COMMAND_SUCCESS;
+	} else if (strcmp(input_buffer->buffer, "mk_stats") == 0) {
+		printf("Stats:\n");
+		print_stats(table->pager);
+		return META_COMMAND_SUCCESS;
+	} else if (strcmp(input_buffer->buffer, "mk_stats_reset") == 0) {
+		reset_stats(table->pager);
+		return META_COMMAND_SUCCESS;
+	} else if (strncmp(input_buffer->buffer, "mk_stats_dump ", 14) == 0) {
+		implement_stats_dump(input_buffer, table);
 		return META_COMMAND_SUCCESS;
 	} else if (strcmp(input_buffer->buffer, "mk_constants") == 0) {
 	    printf("Constants:\n");
-	    print_constants();
+	    print_constants(table->pager);
 	    return META_COMMAND_SUCCESS;
 	} else {
 		return META_COMMAND_UNRECOGNIZED;
@@ -77,95 +163,496 @@ MetaCommandResult implement_command(InputBuffer* input_buffer, Table* table) {
 }
 
 /* 
-	determines the validity of the SQL insert statement
+	copies the name of the table a statement creates into it
+
+	name: pointer to a string containing the name (NULL if it's missing)
+	statement: pointer to a Statement struct to hold the name
+	returns: an enum representing whether the name was parsed correctly
+*/
+ParsingResult parse_table_name(char* name, Statement* statement) {
+	if (name == NULL || *name == '\0') return SYNTAX_ERROR;
+	if (strlen(name) > TABLE_NAME_MAX_LENGTH) return STRING_TOO_LONG;
+	strcpy(statement->table_name, name);
+	return RECOGNIZED;
+}
+
+/* 
+	finds the table a statement names -- its columns are needed to
+	make sense of the rest of the statement
+
+	name: pointer to a string containing the name (NULL if it's missing)
+	database: pointer to a Database struct with the tables
+	statement: pointer to a Statement struct to hold the table
+	returns: an enum representing whether the name was parsed correctly
+*/
+ParsingResult find_statement_table(char* name, Database* database, Statement* statement) {
+	if (name == NULL || *name == '\0') return SYNTAX_ERROR;
+	if (strlen(name) > TABLE_NAME_MAX_LENGTH) return STRING_TOO_LONG;
+	statement->table = find_table(database, name);
+	return (statement->table == NULL) ? UNKNOWN_TABLE : RECOGNIZED;
+}
+
+/* 
+	reads the " from NAME" that can come after a statement's keywords,
+	moving the clause past it
+
+	clause: pointer to the rest of the statement, moved past the name
+	keyword: the word before the name, with a space either side
+	database: pointer to a Database struct with the tables
+	statement: pointer to a Statement struct to hold the table
+	returns: an enum representing whether the name was parsed correctly
+*/
+ParsingResult parse_table_clause(char** clause, const char* keyword, Database* database, Statement* statement) {
+	size_t length = strlen(keyword);
+	if (strncmp(*clause, keyword, length) != 0) {
+		return RECOGNIZED;
+	}
+
+	/* the name runs up to the next space, if there is one */
+	char name[TABLE_NAME_MAX_LENGTH + 2];
+	char* start = *clause + length;
+	size_t name_length = strcspn(start, " ");
+	if (name_length > TABLE_NAME_MAX_LENGTH) return STRING_TOO_LONG;
+	memcpy(name, start, name_length);
+	name[name_length] = '\0';
+	*clause = start + name_length;
+	return find_statement_table(name, database, statement);
+}
+
+/* 
+	determines the validity of the SQL insert statement, which is
+	"insert" (or "insert into NAME") followed by the rows, each a value
+	for every column of the table
 
 	input_buffer: pointer to InputBuffer with insert command
 	statement: pointer to a Statement struct with the command type
+	database: pointer to a Database struct with the tables
 	returns: an enum representing whether the command was parsed correctly
 */
-ParsingResult check_insert(InputBuffer* input_buffer, Statement* statement) {
+ParsingResult check_insert(InputBuffer* input_buffer, Statement* statement, Database* database) {
 	statement->type = STATEMENT_INSERT;
+	statement->num_rows_to_insert = 0;
 
 	/* strtok() splits the given string once with each call,
 	returning the new split-off part each time */
 	char* keyword = strtok(input_buffer->buffer, " ");
 	char* id_string = strtok(NULL, " ");
-	char* username = strtok(NULL, " ");
-	char* email = strtok(NULL, " ");
+	if (id_string != NULL && strcmp(id_string, "into") == 0) {
+		ParsingResult result = find_statement_table(strtok(NULL, " "), database, statement);
+		if (result != RECOGNIZED) {
+			return result;
+		}
+		id_string = strtok(NULL, " ");
+	}
+
+	/* the statement holds one or more rows, each starting with its id */
+	Schema* schema = &statement->table->schema;
+	char* values[MAX_COLUMNS];
+	do {
+		values[0] = id_string;
+		for (uint32_t i = 1; i < schema->num_columns; i++) {
+			values[i] = strtok(NULL, " ");
+		}
+
+		/* the rows array is kept between statements and only grows */
+		if (statement->num_rows_to_insert == statement->rows_capacity) {
+			statement->rows_capacity = 2 * statement->rows_capacity + 1;
+			statement->rows_to_insert = realloc(statement->rows_to_insert,
+				statement->rows_capacity * sizeof(Row));
+		}
+
+		Row* row = &(statement->rows_to_insert[statement->num_rows_to_insert]);
+		ParsingResult result = encode_row(schema, values, row);
+		if (result != RECOGNIZED) {
+			return result;
+		}
+		statement->num_rows_to_insert++;
+
+		id_string = strtok(NULL, " ");
+	} while (id_string != NULL);
+
+	return RECOGNIZED;
+}
 
-	/* check that the statement had all of the required fields */
-	if (id_string == NULL || username == NULL || email == NULL) {
+
+/* 
+	reads the "where" clause shared by select and delete, which is
+	either " where id = K" or " where id between A and B"
+
+	clause: pointer to the rest of the statement after its keywords
+	statement: pointer to a Statement struct to hold the id range
+	returns: an enum representing whether the clause was parsed correctly
+*/
+ParsingResult parse_id_range(char* clause, Statement* statement) {
+	/* %n records how much was read (if we got that far), so
+	anything left over afterwards is caught too */
+	int first_id, last_id;
+	int characters_read = -1;
+	if (sscanf(clause, " where id = %d%n", &first_id, &characters_read) == 1) {
+		last_id = first_id;
+	} else {
+		sscanf(clause, " where id between %d and %d%n",
+			&first_id, &last_id, &characters_read);
+	}
+	if (characters_read != (int) strlen(clause)) {
 		return SYNTAX_ERROR;
 	}
 
-	int id = atoi(id_string);
+	if (first_id < 0 || last_id < 0) return NEGATIVE_ID;
+
+	statement->first_id = first_id;
+	statement->last_id = last_id;
+	return RECOGNIZED;
+}
+
+/* 
+	reads a " where COLUMN = X" clause about one of the table's string
+	columns, like " where email = X"
+
+	clause: pointer to the rest of the statement after its keywords
+	statement: pointer to a Statement struct to hold the value
+	returns: an enum representing whether the clause was parsed
+		correctly, or UNRECOGNIZED if it isn't about a string column
+*/
+ParsingResult parse_value_filter(char* clause, Statement* statement) {
+	Schema* schema = &statement->table->schema;
+	char column[COLUMN_NAME_MAX_LENGTH + 1];
+	int value_start = -1;
+	sscanf(clause, " where %15s = %n", column, &value_start);
+	if (value_start < 0 || !find_column(schema, column, &statement->value_column) ||
+		schema->columns[statement->value_column].type == COLUMN_INT) {
+		return UNRECOGNIZED;
+	}
+
+	char* value = clause + value_start;
+	if (*value == '\0' || strchr(value, ' ') != NULL) return SYNTAX_ERROR;
+	if (strlen(value) > schema->columns[statement->value_column].size) return STRING_TOO_LONG;
 
-	/* I know dropping the {} is bad practice...but it looks better */
-	if (id < 0) return NEGATIVE_ID;
-	if (strlen(username) > COLUMN_USERNAME_SIZE) return STRING_TOO_LONG;
-	if (strlen(email) > COLUMN_EMAIL_SIZE) return STRING_TOO_LONG;
+	strcpy(statement->value, value);
+	statement->by_value = true;
+	return RECOGNIZED;
+}
 
-	/* assign the statement values to the Statement struct */
-	statement->row_to_insert.id = id;
-	strcpy(statement->row_to_insert.username, username);
-	strcpy(statement->row_to_insert.email, email);
+/* 
+	reads the columns a select names before its from or where clause,
+	like " id, email" -- " *" or no columns at all mean every column
+
+	clause: pointer to the rest of the statement after its keywords,
+		which gets moved past the columns
+	names: set to the names of the columns
+	num_names: set to the number of columns named, or 0 for every column
+	returns: an enum representing whether the columns were parsed correctly
+*/
+ParsingResult parse_projection(char** clause, char names[][COLUMN_NAME_MAX_LENGTH + 1], uint32_t* num_names) {
+	*num_names = 0;
+	if (**clause == '\0' || strncmp(*clause, " from ", 6) == 0 || strncmp(*clause, " where ", 7) == 0) {
+		return RECOGNIZED;
+	}
+	if (strncmp(*clause, " *", 2) == 0 && ((*clause)[2] == '\0' || (*clause)[2] == ' ')) {
+		*clause += 2;
+		return RECOGNIZED;
+	}
 
+	/* the names are separated by commas, so a name that isn't
+	followed by one is the last */
+	while (true) {
+		int characters_read = -1;
+		sscanf(*clause, " %15[^ ,]%n", names[*num_names], &characters_read);
+		if (characters_read < 0) return SYNTAX_ERROR;
+		*clause += characters_read;
+		(*num_names)++;
+
+		int comma_read = -1;
+		sscanf(*clause, " ,%n", &comma_read);
+		if (comma_read < 0) break;
+		if (*num_names == MAX_COLUMNS) return SYNTAX_ERROR;
+		*clause += comma_read;
+	}
+	if (**clause != '\0' && **clause != ' ') return SYNTAX_ERROR;
 	return RECOGNIZED;
 }
 
+/* 
+	determines the validity of the SQL select statement, which is one of
+	"select", "select where id = K" or "select where id between A and B",
+	any of them with "unordered" after "select" if the rows can come
+	out in any order, or with count(*), min(id), max(id) or sum(id)
+	after it if only that is wanted -- or "select where COLUMN = X" for
+	a string column, like email; "from NAME" before the where clause
+	picks a table other than the first, and a list of columns, like
+	"select id, email", prints only those
+
+	input_buffer: pointer to InputBuffer with select command
+	statement: pointer to a Statement struct with the command type
+	database: pointer to a Database struct with the tables
+	returns: an enum representing whether the command was parsed correctly
+*/
+ParsingResult check_select(InputBuffer* input_buffer, Statement* statement, Database* database) {
+	statement->type = STATEMENT_SELECT;
+	statement->first_id = 0;
+	statement->last_id = UINT32_MAX;
+	statement->by_value = false;
+
+	char* clause = input_buffer->buffer + strlen("select");
+	statement->unordered = (strncmp(clause, " unordered", 10) == 0 &&
+		(clause[10] == '\0' || clause[10] == ' '));
+	if (statement->unordered) {
+		clause += 10;
+	}
+
+	/* the names sit in the same order as the AggregateType values */
+	const char* aggregates[] = { " count(*)", " min(id)", " max(id)", " sum(id)" };
+	statement->aggregate = AGGREGATE_NONE;
+	for (uint32_t i = 0; i < sizeof(aggregates) / sizeof(aggregates[0]); i++) {
+		size_t length = strlen(aggregates[i]);
+		if (strncmp(clause, aggregates[i], length) == 0 &&
+			(clause[length] == '\0' || clause[length] == ' ')) {
+			statement->aggregate = AGGREGATE_COUNT + i;
+			clause += length;
+			break;
+		}
+	}
+
+	/* the columns come before the table, so they're looked up after it */
+	char names[MAX_COLUMNS][COLUMN_NAME_MAX_LENGTH + 1];
+	uint32_t num_names = 0;
+	if (statement->aggregate == AGGREGATE_NONE) {
+		ParsingResult result = parse_projection(&clause, names, &num_names);
+		if (result != RECOGNIZED) {
+			return result;
+		}
+	}
+	ParsingResult result = parse_table_clause(&clause, " from ", database, statement);
+	if (result != RECOGNIZED) {
+		return result;
+	}
+	Schema* schema = &statement->table->schema;
+	if (num_names == 0) {
+		project_all_columns(schema, &statement->projection);
+	} else {
+		statement->projection.num_columns = 0;
+		statement->projection.num_varchars = 0;
+		for (uint32_t i = 0; i < num_names; i++) {
+			if (!project_column(schema, names[i], &statement->projection)) {
+				return UNKNOWN_COLUMN;
+			}
+		}
+	}
+
+	if (*clause == '\0') {
+		return RECOGNIZED;
+	}
+	if (statement->aggregate == AGGREGATE_NONE) {
+		result = parse_value_filter(clause, statement);
+		if (result != UNRECOGNIZED) {
+			return result;
+		}
+	}
+	return parse_id_range(clause, statement);
+}
+
+/* 
+	determines the validity of the SQL delete statement, which is
+	"delete where id = K" or "delete where id between A and B" -- there's
+	no bare "delete", so the whole table can't go by accident; "delete
+	from NAME where ..." deletes from a table other than the first
+
+	input_buffer: pointer to InputBuffer with delete command
+	statement: pointer to a Statement struct with the command type
+	database: pointer to a Database struct with the tables
+	returns: an enum representing whether the command was parsed correctly
+*/
+ParsingResult check_delete(InputBuffer* input_buffer, Statement* statement, Database* database) {
+	statement->type = STATEMENT_DELETE;
+	char* clause = input_buffer->buffer + strlen("delete");
+	ParsingResult result = parse_table_clause(&clause, " from ", database, statement);
+	if (result != RECOGNIZED) {
+		return result;
+	}
+	return parse_id_range(clause, statement);
+}
+
+/* 
+	determines the validity of the SQL create index statement, which
+	is "create index on username" or "create index on email" for the
+	first table, or "create index on NAME (email)" for any of them --
+	the table has to have a string column by that name
+
+	input_buffer: pointer to InputBuffer with create command
+	statement: pointer to a Statement struct with the command type
+	database: pointer to a Database struct with the tables
+	returns: an enum representing whether the command was parsed correctly
+*/
+ParsingResult check_create_index(InputBuffer* input_buffer, Statement* statement, Database* database) {
+	statement->type = STATEMENT_CREATE_INDEX;
+	char column[COLUMN_NAME_MAX_LENGTH + 1];
+	int characters_read = -1;
+	sscanf(input_buffer->buffer, "create index on %15s%n", column, &characters_read);
+	if (characters_read != (int) strlen(input_buffer->buffer)) {
+		char name[TABLE_NAME_MAX_LENGTH + 1];
+		characters_read = -1;
+		sscanf(input_buffer->buffer, "create index on %15s (%15[^)])%n", name, column, &characters_read);
+		if (characters_read != (int) strlen(input_buffer->buffer)) {
+			return SYNTAX_ERROR;
+		}
+		ParsingResult result = find_statement_table(name, database, statement);
+		if (result != RECOGNIZED) {
+			return result;
+		}
+	}
+
+	Schema* schema = &statement->table->schema;
+	uint32_t column_num;
+	if (!find_indexed_column(column, &statement->column) || !find_column(schema, column, &column_num) ||
+		schema->columns[column_num].type == COLUMN_INT) {
+		return SYNTAX_ERROR;
+	}
+	return RECOGNIZED;
+}
+
+/* 
+	determines the validity of the SQL create table statement, which
+	is "create table NAME (id int, COLUMN TYPE, ...)", where a TYPE is
+	int, char(N) or varchar(N) -- or just "create table NAME" for a
+	table with the first table's columns
+
+	input_buffer: pointer to InputBuffer with create command
+	statement: pointer to a Statement struct with the command type
+	returns: an enum representing whether the command was parsed correctly
+*/
+ParsingResult check_create_table(InputBuffer* input_buffer, Statement* statement) {
+	statement->type = STATEMENT_CREATE_TABLE;
+	char* name = input_buffer->buffer + strlen("create table ");
+	char* columns = strchr(name, ' ');
+	if (columns != NULL) {
+		*columns = '\0';
+		columns++;
+	}
+	ParsingResult result = parse_table_name(name, statement);
+	if (result != RECOGNIZED) {
+		return result;
+	}
+
+	if (columns == NULL) {
+		set_default_schema(&statement->schema);
+		return RECOGNIZED;
+	}
+	return parse_schema(columns, &statement->schema);
+}
 
 /* 
 	determines the validity of the SQL statement
 
 	input_buffer: pointer to InputBuffer with command
 	statement: pointer to a Statement struct with the command type
+	database: pointer to a Database struct with the tables
 	returns: an enum representing whether the command was parsed correctly
 */
-ParsingResult check_statement(InputBuffer* input_buffer, Statement* statement) {
+ParsingResult check_statement(InputBuffer* input_buffer, Statement* statement, Database* database) {
+	/* a statement is about the first table unless it names another */
+	statement->table = database->tables[0];
+
 	/* strncmp used because insert will be followed by data */
 	if (strncmp(input_buffer->buffer, "insert", 6) == 0) {
-		return check_insert(input_buffer, statement);
+		return check_insert(input_buffer, statement, database);
 	} 
-	else if (strcmp(input_buffer->buffer, "select") == 0) {
-		statement->type = STATEMENT_SELECT;
-		return RECOGNIZED;
+	else if (strcmp(input_buffer->buffer, "select") == 0
+		|| strncmp(input_buffer->buffer, "select ", 7) == 0) {
+		return check_select(input_buffer, statement, database);
+	}
+	else if (strcmp(input_buffer->buffer, "delete") == 0
+		|| strncmp(input_buffer->buffer, "delete ", 7) == 0) {
+		return check_delete(input_buffer, statement, database);
+	}
+	else if (strncmp(input_buffer->buffer, "create index ", 13) == 0) {
+		return check_create_index(input_buffer, statement, database);
+	}
+	else if (strncmp(input_buffer->buffer, "create table ", 13) == 0) {
+		return check_create_table(input_buffer, statement);
 	}
 
 	return UNRECOGNIZED;
 }
 
+/* qsort() comparator for rows, ordered by id */
+int compare_rows(const void* a, const void* b) {
+	uint32_t id_a = ((Row*)a)->id;
+	uint32_t id_b = ((Row*)b)->id;
+	return (id_a > id_b) - (id_a < id_b);
+}
+
 /* 
-	executes the INSERT SQL statement
+	executes the INSERT SQL statement -- the rows are sorted and
+	grouped by the leaf they belong in, so the tree is walked once per
+	leaf rather than once per row
 
 	statement: pointer to a Statement struct with the command
 	table: pointer to a Table struct with the desired data
 	returns: status code signifying the success of execution
 */
 ExecuteResult execute_insert(Statement* statement, Table* table) {
-	void* node = get_page(table->pager, table->root_page_num);
-
-	/* create objects necessary to execute the insert statement */
-	Row* row_to_insert = &(statement->row_to_insert);
-	uint32_t key_to_insert = row_to_insert->id;
-	Cursor* cursor = find_key_in_table(table, key_to_insert);
-
-	/* check if the insert location is before existing cells */
-	if (cursor->cell_num < (*get_leaf_num_cells(node))) {
-		/* if the key at the insert location is the same key
-		that's being inserted, we throw an error*/
-		uint32_t key_at_index = *get_leaf_key(node, cursor->cell_num);
-		if (key_at_index == key_to_insert) {
+	Row* rows = statement->rows_to_insert;
+	uint32_t num_rows = statement->num_rows_to_insert;
+
+	qsort(rows, num_rows, sizeof(Row), compare_rows);
+	for (uint32_t i = 1; i < num_rows; i++) {
+		if (rows[i].id == rows[i - 1].id) {
 			return EXECUTE_DUPLICATE_KEY;
 		}
 	}
 
-	/* insert the new cell into the given node */
-	insert_cell_in_leaf(cursor, row_to_insert->id, row_to_insert);
+	/* find each group's leaf and check it for duplicates before
+	changing anything, so a bad row leaves the table untouched */
+	uint32_t* group_pages = malloc(num_rows * sizeof(uint32_t));
+	uint32_t* group_ends = malloc(num_rows * sizeof(uint32_t));
+	uint32_t num_groups = 0;
+	ExecuteResult result = EXECUTE_SUCCESS;
+	for (uint32_t start = 0; start < num_rows; ) {
+		uint32_t upper_bound;
+		bool has_upper_bound;
+		uint32_t page_num = find_leaf_with_bound(table, rows[start].id, &upper_bound, &has_upper_bound);
+
+		/* the group runs until a row falls past the leaf's bound */
+		uint32_t end = start + 1;
+		while (end < num_rows && (!has_upper_bound || rows[end].id <= upper_bound)) {
+			end++;
+		}
 
-	/* free the Cursor object to prevent a memory leak */
-	free(cursor);
+		void* node = get_page(table->pager, page_num);
+		bool duplicate = leaf_has_any_key(node, rows + start, end - start);
+		release_write_latches(table->pager);
+		if (duplicate) {
+			result = EXECUTE_DUPLICATE_KEY;
+			break;
+		}
 
-	return EXECUTE_SUCCESS;
+		group_pages[num_groups] = page_num;
+		group_ends[num_groups] = end;
+		num_groups++;
+		start = end;
+	}
+
+	/* splitting a leaf only hands its own key range to new leaves, so
+	the leaves found for the later groups are still the right ones --
+	in concurrent mode, a group that splits its leaf latches the path
+	down to it first, and the group's latches go once it's in */
+	if (result == EXECUTE_SUCCESS) {
+		uint32_t start = 0;
+		for (uint32_t group = 0; group < num_groups; group++) {
+			void* node = get_page(table->pager, group_pages[group]);
+			if (!rows_fit_in_leaf(table->pager, node, rows + start, group_ends[group] - start)) {
+				latch_path_for_write(table->pager, group_pages[group]);
+			}
+			insert_rows_in_leaf(table, group_pages[group], rows + start, group_ends[group] - start);
+			release_write_latches(table->pager);
+			start = group_ends[group];
+		}
+		add_rows_to_indexes(table, rows, num_rows);
+	}
+
+	free(group_pages);
+	free(group_ends);
+	return result;
 }
 
 /* 
@@ -176,133 +663,269 @@ ExecuteResult execute_insert(Statement* statement, Table* table) {
 	returns: status code signifying the success of execution
 */
 ExecuteResult execute_select(Statement* statement, Table* table) {
+	if (statement->aggregate != AGGREGATE_NONE) {
+		return execute_aggregate(statement, table);
+	}
+	if (statement->by_value) {
+		return execute_select_by_value(statement, table);
+	}
+
+	/* with scan threads, the range is split between them */
+	if (table->pager->scan_threads > 1) {
+		parallel_select(table, statement->first_id, statement->last_id, statement->unordered,
+			&statement->projection);
+		return EXECUTE_SUCCESS;
+	}
   
 	/* create objects necessary to execute the select statement */
-	Row row;
-	Cursor* cursor = get_table_start(table);
+	Cursor* cursor = find_range_in_table(table, statement->first_id, statement->last_id);
   
-  /* it "selects" every single row */
+  /* it "selects" every row in the range (every single row by default),
+  printing the wanted columns of each straight out of its leaf */
 	while (!(cursor->end_of_table)) {
-		deserialize_row(get_cursor_value(cursor), &row);
-		print_row(&row);
+		print_row(&table->schema, &statement->projection, get_cursor_value(cursor));
 		advance_cursor(cursor);
 	}
 
 	/* free the Cursor object to prevent a memory leak */
-	free(cursor);
+	close_cursor(cursor);
 
 	return EXECUTE_SUCCESS;
 }
 
 /* 
-	call functions to execute the SQL statement based on the keyword
+	prints every row whose column holds the statement's value, using
+	the column's index if it has one
 
-	statement: pointer to a Statement struct with the command type
+	statement: pointer to a Statement struct with the column and value
 	table: pointer to a Table struct with the desired data
 	returns: status code signifying the success of execution
 */
-ExecuteResult execute_statement(Statement* statement, Table* table) {
-  switch (statement->type) {
-    case (STATEMENT_INSERT):
-    	return execute_insert(statement, table);
-    case (STATEMENT_SELECT):
-    	return execute_select(statement, table);
-  }
-}
+ExecuteResult execute_select_by_value(Statement* statement, Table* table) {
+	Schema* schema = &table->schema;
+	uint32_t column_num = statement->value_column;
+	Cursor* cursor;
+	IndexColumn column;
+	Table* index = NULL;
+	if (find_indexed_column(schema->columns[column_num].name, &column)) {
+		index = __atomic_load_n(&table->indexes[column], __ATOMIC_ACQUIRE);
+	}
 
-/* 
-	serializes the given row at the given location
+	/* the index hands over every id with the value's hash, so each
+	row is checked against the value itself */
+	if (index != NULL) {
+		uint32_t* ids;
+		uint32_t num_ids = find_ids_in_index(index,
+			hash_index_value(statement->value, strlen(statement->value)), &ids);
+		for (uint32_t i = 0; i < num_ids; i++) {
+			cursor = find_key_in_table(table, ids[i]);
+			void* node = cursor->node;
+			if (cursor->cell_num < *get_leaf_num_cells(node) && *get_leaf_key(node, cursor->cell_num) == ids[i]) {
+				void* value = get_cursor_value(cursor);
+				if (column_holds_value(schema, value, column_num, statement->value)) {
+					print_row(schema, &statement->projection, value);
+				}
+			}
+			close_cursor(cursor);
+		}
+		free(ids);
+		return EXECUTE_SUCCESS;
+	}
 
-	source: pointer to the Row we want to serialize
-	destination: pointer to where the serialized row should be stored
-*/
-void serialize_row(Row* source, void* destination) {
-  memcpy(destination + ID_OFFSET, &(source->id), ID_SIZE);
-  memcpy(destination + USERNAME_OFFSET, &(source->username), USERNAME_SIZE);
-  memcpy(destination + EMAIL_OFFSET, &(source->email), EMAIL_SIZE);
+	/* without an index to go on, every row is checked */
+	cursor = get_table_start(table);
+	while (!(cursor->end_of_table)) {
+		void* value = get_cursor_value(cursor);
+		if (column_holds_value(schema, value, column_num, statement->value)) {
+			print_row(schema, &statement->projection, value);
+		}
+		advance_cursor(cursor);
+	}
+	close_cursor(cursor);
+	return EXECUTE_SUCCESS;
 }
 
 /* 
-	deserializes the given row at the given location
+	executes an aggregate select, which prints a row with one value
+	-- NULL if there are no rows for min, max or sum
 
-	source: pointer to the serialized Row we want to deserialize
-	destination: pointer to where the deserialized row should be stored
+	statement: pointer to a Statement struct with the aggregate
+	table: pointer to a Table struct with the desired data
+	returns: status code signifying the success of execution
 */
-void deserialize_row(void* source, Row* destination) {
-	memcpy(&(destination->id), source + ID_OFFSET, ID_SIZE);
-	memcpy(&(destination->username), source + USERNAME_OFFSET, USERNAME_SIZE);
-	memcpy(&(destination->email), source + EMAIL_OFFSET, EMAIL_SIZE);
+ExecuteResult execute_aggregate(Statement* statement, Table* table) {
+	uint32_t first_id = statement->first_id;
+	uint32_t last_id = statement->last_id;
+	AggregateTotals totals;
+	uint32_t key;
+
+	OutputBuffer* output = get_standard_output();
+	begin_output_row(output);
+	switch (statement->aggregate) {
+		case (AGGREGATE_COUNT):
+			total_keys(table, first_id, last_id, false, &totals);
+			write_int_value(output, totals.count, sizeof(uint64_t));
+			break;
+		case (AGGREGATE_SUM):
+			total_keys(table, first_id, last_id, true, &totals);
+			if (totals.count == 0) {
+				write_null_value(output);
+			} else {
+				write_int_value(output, totals.sum, sizeof(uint64_t));
+			}
+			break;
+		case (AGGREGATE_MIN):
+			if (find_min_key_in_range(table, first_id, last_id, &key)) {
+				write_int_value(output, key, sizeof(uint32_t));
+			} else {
+				write_null_value(output);
+			}
+			break;
+		case (AGGREGATE_MAX):
+			if (find_max_key_in_range(table, first_id, last_id, &key)) {
+				write_int_value(output, key, sizeof(uint32_t));
+			} else {
+				write_null_value(output);
+			}
+			break;
+		case (AGGREGATE_NONE):
+			break;
+	}
+	end_output_row(output);
+	return EXECUTE_SUCCESS;
 }
 
-/* prints the columns in the given row */
-void print_row(Row* row) {
-	printf("(%d, %s, %s)\n", row->id, row->username, row->email);
-}
+/* 
+	deletes every row whose id falls in the statement's range, a leaf
+	at a time
 
-/* */
-int main(int argc, char* argv[]) {
+	statement: pointer to a Statement struct with the id range
+	table: pointer to a Table struct with the desired data
+	returns: status code signifying the success of execution
+*/
+ExecuteResult execute_delete(Statement* statement, Table* table) {
+	uint32_t next_key = statement->first_id;
+	uint32_t last_key = statement->last_id;
 
-	/* require that the user specify a DB filename */
-	if (argc < 2) {
-		printf("Must supply a database filename.\n");
-		exit(EXIT_FAILURE);
-	}
+	while (true) {
+		Cursor* cursor = find_key_in_table(table, next_key);
+		uint32_t page_num = cursor->page_num;
+		uint32_t first_cell = cursor->cell_num;
+		close_cursor(cursor);
+
+		/* the doomed rows are a run of cells starting at the cursor */
+		void* node = get_page(table->pager, page_num);
+		uint32_t num_cells = *get_leaf_num_cells(node);
+		uint32_t end_cell = first_cell;
+		while (end_cell < num_cells && *get_leaf_key(node, end_cell) <= last_key) {
+			end_cell++;
+		}
 
-	/* initialize variables */
-	Statement statement;
-	InputBuffer* input_buffer = new_input_buffer();
-	char* filename = argv[1];
-	Table* table = open_database(filename);
+		/* if the run reaches the end of the leaf, the range may carry
+		on into the next one -- note where before the tree gets shuffled */
+		uint32_t next_page_num = *get_next_leaf_of_given_leaf(node);
+		bool range_continues = (end_cell == num_cells && next_page_num != 0);
+		if (range_continues) {
+			void* next_leaf = get_page(table->pager, next_page_num);
+			next_key = *get_leaf_key(next_leaf, 0);
+			range_continues = (next_key <= last_key);
+		}
 
-	/* read standard input into the buffer until "-exit" is read */
-	while (true) {
+		if (end_cell > first_cell) {
+			/* in concurrent mode, a delete that shrinks the leaf too
+			far or changes its max key latches the path down to it */
+			node = get_page(table->pager, page_num);
+
+			/* the indexes need the doomed rows' values, which are
+			gone once the cells are */
+			uint32_t num_doomed = table_has_indexes(table) ? end_cell - first_cell : 0;
+			Row* doomed_rows = malloc(num_doomed * sizeof(Row));
+			for (uint32_t i = 0; i < num_doomed; i++) {
+				deserialize_row(get_leaf_value(node, first_cell + i),
+					*get_leaf_cell_length(node, first_cell + i), &doomed_rows[i]);
+			}
 
-		/* ask for input to get something to store in the DB */
-		print_prompt();
-		read_input(input_buffer);
-
-		/* determine if the input was a command or statement (commands
-		have a "mk_" prefix */
-		if (input_buffer->buffer[0] == 'm' && input_buffer->buffer[1] == 'k') {
-			switch (implement_command(input_buffer, table)) {
-				case (META_COMMAND_SUCCESS):
-					continue;
-				case (META_COMMAND_UNRECOGNIZED):
-					printf("Look at you, trying to invent commands: '%s'\n", input_buffer->buffer);
-					continue;
+			if (!delete_stays_in_leaf(table->pager, node, first_cell, end_cell)) {
+				latch_path_for_write(table->pager, page_num);
 			}
+			delete_cells_in_leaf(table, page_num, first_cell, end_cell);
+			release_write_latches(table->pager);
+			remove_rows_from_indexes(table, doomed_rows, num_doomed);
+			free(doomed_rows);
 		}
+		release_write_latches(table->pager);
 
-		/* if we've gotten here, the input was not a command */
-		switch (check_statement(input_buffer, &statement)) {
-			case (RECOGNIZED):
-				break;
-			case (UNRECOGNIZED):
-				printf("Look at you, trying to invent statements: '%s'\n", input_buffer->buffer);	
-				continue;
-			case (SYNTAX_ERROR):
-				printf("That syntax is wack\n");
-		        continue;
-	        case (STRING_TOO_LONG):
-	        	printf("Your strings are coming on a little too long\n");
-	        	continue;
-        	case (NEGATIVE_ID):
-        		printf("I like my IDs like I like my attitudes: positive\n");
-        		continue;
+		if (!range_continues) {
+			return EXECUTE_SUCCESS;
 		}
-
-		/* execute recognized statement */
-		switch (execute_statement(&statement, table)) {
-			case (EXECUTE_SUCCESS):
-				printf("Executed!\n");
-				break;
-			case (EXECUTE_TABLE_FULL):
-				printf("Error: the table ate too much for dinner\n");
-				break;
-			case (EXECUTE_DUPLICATE_KEY):
-				printf("Error: I don't like seconds\n");
-				break;
-    	}
 	}
 }
 
+/* 
+	call functions to execute the SQL statement based on the keyword
+
+	statement: pointer to a Statement struct with the command type
+	table: pointer to a Table struct with the desired data
+	returns: status code signifying the success of execution
+*/
+ExecuteResult execute_statement(Statement* statement, Table* table) {
+  uint64_t start_ns = get_time_ns();
+  ExecuteResult result = EXECUTE_SUCCESS;
+
+  /* in concurrent mode, only one thread at a time changes the table */
+  bool writing = (statement->type != STATEMENT_SELECT);
+  if (writing) {
+  	begin_write(table->pager);
+  }
+  switch (statement->type) {
+    case (STATEMENT_INSERT):
+    	result = execute_insert(statement, table);
+    	break;
+    case (STATEMENT_SELECT):
+    	result = execute_select(statement, table);
+    	break;
+    case (STATEMENT_DELETE):
+    	result = execute_delete(statement, table);
+    	break;
+    case (STATEMENT_CREATE_INDEX):
+    	result = create_index(table, statement->column);
+    	break;
+    case (STATEMENT_CREATE_TABLE):
+    	/* run_statement() sends these to the catalog instead */
+    	break;
+  }
+
+  /* with the WAL on, this is where the statement's changes are logged;
+  the next writer can log its own while this one waits for the sync */
+  WalCommit commit = log_statement(table->pager);
+  if (writing) {
+  	end_write(table->pager);
+  }
+  wait_for_commit(table->pager, commit);
+  record_statement_time(table->pager, get_time_ns() - start_ns);
+  return result;
+}
+
+/* 
+	executes a statement against the table it was parsed for -- or,
+	for a create table, against the catalog
+
+	statement: pointer to a Statement struct with the command type
+	database: pointer to a Database struct with the tables
+	returns: status code signifying the success of execution
+*/
+ExecuteResult run_statement(Statement* statement, Database* database) {
+	if (statement->type == STATEMENT_CREATE_TABLE) {
+		uint64_t start_ns = get_time_ns();
+		Pager* pager = database->pager;
+		begin_write(pager);
+		ExecuteResult result = create_table(database, statement->table_name, &statement->schema);
+		WalCommit commit = log_statement(pager);
+		end_write(pager);
+		wait_for_commit(pager, commit);
+		record_statement_time(pager, get_time_ns() - start_ns);
+		return result;
+	}
+
+	return execute_statement(statement, statement->table);
+}
@@ -16,25 +16,146 @@ at Olin College of Engineering.
 #include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include <linux/io_uring.h>
 
 
-/* values for a Row struct */
+/* values for the columns of the first table, which every table had
+before tables got columns of their own */
 #define COLUMN_USERNAME_SIZE 32
 #define COLUMN_EMAIL_SIZE 255
 
-/* values that structure the hardcoded example table */
+/* values that structure a row -- see schema.c; the ints and the
+fixed-size strings come first, at offsets worked out once per table,
+then each varchar as a one-byte length and its characters, so short
+strings don't carry their unused space around. The first table's rows
+are its id, then the username and the email as varchars */
 #define size_of_attribute(Struct, Attribute) sizeof(((Struct*)0)->Attribute)
 #define ID_SIZE size_of_attribute(Row, id)
-#define USERNAME_SIZE size_of_attribute(Row, username)
-#define EMAIL_SIZE size_of_attribute(Row, email)
-#define ID_OFFSET 0
-#define USERNAME_OFFSET (ID_OFFSET + ID_SIZE)
-#define EMAIL_OFFSET (USERNAME_OFFSET + USERNAME_SIZE)
-#define ROW_SIZE (ID_SIZE + USERNAME_SIZE + EMAIL_SIZE)
+#define INT_COLUMN_SIZE sizeof(int32_t)
+#define STRING_LENGTH_SIZE sizeof(uint8_t)
+#define MAX_STRING_SIZE 255 /* a varchar's length has to fit in a byte */
+#define MIN_ROW_SIZE (ID_SIZE + 2 * STRING_LENGTH_SIZE)
+#define ROW_SIZE (MIN_ROW_SIZE + COLUMN_USERNAME_SIZE + COLUMN_EMAIL_SIZE) /* the most a first table row can take */
+#define MAX_ROW_SIZE 1024 /* the most any row can take, so a leaf always holds a few */
+#define MAX_COLUMNS 10
+#define COLUMN_NAME_MAX_LENGTH 15
 
-/* values related to a Table struct */
-#define PAGE_SIZE 4096 /* OS pages are also 4KB -> DB page is undivided*/
-#define TABLE_MAX_PAGES 500 /* arbitrary limit for now */
+/* values related to a Table struct -- the page size is picked when
+the DB file is created and kept in its header page, and every size
+that follows from it is worked out when the file is opened (see
+set_page_layout()) */
+#define DEFAULT_PAGE_SIZE 4096 /* OS pages are also 4KB -> DB page is undivided*/
+#define MIN_PAGE_SIZE 4096
+#define MAX_PAGE_SIZE 65536 /* leaf slots hold 16-bit offsets into the page */
+
+/* values related to the pager's buffer pool -- the pool holds at most
+cache_frames pages in memory at once and evicts the rest */
+#define DEFAULT_CACHE_FRAMES 500 /* same 2MB footprint as the old fixed cache */
+#define MIN_CACHE_FRAMES 16 /* enough for a root-to-leaf split plus a cursor */
+#define INVALID_FRAME UINT32_MAX
+#define FLUSH_MAX_RUN_PAGES 64 /* most pages written by one pwritev() */
+#define MMAP_CHUNK_PAGES 256 /* in mmap mode, the file is mapped 1MB at a time */
+#define WRITE_BACK_BATCH_PAGES 32 /* most dirty pages written back by one eviction */
+
+/* values related to the I/O backends */
+#define IO_URING_ENTRIES 64 /* most requests io_uring keeps in flight */
+#define IO_THREADS 4 /* threads in the fallback backend's pool */
+
+/* values related to concurrent readers -- see latch.c */
+#define MAX_TREE_DEPTH 64 /* nodes on a root-to-leaf path, with room to spare */
+
+/* values related to indexes -- see index.c; a key is a hash of the
+column's value, and every row gets a cell of its own holding its id */
+#define NUM_INDEXED_COLUMNS 2
+
+/* values related to the catalog -- see catalog.c */
+#define MAX_TABLES 16
+#define TABLE_NAME_MAX_LENGTH 15
+#define DEFAULT_TABLE_NAME "users" /* the table every file starts with */
+
+/* values related to parallel scans -- see scan.c */
+#define SCAN_PARTITIONS_PER_THREAD 4 /* so a thread that finishes early can take another */
+
+/* values related to the output of results -- see output.c */
+#define OUTPUT_BUFFER_SIZE (256 * 1024) /* standard output is written this much at a time */
+#define OUTPUT_MAX_ROW_SIZE (sizeof(uint32_t) + MAX_COLUMNS * (STRING_LENGTH_SIZE + MAX_STRING_SIZE)) /* a binary row */
+#define MAX_MESSAGE_SIZE 1024
+
+/* values related to the write-ahead log */
+#define WAL_SUFFIX "-wal"
+#define WAL_RECORD_PAGE 0x57414c50 /* "WALP" */
+#define WAL_RECORD_COMMIT 0x57414c43 /* "WALC" */
+#define WAL_MAX_BATCH_PAGES 64 /* most page images appended by one pwritev() */
+#define DEFAULT_GROUP_COMMIT_MS 5
+#define DEFAULT_GROUP_COMMIT_BYTES (1024 * 1024)
+#define DEFAULT_CHECKPOINT_BYTES (16 * 1024 * 1024)
+
+/* values related to statistics -- statement times are kept in
+power-of-two buckets of microseconds, the last one catching anything
+over 2^23 us (about 8 seconds) */
+#define STATS_LATENCY_BUCKETS 24
+
+/* the first page of the file is a header for the whole DB rather
+than a node -- it starts with a magic string and keeps the head of
+the list of free pages, the page size and the version of the file
+format, so the first table's root lives on page 1
+
+the page size and the format version are read before anything else,
+so the fields up to them are read on their own; a file whose format
+version isn't DB_FORMAT_VERSION is turned away, since the layout of
+its pages can't be trusted */
+#define DB_HEADER_PAGE_NUM 0
+#define ROOT_PAGE_NUM 1
+#define DB_MAGIC "diylite\0"
+#define DB_MAGIC_SIZE 8
+#define DB_MAGIC_OFFSET 0
+#define FREE_LIST_HEAD_SIZE sizeof(uint32_t)
+#define FREE_LIST_HEAD_OFFSET (DB_MAGIC_OFFSET + DB_MAGIC_SIZE)
+#define NUM_FREE_PAGES_SIZE sizeof(uint32_t)
+#define NUM_FREE_PAGES_OFFSET (FREE_LIST_HEAD_OFFSET + FREE_LIST_HEAD_SIZE)
+#define DB_PAGE_SIZE_SIZE sizeof(uint32_t)
+#define DB_PAGE_SIZE_OFFSET (NUM_FREE_PAGES_OFFSET + NUM_FREE_PAGES_SIZE)
+#define DB_FORMAT_VERSION_SIZE sizeof(uint32_t)
+#define DB_FORMAT_VERSION_OFFSET (DB_PAGE_SIZE_OFFSET + DB_PAGE_SIZE_SIZE)
+#define DB_HEADER_FIELDS_SIZE (DB_FORMAT_VERSION_OFFSET + DB_FORMAT_VERSION_SIZE)
+#define DB_FORMAT_VERSION 1 /* bump whenever the layout of a page changes */
+
+/* after the fields read on their own, the header holds the catalog:
+an entry per table, each with the root page of each column's index
+(0 if the column has none), the table's own root page, its name and
+its columns; an entry with a 0 root page is unused, and one with no
+columns has the first table's
+
+a column is kept as its name, its type and (for a string) its size */
+#define DB_CATALOG_OFFSET DB_HEADER_FIELDS_SIZE
+#define CATALOG_INDEX_ROOT_SIZE sizeof(uint32_t)
+#define CATALOG_INDEX_ROOTS_OFFSET 0
+#define CATALOG_ROOT_PAGE_SIZE sizeof(uint32_t)
+#define CATALOG_ROOT_PAGE_OFFSET (CATALOG_INDEX_ROOTS_OFFSET + NUM_INDEXED_COLUMNS * CATALOG_INDEX_ROOT_SIZE)
+#define CATALOG_NAME_SIZE (TABLE_NAME_MAX_LENGTH + 1)
+#define CATALOG_NAME_OFFSET (CATALOG_ROOT_PAGE_OFFSET + CATALOG_ROOT_PAGE_SIZE)
+#define CATALOG_NUM_COLUMNS_SIZE sizeof(uint32_t)
+#define CATALOG_NUM_COLUMNS_OFFSET (CATALOG_NAME_OFFSET + CATALOG_NAME_SIZE)
+#define CATALOG_COLUMNS_OFFSET (CATALOG_NUM_COLUMNS_OFFSET + CATALOG_NUM_COLUMNS_SIZE)
+#define CATALOG_COLUMN_NAME_SIZE (COLUMN_NAME_MAX_LENGTH + 1)
+#define CATALOG_COLUMN_NAME_OFFSET 0
+#define CATALOG_COLUMN_TYPE_SIZE sizeof(uint8_t)
+#define CATALOG_COLUMN_TYPE_OFFSET (CATALOG_COLUMN_NAME_OFFSET + CATALOG_COLUMN_NAME_SIZE)
+#define CATALOG_COLUMN_SIZE_SIZE sizeof(uint8_t)
+#define CATALOG_COLUMN_SIZE_OFFSET (CATALOG_COLUMN_TYPE_OFFSET + CATALOG_COLUMN_TYPE_SIZE)
+#define CATALOG_COLUMN_SIZE (CATALOG_COLUMN_SIZE_OFFSET + CATALOG_COLUMN_SIZE_SIZE)
+#define CATALOG_ENTRY_SIZE (CATALOG_COLUMNS_OFFSET + MAX_COLUMNS * CATALOG_COLUMN_SIZE)
+
+/* a free page only holds the number of the next free page (0, the
+header page, ends the list) */
+#define FREE_PAGE_NEXT_OFFSET 0
 
 /* common node headers */
 #define NODE_TYPE_SIZE sizeof(uint8_t)
@@ -50,46 +171,70 @@ at Olin College of Engineering.
 #define LEAF_NODE_NUM_CELLS_OFFSET COMMON_NODE_HEADER_SIZE
 #define LEAF_NODE_NEXT_LEAF_SIZE sizeof(uint32_t)
 #define LEAF_NODE_NEXT_LEAF_OFFSET (LEAF_NODE_NUM_CELLS_OFFSET + LEAF_NODE_NUM_CELLS_SIZE)
-#define LEAF_NODE_HEADER_SIZE (COMMON_NODE_HEADER_SIZE + LEAF_NODE_NUM_CELLS_SIZE + LEAF_NODE_NEXT_LEAF_SIZE)
+#define LEAF_NODE_CELL_CONTENT_START_SIZE sizeof(uint32_t)
+#define LEAF_NODE_CELL_CONTENT_START_OFFSET (LEAF_NODE_NEXT_LEAF_OFFSET + LEAF_NODE_NEXT_LEAF_SIZE)
+#define LEAF_NODE_HEADER_SIZE (COMMON_NODE_HEADER_SIZE + LEAF_NODE_NUM_CELLS_SIZE + LEAF_NODE_NEXT_LEAF_SIZE \
+	+ LEAF_NODE_CELL_CONTENT_START_SIZE)
 
-/* leaf node body -- currently, 12 values can be stored in
-one leaf node with a bit of leftover (wasted) space at the end,
-because we don't want to split up cells between nodes/pages 
+/* leaf node body -- a slotted page: a directory of fixed-size slots
+grows from the header towards the end of the page, and the rows they
+point to are packed into a heap that grows from the end of the page
+back towards the slots
 
-refer to this image to get a visualization of the space allocation
-in each node:
+the slots are kept in key order and hold the keys themselves, so
+searching a leaf never has to touch the heap; rows never move when
+the slots do, and the holes that removed rows leave in the heap are
+only squeezed out when a new row doesn't fit in the gap
+
+refer to this image to get a visualization of the old fixed-size
+layout, which had room for 13 rows however short they were:
 https://cstack.github.io/db_tutorial/assets/images/leaf-node-format.png 
 */
 #define LEAF_NODE_KEY_SIZE sizeof(uint32_t)
 #define LEAF_NODE_KEY_OFFSET 0
-#define LEAF_NODE_VALUE_SIZE ROW_SIZE
-#define LEAF_NODE_VALUE_OFFSET (LEAF_NODE_KEY_OFFSET + LEAF_NODE_KEY_SIZE)
-#define LEAF_NODE_CELL_SIZE (LEAF_NODE_KEY_SIZE + LEAF_NODE_VALUE_SIZE)
-#define LEAF_NODE_SPACE_FOR_CELLS (PAGE_SIZE - LEAF_NODE_HEADER_SIZE)
-#define LEAF_NODE_MAX_CELLS (LEAF_NODE_SPACE_FOR_CELLS / LEAF_NODE_CELL_SIZE)
-#define LEAF_NODE_RIGHT_SPLIT_COUNT ((LEAF_NODE_MAX_CELLS + 1) / 2)
-#define LEAF_NODE_LEFT_SPLIT_COUNT ((LEAF_NODE_MAX_CELLS + 1) - LEAF_NODE_RIGHT_SPLIT_COUNT)
-
-/* internal node headers -- currently, it can fit 510 keys and 
-511 child pointers
-
-refer to this image to get a visualization of the space allocation
-in each node:
+#define LEAF_NODE_CELL_OFFSET_SIZE sizeof(uint16_t)
+#define LEAF_NODE_CELL_OFFSET_OFFSET (LEAF_NODE_KEY_OFFSET + LEAF_NODE_KEY_SIZE)
+#define LEAF_NODE_CELL_LENGTH_SIZE sizeof(uint16_t)
+#define LEAF_NODE_CELL_LENGTH_OFFSET (LEAF_NODE_CELL_OFFSET_OFFSET + LEAF_NODE_CELL_OFFSET_SIZE)
+#define LEAF_NODE_SLOT_SIZE (LEAF_NODE_KEY_SIZE + LEAF_NODE_CELL_OFFSET_SIZE + LEAF_NODE_CELL_LENGTH_SIZE)
+#define LEAF_NODE_MAX_CELL_SIZE (LEAF_NODE_SLOT_SIZE + ROW_SIZE)
+
+/* internal node headers -- with 4KB pages, it can fit 509 keys and 
+510 child pointers (and 8189 keys with 64KB pages)
+
+the keys sit together in one array right after the header, and the
+child pointers in a second array after room for all of the keys, so
+searching a node only reads the keys (the tutorial's layout, in the
+image below, had each key next to its child pointer):
 https://cstack.github.io/db_tutorial/assets/images/internal-node-format.png 
 */
 #define INTERNAL_NODE_NUM_KEYS_SIZE (sizeof(uint32_t))
 #define INTERNAL_NODE_NUM_KEYS_OFFSET COMMON_NODE_HEADER_SIZE
 #define INTERNAL_NODE_RIGHT_CHILD_SIZE sizeof(uint32_t)
 #define INTERNAL_NODE_RIGHT_CHILD_OFFSET (INTERNAL_NODE_NUM_KEYS_OFFSET + INTERNAL_NODE_NUM_KEYS_SIZE)
-#define INTERNAL_NODE_HEADER_SIZE (COMMON_NODE_HEADER_SIZE + INTERNAL_NODE_NUM_KEYS_SIZE + INTERNAL_NODE_RIGHT_CHILD_SIZE)
+#define INTERNAL_NODE_CHILDREN_OFFSET_SIZE sizeof(uint32_t)
+#define INTERNAL_NODE_CHILDREN_OFFSET_OFFSET (INTERNAL_NODE_RIGHT_CHILD_OFFSET + INTERNAL_NODE_RIGHT_CHILD_SIZE)
+#define INTERNAL_NODE_HEADER_SIZE (COMMON_NODE_HEADER_SIZE + INTERNAL_NODE_NUM_KEYS_SIZE + INTERNAL_NODE_RIGHT_CHILD_SIZE \
+	+ INTERNAL_NODE_CHILDREN_OFFSET_SIZE)
 
 /* internal node body values */
 #define INTERNAL_NODE_KEY_SIZE sizeof(uint32_t)
 #define INTERNAL_NODE_CHILD_SIZE sizeof(uint32_t)
 #define INTERNAL_NODE_CELL_SIZE (INTERNAL_NODE_CHILD_SIZE + INTERNAL_NODE_KEY_SIZE)
-#define INTERNAL_NODE_MAX_CELLS 3 /* kept small for testing */
-#define INTERNAL_NODE_RIGHT_SPLIT_COUNT ((INTERNAL_NODE_MAX_CELLS + 1) / 2)
-#define INTERNAL_NODE_LEFT_SPLIT_COUNT ((INTERNAL_NODE_MAX_CELLS + 1) - INTERNAL_NODE_RIGHT_SPLIT_COUNT)
+#define INTERNAL_NODE_KEYS_OFFSET INTERNAL_NODE_HEADER_SIZE
+
+/* values related to searching the keys of a node -- a binary search
+narrows the keys down to a window this big, which is then compared
+a vector at a time */
+#define KEY_SEARCH_WINDOW 16
+
+/* values related to scans -- a scan reads the leaves ahead of it into
+the buffer pool, a few at first and twice as many every leaf it
+moves on, up to max_read_ahead leaves (range scans start smaller,
+since most of them end within a leaf or two) */
+#define DEFAULT_MAX_READ_AHEAD 64
+#define FULL_SCAN_READ_AHEAD 8
+#define RANGE_SCAN_READ_AHEAD 2
 
 /* wrapper needed to store the result of getline() */
 typedef struct InputBuffer_t {
@@ -110,58 +255,524 @@ typedef enum {
 	UNRECOGNIZED,
 	SYNTAX_ERROR,
 	STRING_TOO_LONG,
-	NEGATIVE_ID
+	NEGATIVE_ID,
+	UNKNOWN_TABLE,
+	UNKNOWN_COLUMN
 } ParsingResult;
 
 /* status code for the execution of a statement */
 typedef enum { 
 	EXECUTE_SUCCESS, 
 	EXECUTE_TABLE_FULL,
-	EXECUTE_DUPLICATE_KEY
+	EXECUTE_DUPLICATE_KEY,
+	EXECUTE_UNSORTED_INPUT,
+	EXECUTE_TABLE_NOT_EMPTY,
+	EXECUTE_BAD_ROW,
+	EXECUTE_FILE_ERROR,
+	EXECUTE_INDEX_EXISTS,
+	EXECUTE_TABLE_EXISTS,
+	EXECUTE_CATALOG_FULL
 } ExecuteResult;
 
 /* commands that the SQL compiler understands */
 typedef enum {
 	STATEMENT_INSERT,
-	STATEMENT_SELECT
+	STATEMENT_SELECT,
+	STATEMENT_DELETE,
+	STATEMENT_CREATE_INDEX,
+	STATEMENT_CREATE_TABLE
 } StatementType;
 
-/* set of columns that make up a row in the hardcoded testing table*/
+/* the columns an index can be created on */
+typedef enum {
+	INDEX_USERNAME,
+	INDEX_EMAIL
+} IndexColumn;
+
+/* what a select works out instead of printing rows */
+typedef enum {
+	AGGREGATE_NONE,
+	AGGREGATE_COUNT,
+	AGGREGATE_MIN,
+	AGGREGATE_MAX,
+	AGGREGATE_SUM
+} AggregateType;
+
+/* the types a column can have */
+typedef enum {
+	COLUMN_INT,
+	COLUMN_CHAR, /* a string kept at its full size */
+	COLUMN_VARCHAR /* a string kept at its own length */
+} ColumnType;
+
+/* one of a table's columns */
+typedef struct {
+	char name[COLUMN_NAME_MAX_LENGTH + 1];
+	ColumnType type;
+	uint32_t size; /* most characters a string holds */
+	uint32_t offset; /* where an int or a char starts in a row, or which varchar a varchar is */
+} Column;
+
+/* the columns of a table -- the first is always an int called id,
+which is the table's key -- and the row layout that follows from
+them, worked out once by compile_schema() */
+typedef struct {
+	uint32_t num_columns;
+	Column columns[MAX_COLUMNS];
+	uint32_t fixed_size; /* of the ints and chars, which come first */
+	uint32_t num_varchars;
+	uint32_t max_size; /* the most a row can take */
+} Schema;
+
+/* the columns a select prints, in the order it wants them */
+typedef struct {
+	uint32_t num_columns;
+	uint32_t columns[MAX_COLUMNS]; /* column numbers in the schema */
+	uint32_t num_varchars; /* how many of a row's varchars get walked past to find the wanted ones */
+} Projection;
+
+/* the ways a select's rows can be written out */
+typedef enum {
+	OUTPUT_TEXT, /* (1, user1, person1@example.com) */
+	OUTPUT_TSV,
+	OUTPUT_CSV,
+	OUTPUT_BINARY /* length-prefixed rows of length-prefixed values */
+} OutputFormat;
+
+/* rows on their way out -- standard output's buffer is written to
+its fd whenever it fills up, and a buffer without an fd grows instead */
+typedef struct {
+	char* data;
+	size_t length;
+	size_t capacity;
+	int fd; /* -1 for a buffer that's only kept in memory */
+	OutputFormat format;
+	size_t row_start; /* where the row being written started */
+	uint32_t num_values; /* values written so far in the row */
+} OutputBuffer;
+
+/* a row of any table, encoded the way it's kept in a leaf -- its id
+is the key, so it's kept out here too */
 typedef struct {
 	uint32_t id;
-	/* the +1 makes space for the null character */
-	char username[COLUMN_USERNAME_SIZE + 1];
-	char email[COLUMN_EMAIL_SIZE + 1];
+	uint32_t length;
+	char data[MAX_ROW_SIZE];
 } Row;
 
 /* components of a SQL statement */
 typedef struct {
 	StatementType type;
-	Row row_to_insert;
+	Row* rows_to_insert; /* an insert can carry many rows */
+	uint32_t num_rows_to_insert;
+	uint32_t rows_capacity;
+	uint32_t first_id; /* select/delete only touch ids in [first_id, last_id] */
+	uint32_t last_id;
+	bool unordered; /* a select may print its rows in any order */
+	AggregateType aggregate; /* a select may only want count(*), min(id), ... */
+	IndexColumn column; /* the column of a create index */
+	bool by_value; /* a select only wants the rows whose column holds value */
+	uint32_t value_column;
+	char value[MAX_STRING_SIZE + 1];
+	Projection projection; /* the columns a select prints */
+	struct Table_t* table; /* the table the statement is about */
+	char table_name[TABLE_NAME_MAX_LENGTH + 1]; /* of a create table */
+	Schema schema; /* of a create table */
 } Statement;
 
+/* options chosen when the DB file is opened */
+typedef struct {
+	uint32_t cache_frames; /* size of the buffer pool, in pages; 0 picks one */
+	bool use_mmap; /* read pages already on disk through a file mapping */
+	bool use_wal; /* log every statement to a write-ahead log */
+	uint32_t group_commit_ms; /* longest a commit waits for its fsync */
+	uint32_t group_commit_bytes; /* unsynced WAL bytes that force an fsync */
+	uint32_t checkpoint_bytes; /* WAL size that triggers a checkpoint */
+	uint32_t page_size; /* for a new DB file -- an existing one keeps its own */
+	const char* key_search; /* name of the key search kernel, or NULL to let the CPU decide */
+	uint32_t max_read_ahead; /* most leaves a scan reads ahead, 0 for none */
+	const char* io_backend; /* name of the I/O backend, or NULL for the best one there is */
+	bool concurrent; /* let many threads read while one writes */
+	uint32_t scan_threads; /* threads a select splits its scan between */
+} DatabaseOptions;
+
+/* bookkeeping for one slot (frame) of the buffer pool */
+typedef struct {
+	uint32_t page_num; /* page held by the frame */
+	uint32_t pin_count; /* frames with pins are never evicted */
+	bool referenced; /* CLOCK bit, set on every access */
+	bool dirty; /* the page must be written back before eviction */
+	bool in_statement; /* changed by a statement that hasn't committed */
+	bool loading; /* claimed, but the page hasn't been read into it yet */
+	uint32_t next_in_bucket; /* chains frames that share a hash bucket */
+	void* data;
+	/* in concurrent mode, readers latch the page for reading and the
+	writer for writing; the writer also keeps what it touches pinned
+	until the end of its step */
+	pthread_rwlock_t latch;
+	bool held_by_writer;
+	bool write_latched;
+} Frame;
+
+/* one piece of the file mapping used in mmap mode */
+typedef struct {
+	void* data; /* NULL until a page in the chunk is first used */
+	uint8_t dirty[MMAP_CHUNK_PAGES / 8]; /* one bit per modified page */
+} MappedChunk;
+
+/* one read or write of a run of pages, for an I/O backend to carry out */
+typedef struct {
+	bool is_write;
+	off_t offset; /* where the run starts in the DB file */
+	struct iovec* iov; /* one buffer per page */
+	uint32_t iov_count;
+	size_t length; /* total bytes in the buffers */
+	ssize_t result; /* bytes read or written, or -errno */
+} IoRequest;
+
+/* a way of carrying out batches of I/O requests -- see io.c */
+typedef struct IoBackend_t {
+	const char* name;
+	int file_descriptor;
+	void (*run)(struct IoBackend_t* backend, IoRequest* requests, uint32_t num_requests);
+	void (*close)(struct IoBackend_t* backend);
+	void* state; /* whatever the backend needs to keep */
+	pthread_mutex_t lock; /* a backend runs one batch at a time */
+} IoBackend;
+
+/* the state behind the io_uring backend -- the rings are shared with
+the kernel, which moves the submission head and completion tail */
+typedef struct {
+	int ring_fd;
+	uint32_t num_entries;
+	void* sq_ring;
+	size_t sq_ring_size;
+	uint32_t* sq_tail;
+	uint32_t* sq_mask;
+	uint32_t* sq_array;
+	struct io_uring_sqe* sqes;
+	size_t sqes_size;
+	void* cq_ring;
+	size_t cq_ring_size;
+	uint32_t* cq_head;
+	uint32_t* cq_tail;
+	uint32_t* cq_mask;
+	struct io_uring_cqe* cqes;
+} IoUring;
+
+/* the state behind the thread pool backend -- the batch being worked
+on and how far along it is are guarded by the lock */
+typedef struct {
+	pthread_t threads[IO_THREADS];
+	pthread_mutex_t lock;
+	pthread_cond_t work_ready;
+	pthread_cond_t work_done;
+	IoRequest* requests;
+	uint32_t num_requests;
+	uint32_t next_request;
+	uint32_t num_done;
+	bool closing;
+} IoThreadPool;
+
+/* a modified page waiting to be written by write_dirty_pages() */
+typedef struct {
+	uint32_t page_num;
+	void* data;
+	Frame* frame; /* NULL for pages that live in the file mapping */
+} DirtyPage;
+
+/* every record in the WAL starts with this header; page records are
+followed by the page image */
+typedef struct {
+	uint32_t type; /* WAL_RECORD_PAGE or WAL_RECORD_COMMIT */
+	uint32_t page_num; /* for commit records, the number of pages logged */
+	uint64_t txn_id; /* statement the record belongs to */
+	uint32_t checksum;
+	uint32_t reserved;
+} WalRecordHeader;
+
+/* a page whose latest image is in the WAL rather than the DB file */
+typedef struct {
+	uint32_t page_num;
+	off_t offset; /* of the image; 0 for an empty slot, -1 once the DB file has it */
+} LoggedPage;
+
+/* components of the write-ahead log */
+typedef struct {
+	int file_descriptor;
+	char* path;
+	/* the lock guards the lengths, since the flusher thread syncs 
+	while the statement thread appends */
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t synced; /* broadcast whenever a sync finishes */
+	pthread_t flusher;
+	bool stopping;
+	uint32_t num_syncing; /* fsyncs in progress */
+	uint32_t num_waiting; /* commits waiting on somebody else's fsync */
+	off_t length; /* bytes appended */
+	off_t synced_length; /* bytes known to be on disk */
+	uint64_t generation; /* bumped every time a checkpoint empties the WAL */
+	uint64_t next_txn_id;
+	uint32_t group_commit_ms;
+	uint32_t group_commit_bytes;
+	uint32_t checkpoint_bytes;
+	uint64_t num_syncs; /* fsyncs of the WAL, for the stats */
+	/* pages evicted before their statement committed have nowhere to
+	go but the WAL, so they're read back from there -- a hash table
+	by page number, emptied by every checkpoint */
+	LoggedPage* logged_pages;
+	uint32_t logged_pages_capacity;
+	uint32_t num_logged_pages; /* slots in use, forgotten ones included */
+	uint32_t statement_records; /* page records the running statement has logged already */
+} Wal;
+
+/* where a statement's commit record ends in the WAL, so it can wait
+for the record to be synced after letting the next writer in */
+typedef struct {
+	off_t end; /* 0 if nothing was logged */
+	uint64_t generation;
+} WalCommit;
+
+/* counters behind mk_stats */
+typedef struct {
+	uint64_t cache_hits;
+	uint64_t cache_misses;
+	uint64_t pages_read;
+	uint64_t bytes_read;
+	uint64_t pages_read_ahead; /* read by scans ahead of being asked for */
+	uint64_t pages_written;
+	uint64_t bytes_written;
+	uint64_t wal_bytes_written;
+	uint64_t fsyncs; /* of the DB file -- the WAL counts its own */
+	uint64_t leaf_splits;
+	uint64_t internal_splits;
+	uint64_t root_splits;
+	uint64_t leaf_merges;
+	uint64_t internal_merges;
+	uint64_t statements;
+	uint64_t statement_ns;
+	uint64_t max_statement_ns;
+	uint64_t statement_latencies[STATS_LATENCY_BUCKETS];
+} Stats;
+
 /* components of the table pager (keeps track of pages in table) */
 typedef struct {
 	int file_descriptor;
-	uint32_t file_length;
+	off_t file_length;
 	uint32_t num_pages;
-	void* pages[TABLE_MAX_PAGES];
+	IoBackend* io; /* every page read and write goes through it */
+	/* the DB's page size and the node layout that follows from it */
+	uint32_t page_size;
+	uint32_t leaf_node_space_for_cells;
+	uint32_t leaf_node_max_cells; /* if every row were as short as can be */
+	uint32_t leaf_node_min_space_used; /* less and a delete rebalances the leaf */
+	uint32_t internal_node_max_cells;
+	uint32_t internal_node_min_cells;
+	/* buffer pool -- frames are handed out in order until the pool
+	is full, then the CLOCK hand picks unpinned frames to evict */
+	Frame* frames;
+	uint32_t num_frames;
+	uint32_t frames_in_use;
+	uint32_t clock_hand;
+	/* hash table from page number to frame index */
+	uint32_t* buckets;
+	uint32_t num_buckets;
+	/* file mapping for mmap mode -- pages already on disk are served
+	straight from the mapping instead of being copied into frames */
+	bool use_mmap;
+	MappedChunk* chunks;
+	uint32_t num_chunks;
+	uint32_t num_dirty_mapped_pages; /* private copies the OS is holding for us */
+	uint32_t max_read_ahead;
+	uint32_t scan_threads;
+	/* write-ahead log, or NULL when it's off, and the pages changed
+	by the statement that is running */
+	Wal* wal;
+	uint32_t* statement_pages;
+	uint32_t num_statement_pages;
+	uint32_t statement_pages_capacity;
+	/* concurrent mode -- the pool mutex guards the buffer pool's
+	bookkeeping and the stats, and the frames the writer is holding
+	are listed so they can all be let go at the end of its step */
+	bool concurrent;
+	pthread_mutex_t pool_lock;
+	pthread_mutex_t writer_lock;
+	uint32_t* writer_frames;
+	uint32_t num_writer_frames;
+	/* statistics, and the file they're dumped to every so often
+	(NULL when nobody asked for a dump) */
+	Stats stats;
+	FILE* stats_dump_file;
+	uint64_t stats_dump_interval_ns;
+	uint64_t last_stats_dump_ns;
 } Pager;
 
-/* components of a SQL table */
-typedef struct {
+/* components of a SQL table -- an index is a Table too, with its
+own root in the same file */
+typedef struct Table_t {
   Pager* pager;
   uint32_t root_page_num;
+  struct Table_t* indexes[NUM_INDEXED_COLUMNS]; /* NULL if the column has none */
+  uint32_t catalog_entry; /* the table's entry in the catalog */
+  char name[TABLE_NAME_MAX_LENGTH + 1];
+  Schema schema;
 } Table;
 
-/* represents a location within the table */
+/* an open DB file -- every table in it shares the one pager, and so
+the one buffer pool */
+typedef struct {
+  Pager* pager;
+  Table* tables[MAX_TABLES]; /* in catalog order; the first is the default */
+  uint32_t num_tables;
+} Database;
+
+/* represents a location within the table -- the cursor keeps its
+current leaf latched (or just pinned) until close_cursor(), so the
+leaf stays put in the cache */
 typedef struct {
   Table* table;
   uint32_t page_num; /* location of node */
+  void* node; /* the leaf itself */
   uint32_t cell_num; /* location of value */
   bool end_of_table;
+  uint32_t last_key; /* the cursor stops after passing this key */
+  /* read-ahead for scans -- the leaves up to (not including) child
+  read_ahead_end of the parent node have been asked for already */
+  uint32_t read_ahead; /* leaves to ask for ahead of the cursor, 0 for none */
+  uint32_t read_ahead_parent;
+  uint32_t read_ahead_end;
 } Cursor;
 
+/* a leaf cell copied out of its page while leaves are rebuilt */
+typedef struct {
+	uint32_t key;
+	uint32_t length; /* of the serialized row */
+	void* value; /* points at the serialized row */
+} LeafCell;
+
+/* a row's index key and id, while an index is being built */
+typedef struct {
+	uint32_t key;
+	uint32_t id;
+} IndexEntry;
+
+/* a finished node waiting for its parent during a bulk load */
+typedef struct {
+	uint32_t page_num;
+	uint32_t max_key;
+} BulkChild;
+
+/* the children buffered for one level of internal nodes */
+typedef struct {
+	BulkChild* children;
+	uint32_t num_children;
+	uint32_t num_nodes_written;
+} BulkLevel;
+
+/* builds a tree from the bottom up out of rows sorted by id */
+typedef struct {
+	Table* table;
+	uint32_t leaf_capacity; /* bytes of cells per leaf */
+	uint32_t internal_capacity; /* children per internal node */
+	uint32_t leaf_page_num; /* leaf being filled */
+	bool leaf_in_root; /* the first leaf lives in the root page */
+	uint32_t rows_in_leaf;
+	uint32_t space_in_leaf; /* bytes of cells in the leaf being filled */
+	uint64_t num_rows;
+	uint32_t last_key;
+	bool duplicate_keys; /* an index's keys repeat, a table's can't */
+	BulkLevel* levels; /* levels[0] sits right above the leaves */
+	uint32_t num_levels;
+} BulkLoader;
+
+/* one range of keys in a parallel scan, and the subtree it came
+from when the scan was planned */
+typedef struct {
+	uint32_t page_num;
+	uint32_t first_key;
+	uint32_t last_key;
+} ScanPartition;
+
+/* a parallel scan -- the visitor scans one partition, and is called
+from whichever scan thread takes it */
+typedef struct ParallelScan {
+	Table* table;
+	ScanPartition* partitions; /* in key order */
+	uint32_t num_partitions;
+	uint32_t next_partition; /* the next one a thread can take */
+	void (*visit)(struct ParallelScan* scan, uint32_t partition);
+	void* arg; /* whatever the visitor needs */
+} ParallelScan;
+
+/* the rows of a parallel select, waiting their turn to be printed */
+typedef struct {
+	bool unordered;
+	char** buffers; /* one per partition, freed once it's printed */
+	size_t* lengths;
+	bool* finished;
+	uint32_t next_to_write; /* first partition that hasn't been printed */
+	pthread_mutex_t lock;
+	Projection* projection;
+} SelectOutput;
+
+/* what count(*) and sum(id) add up over a range of keys */
+typedef struct {
+	uint64_t count;
+	uint64_t sum;
+} AggregateTotals;
+
+/* the totals of a parallel count or sum, one per partition */
+typedef struct {
+	bool with_sum; /* a count doesn't need to look at the keys */
+	AggregateTotals* totals;
+} AggregateScan;
+
+/* settings for a run of the benchmark */
+typedef struct {
+	char* db_path;
+	uint32_t num_rows; /* rows in the table for the read workloads */
+	uint32_t num_ops; /* lookups, range scans or mixed operations */
+	uint32_t num_full_scans;
+	uint32_t range_length; /* rows per range scan */
+	uint32_t write_percent; /* share of the mixed workload that inserts */
+	uint32_t num_readers; /* reader threads in the concurrent workload */
+	bool cold; /* drop the DB file from the OS cache before every full scan */
+	uint64_t seed;
+	DatabaseOptions database_options;
+} BenchOptions;
+
+/* what a workload measured */
+typedef struct {
+	uint64_t* latencies; /* nanoseconds, one per operation */
+	uint32_t num_ops;
+	uint64_t rows_touched;
+} BenchResult;
+
+/* a workload the benchmark knows how to run */
+typedef struct {
+	const char* name;
+	bool needs_empty_table; /* otherwise it runs against num_rows rows */
+	bool needs_concurrent; /* only runs if the DB is opened with --concurrent */
+	void (*run)(Table* table, BenchOptions* options, BenchResult* result);
+} BenchWorkload;
+
+/* one reader thread of the concurrent workload */
+typedef struct {
+	Table* table;
+	BenchOptions* options;
+	uint64_t random_state;
+	uint32_t num_ops;
+	BenchResult result;
+	uint64_t wrong_answers;
+	bool done;
+} BenchReader;
+
+/* a way of counting the keys below a given key in part of a node */
+typedef struct {
+	const char* name;
+	uint32_t (*count_keys_below)(const uint32_t* keys, uint32_t stride, uint32_t num_keys, uint32_t key);
+} KeySearchKernel;
+
 /* helps us keep track of node type */
 typedef enum { 
 	NODE_INTERNAL,
@@ -173,59 +784,326 @@ typedef enum {
 InputBuffer* new_input_buffer();
 void print_prompt();
 void read_input(InputBuffer* input_buffer);
-MetaCommandResult implement_command(InputBuffer* input_buffer, Table* table);
-ParsingResult check_insert(InputBuffer* input_buffer, Statement* statement);
+void implement_bulk_load(InputBuffer* input_buffer, Table* table);
+void implement_stats_dump(InputBuffer* input_buffer, Table* table);
+MetaCommandResult implement_command(InputBuffer* input_buffer, Database* database);
+ParsingResult parse_table_name(char* name, Statement* statement);
+ParsingResult find_statement_table(char* name, Database* database, Statement* statement);
+ParsingResult parse_table_clause(char** clause, const char* keyword, Database* database, Statement* statement);
+ParsingResult check_insert(InputBuffer* input_buffer, Statement* statement, Database* database);
+ParsingResult parse_id_range(char* clause, Statement* statement);
+ParsingResult parse_value_filter(char* clause, Statement* statement);
+ParsingResult parse_projection(char** clause, char names[][COLUMN_NAME_MAX_LENGTH + 1], uint32_t* num_names);
+ParsingResult check_select(InputBuffer* input_buffer, Statement* statement, Database* database);
+ParsingResult check_delete(InputBuffer* input_buffer, Statement* statement, Database* database);
+ParsingResult check_create_index(InputBuffer* input_buffer, Statement* statement, Database* database);
+ParsingResult check_create_table(InputBuffer* input_buffer, Statement* statement);
 ParsingResult check_statement(InputBuffer* input_buffer,
-                                Statement* statement);
+                                Statement* statement, Database* database);
+int compare_rows(const void* a, const void* b);
 ExecuteResult execute_insert(Statement* statement, Table* table);
 ExecuteResult execute_select(Statement* statement, Table* table);
+ExecuteResult execute_aggregate(Statement* statement, Table* table);
+ExecuteResult execute_select_by_value(Statement* statement, Table* table);
+ExecuteResult execute_delete(Statement* statement, Table* table);
 ExecuteResult execute_statement(Statement* statement, Table* table);
-void serialize_row(Row* source, void* destination);
-void deserialize_row(void* source, Row* destination);
-void print_row(Row* row);
-void print_constants();
+ExecuteResult run_statement(Statement* statement, Database* database);
+void print_constants(Pager* pager);
 
 /* Pager function declarations */
-Pager* open_pager(const char* filename);
+void set_default_options(DatabaseOptions* options);
+bool parse_database_option(int argc, char* argv[], int* i, DatabaseOptions* options);
+bool is_valid_page_size(uint32_t page_size);
+void set_page_layout(Pager* pager, uint32_t page_size);
+uint32_t read_page_size(int fd, DatabaseOptions* options);
+Pager* open_pager(const char* filename, DatabaseOptions* options);
+void read_ahead_pages(Pager* pager, uint32_t* page_nums, uint32_t num_pages);
+uint32_t find_frame(Pager* pager, uint32_t page_num);
+void remove_frame_from_bucket(Pager* pager, uint32_t frame_index);
+uint32_t evict_frame(Pager* pager);
+uint32_t claim_frame(Pager* pager, uint32_t page_num);
+uint32_t fetch_frame(Pager* pager, uint32_t page_num);
+void* get_mapped_page(Pager* pager, uint32_t page_num);
 void* get_page(Pager* pager, uint32_t page_num);
-void flush_pager(Pager* pager, uint32_t page_num);
-Table* open_database();
-void close_database(Table* table);
+void* pin_page(Pager* pager, uint32_t page_num);
+void unpin_page(Pager* pager, uint32_t page_num);
+void mark_page_dirty(Pager* pager, uint32_t page_num);
+int compare_dirty_pages(const void* a, const void* b);
+void write_dirty_pages(Pager* pager, DirtyPage* dirty_pages, uint32_t num_dirty);
+void flush_dirty_pages(Pager* pager);
+void trim_mapped_pages(Pager* pager);
+void write_back_frames(Pager* pager, uint32_t frame_index);
+Database* open_database(const char* filename, DatabaseOptions* options);
+void close_database(Database* database);
+uint32_t* get_free_list_head(void* header);
+uint32_t* get_num_free_pages(void* header);
+uint32_t* get_free_page_next(void* page);
 uint32_t get_unused_page_num(Pager* pager);
+void free_page(Pager* pager, uint32_t page_num);
+
+/* WAL function declarations */
+uint32_t compute_wal_checksum(WalRecordHeader* header, void* data, uint32_t page_size);
+char* get_wal_path(const char* filename);
+void recover_wal(int file_descriptor, const char* filename, uint32_t page_size);
+void* run_wal_flusher(void* arg);
+Wal* open_wal(const char* filename, DatabaseOptions* options);
+void sync_wal(Wal* wal);
+void add_statement_page(Pager* pager, uint32_t page_num);
+off_t find_logged_page(Wal* wal, uint32_t page_num);
+void remember_logged_page(Wal* wal, uint32_t page_num, off_t offset);
+void forget_logged_page(Wal* wal, uint32_t page_num);
+void log_evicted_page(Pager* pager, uint32_t frame_index);
+void read_logged_page(Pager* pager, off_t offset, void* page);
+void copy_logged_pages(Pager* pager);
+int compare_page_nums(const void* a, const void* b);
+WalCommit log_statement(Pager* pager);
+void wait_for_commit(Pager* pager, WalCommit commit);
+void commit_statement(Pager* pager);
+void checkpoint(Pager* pager);
+void close_wal(Pager* pager);
+
+/* latch function declarations */
+void open_latches(Pager* pager);
+void close_latches(Pager* pager);
+void lock_pool(Pager* pager);
+void unlock_pool(Pager* pager);
+bool is_writer(Pager* pager);
+void begin_write(Pager* pager);
+void end_write(Pager* pager);
+void hold_frame_for_writer(Pager* pager, uint32_t frame_index);
+void start_loading_frame(Pager* pager, uint32_t frame_index);
+void finish_loading_frame(Pager* pager, uint32_t frame_index);
+void wait_for_frame_load(Pager* pager, uint32_t frame_index);
+void latch_frame_for_write(Pager* pager, uint32_t frame_index);
+void latch_path_for_write(Pager* pager, uint32_t page_num);
+void release_write_latches(Pager* pager);
+void* latch_page(Pager* pager, uint32_t page_num);
+void* try_latch_page(Pager* pager, uint32_t page_num);
+void unlatch_page(Pager* pager, uint32_t page_num);
 
 /* Cursor function declarations */
 Cursor* get_table_start(Table* table);
 Cursor* find_key_in_table(Table* table, uint32_t key);
+Cursor* find_range_in_table(Table* table, uint32_t first_key, uint32_t last_key);
 uint32_t find_internal_node_child(void* node, uint32_t key);
 Cursor* find_internal_node(Table* table, uint32_t page_num, uint32_t key);
+uint32_t find_leaf_with_bound(Table* table, uint32_t key, uint32_t* upper_bound, bool* has_upper_bound);
 void* get_cursor_value(Cursor* cursor);
+void settle_cursor(Cursor* cursor);
 void advance_cursor(Cursor* cursor);
+void close_cursor(Cursor* cursor);
+void read_ahead_leaves(Cursor* cursor);
+
+/* parallel scan function declarations */
+uint32_t plan_scan_partitions(Table* table, uint32_t first_key, uint32_t last_key, uint32_t target, ScanPartition** partitions);
+void* run_scan_thread(void* arg);
+ParallelScan* plan_parallel_scan(Table* table, uint32_t first_key, uint32_t last_key);
+void run_parallel_scan(ParallelScan* scan, void (*visit)(ParallelScan* scan, uint32_t partition), void* arg);
+void select_partition(ParallelScan* scan, uint32_t partition);
+void parallel_select(Table* table, uint32_t first_key, uint32_t last_key, bool unordered, Projection* projection);
+
+/* aggregate function declarations */
+void total_keys_in_range(Table* table, uint32_t first_key, uint32_t last_key, bool with_sum, AggregateTotals* totals);
+void total_partition(ParallelScan* scan, uint32_t partition);
+void total_keys(Table* table, uint32_t first_key, uint32_t last_key, bool with_sum, AggregateTotals* totals);
+bool find_min_key_in_range(Table* table, uint32_t first_key, uint32_t last_key, uint32_t* key);
+bool find_max_key_in_range(Table* table, uint32_t first_key, uint32_t last_key, uint32_t* key);
+
+/* index function declarations */
+bool find_indexed_column(const char* name, IndexColumn* column);
+uint32_t hash_index_value(const char* value, uint32_t length);
+uint32_t get_indexed_column_num(Table* table, IndexColumn column);
+uint32_t get_index_key(Schema* schema, void* data, uint32_t column_num);
+bool table_has_indexes(Table* table);
+void open_indexes(Table* table);
+void close_indexes(Table* table);
+int compare_index_entries(const void* a, const void* b);
+int compare_ids(const void* a, const void* b);
+void build_index(Table* table, Table* index, IndexColumn column);
+void build_indexes(Table* table);
+ExecuteResult create_index(Table* table, IndexColumn column);
+void update_index(Table* index, uint32_t key, uint32_t id, bool adding);
+void add_rows_to_indexes(Table* table, Row* rows, uint32_t num_rows);
+void remove_rows_from_indexes(Table* table, Row* rows, uint32_t num_rows);
+uint32_t find_ids_in_index(Table* index, uint32_t key, uint32_t** ids);
+
+/* catalog function declarations */
+void* get_catalog_entry(void* header, uint32_t entry_num);
+uint32_t* get_catalog_index_root(void* entry, IndexColumn column);
+uint32_t* get_catalog_root_page(void* entry);
+char* get_catalog_name(void* entry);
+uint32_t* get_catalog_num_columns(void* entry);
+void* get_catalog_column(void* entry, uint32_t column_num);
+void write_catalog_schema(void* entry, Schema* schema);
+void read_catalog_schema(void* entry, Schema* schema);
+Table* open_table(Pager* pager, void* header, uint32_t entry_num);
+void open_catalog(Database* database);
+void close_catalog(Database* database);
+Table* find_table(Database* database, const char* name);
+ExecuteResult create_table(Database* database, const char* name, Schema* schema);
+
+/* schema function declarations */
+void set_default_schema(Schema* schema);
+bool compile_schema(Schema* schema);
+ParsingResult parse_column(char* definition, Column* column);
+ParsingResult parse_schema(char* definition, Schema* schema);
+bool find_column(Schema* schema, const char* name, uint32_t* column_num);
+ParsingResult encode_row(Schema* schema, char** values, Row* row);
+uint32_t get_column_string(Schema* schema, void* data, uint32_t column_num, char** string);
+bool column_holds_value(Schema* schema, void* data, uint32_t column_num, const char* value);
+void deserialize_row(void* source, uint32_t length, Row* destination);
+uint32_t get_serialized_row_size(Row* row);
+uint32_t serialize_row(Row* source, void* destination);
+void project_all_columns(Schema* schema, Projection* projection);
+bool project_column(Schema* schema, const char* name, Projection* projection);
+void write_row(OutputBuffer* output, Schema* schema, Projection* projection, void* data);
+void print_row(Schema* schema, Projection* projection, void* data);
+
+/* output function declarations */
+bool parse_output_format(const char* name, OutputFormat* format);
+void init_output_buffer(OutputBuffer* output, int fd, OutputFormat format);
+void free_output_buffer(OutputBuffer* output);
+void flush_output(OutputBuffer* output);
+void make_output_room(OutputBuffer* output, size_t length);
+void write_output(OutputBuffer* output, const void* data, size_t length);
+void write_output_uint(OutputBuffer* output, uint64_t value);
+void begin_output_row(OutputBuffer* output);
+void begin_output_value(OutputBuffer* output);
+void write_int_value(OutputBuffer* output, int64_t value, uint32_t size);
+bool needs_escaping(OutputFormat format, char character);
+void write_string_value(OutputBuffer* output, const char* string, uint32_t length);
+void write_null_value(OutputBuffer* output);
+void end_output_row(OutputBuffer* output);
+void open_standard_output(OutputFormat format);
+OutputBuffer* get_standard_output();
+void flush_standard_output();
+void flush_output_for_input();
+void print_message(const char* format, ...);
+
+/* Bulk load function declarations */
+BulkLoader* begin_bulk_load(Table* table, double fill_factor);
+ExecuteResult append_bulk_cell(BulkLoader* loader, uint32_t key, uint32_t length, void** value);
+ExecuteResult bulk_load_row(BulkLoader* loader, Row* row);
+void start_next_bulk_leaf(BulkLoader* loader);
+void add_bulk_child(BulkLoader* loader, uint32_t level, uint32_t child_page_num, uint32_t child_max_key);
+void write_bulk_node(BulkLoader* loader, uint32_t level, uint32_t first_child, uint32_t num_children, uint32_t page_num);
+uint64_t finish_bulk_load(BulkLoader* loader);
+ExecuteResult bulk_load_file(Table* table, const char* path, double fill_factor, uint64_t* num_rows);
+
+/* statistics function declarations */
+uint64_t get_time_ns();
+void reset_stats(Pager* pager);
+uint64_t get_num_fsyncs(Pager* pager);
+uint32_t get_latency_bucket(uint64_t elapsed_ns);
+void record_statement_time(Pager* pager, uint64_t elapsed_ns);
+void print_stats(Pager* pager);
+bool start_stats_dump(Pager* pager, const char* path, double interval_seconds);
+void stop_stats_dump(Pager* pager);
+void dump_stats(Pager* pager);
+
+/* I/O backend function declarations */
+void set_io_request(IoRequest* request, bool is_write, off_t offset, struct iovec* iov, uint32_t iov_count);
+void finish_io_request(int file_descriptor, IoRequest* request, size_t done);
+void do_io_request(int file_descriptor, IoRequest* request);
+bool pread_fully(int file_descriptor, void* buffer, size_t length, off_t offset);
+bool pwrite_fully(int file_descriptor, const void* buffer, size_t length, off_t offset);
+void run_io_sync(IoBackend* backend, IoRequest* requests, uint32_t num_requests);
+void close_io_sync(IoBackend* backend);
+void* run_io_thread(void* arg);
+void run_io_threads(IoBackend* backend, IoRequest* requests, uint32_t num_requests);
+void close_io_threads(IoBackend* backend);
+void open_io_threads(IoBackend* backend);
+IoUring* open_io_uring(uint32_t num_entries);
+void run_io_uring(IoBackend* backend, IoRequest* requests, uint32_t num_requests);
+void close_io_uring(IoBackend* backend);
+IoBackend* open_io_backend(int file_descriptor, const char* name);
+void run_io(IoBackend* backend, IoRequest* requests, uint32_t num_requests);
+void close_io_backend(IoBackend* backend);
+
+/* key search function declarations */
+uint32_t count_keys_below_scalar(const uint32_t* keys, uint32_t stride, uint32_t num_keys, uint32_t key);
+uint32_t count_keys_below_sse2(const uint32_t* keys, uint32_t stride, uint32_t num_keys, uint32_t key);
+uint32_t count_keys_below_avx2(const uint32_t* keys, uint32_t stride, uint32_t num_keys, uint32_t key);
+bool is_key_search_kernel_supported(KeySearchKernel* kernel);
+KeySearchKernel* get_key_search_kernel();
+bool set_key_search_kernel(const char* name);
+uint32_t search_keys(const uint32_t* keys, uint32_t stride, uint32_t num_keys, uint32_t key);
+
+/* benchmark function declarations */
+uint64_t next_random(uint64_t* state);
+void make_bench_email(uint32_t id, char* email);
+void make_bench_row(Schema* schema, uint32_t id, Row* row);
+void record_latency(BenchResult* result, uint64_t start_ns);
+void bench_insert_key(Table* table, uint32_t key);
+void bench_sequential_insert(Table* table, BenchOptions* options, BenchResult* result);
+void bench_random_insert(Table* table, BenchOptions* options, BenchResult* result);
+void bench_point_lookup(Table* table, BenchOptions* options, BenchResult* result);
+void bench_range_scan(Table* table, BenchOptions* options, BenchResult* result);
+void bench_range_count(Table* table, BenchOptions* options, BenchResult* result);
+void drop_os_cache(Table* table);
+void bench_full_scan(Table* table, BenchOptions* options, BenchResult* result);
+void count_partition_rows(ParallelScan* scan, uint32_t partition);
+void bench_parallel_scan(Table* table, BenchOptions* options, BenchResult* result);
+void bench_mixed(Table* table, BenchOptions* options, BenchResult* result);
+void* run_bench_reader(void* arg);
+void bench_concurrent_read(Table* table, BenchOptions* options, BenchResult* result);
+void bench_email_lookup(Table* table, BenchOptions* options, BenchResult* result);
+uint64_t scan_range(Table* table, uint32_t first_key, uint32_t last_key);
+void populate_bench_table(Table* table, uint32_t num_rows);
+int compare_latencies(const void* a, const void* b);
+uint64_t get_percentile(BenchResult* result, uint32_t per_mille);
+void run_workload(BenchWorkload* workload, BenchOptions* options);
 
 /* B-Tree function declarations*/
 void set_node_type(void* node, NodeType type);
 NodeType get_node_type(void* node);
-void initialize_leaf_node(void* node);
+void initialize_leaf_node(Pager* pager, void* node);
 uint32_t* get_node_parent(void* node);
 uint32_t* get_leaf_num_cells(void* node);
-void* get_leaf_cell(void* node, uint32_t cell_num);
+uint32_t* get_leaf_cell_content_start(void* node);
+void* get_leaf_slot(void* node, uint32_t cell_num);
 uint32_t* get_leaf_key(void* node, uint32_t cell_num) ;
+uint16_t* get_leaf_cell_offset(void* node, uint32_t cell_num);
+uint16_t* get_leaf_cell_length(void* node, uint32_t cell_num);
 void* get_leaf_value(void* node, uint32_t cell_num);
+uint32_t get_leaf_space_used(void* node);
+void compact_leaf(Pager* pager, void* node);
+void* insert_leaf_cell(Pager* pager, void* node, uint32_t cell_num, uint32_t key, uint32_t length);
+uint32_t collect_leaf_cells(void* node, LeafCell* cells);
+void write_leaf_cells(Pager* pager, void* node, LeafCell* cells, uint32_t num_cells);
+uint32_t plan_leaf_split(Pager* pager, LeafCell* cells, uint32_t num_cells, uint32_t* leaf_ends);
 Cursor* find_key_in_leaf(Table* table, uint32_t page_num, uint32_t key);
 uint32_t* get_next_leaf_of_given_leaf(void* node);
 void insert_cell_in_leaf(Cursor* cursor, uint32_t key, Row* value);
-void split_leaf_and_insert(Cursor* cursor, uint32_t key, Row* value);
+void split_leaf_and_insert(Cursor* cursor, Row* value);
+bool leaf_has_any_key(void* node, Row* rows, uint32_t num_rows);
+bool rows_fit_in_leaf(Pager* pager, void* node, Row* rows, uint32_t num_rows);
+void insert_rows_in_leaf(Table* table, uint32_t page_num, Row* rows, uint32_t num_rows);
+void split_leaf_cells(Table* table, uint32_t page_num, LeafCell* cells, uint32_t num_cells);
+void initialize_internal_node(Pager* pager, void* node);
 uint32_t* get_internal_node_num_keys(void* node);
 uint32_t* get_internal_node_right_child(void* node);
+uint32_t* get_internal_node_children_offset(void* node);
 uint32_t* get_internal_node_cell(void* node, uint32_t cell_num);
 uint32_t* get_internal_node_child(void* node, uint32_t child_num);
 uint32_t* get_internal_node_key(void* node, uint32_t key_num);
-void update_internal_node_key(void* node, uint32_t old_key, uint32_t new_key);
-void insert_child_into_internal_node(Table* table, uint32_t parent_page_num, uint32_t child_page_num);
-void split_internal_node_and_insert_child(Table* table, uint32_t parent_page_num, uint32_t child_page_num);
+void move_internal_node_cells(void* destination_node, uint32_t destination, void* source_node, uint32_t source, uint32_t num_cells);
+void update_internal_node_key(void* node, uint32_t child_page_num, uint32_t new_key);
+void insert_child_into_internal_node(Table* table, uint32_t parent_page_num, uint32_t left_page_num, uint32_t child_page_num);
+void set_internal_node_children(void* node, uint32_t* children, uint32_t* keys, uint32_t num_children);
+void split_internal_node_and_insert_child(Table* table, uint32_t parent_page_num, uint32_t left_page_num, uint32_t child_page_num);
 void set_node_root(void* node, bool is_root);
 bool is_node_root(void* node);
 void create_new_root(Table* table, uint32_t right_child_page_num);
-uint32_t get_max_key_in_node(void* node);
-void print_constants();
+uint32_t find_child_index(void* node, uint32_t child_page_num);
+void update_max_key_in_ancestors(Table* table, uint32_t page_num, uint32_t max_key);
+void remove_child_from_internal_node(Table* table, uint32_t parent_page_num, uint32_t child_index);
+bool delete_stays_in_leaf(Pager* pager, void* node, uint32_t first_cell, uint32_t end_cell);
+void delete_cells_in_leaf(Table* table, uint32_t page_num, uint32_t first_cell, uint32_t end_cell);
+void rebalance_leaf(Table* table, uint32_t page_num);
+void rebalance_internal_node(Table* table, uint32_t page_num);
+void collapse_root(Table* table);
+uint32_t get_max_key_in_node(Pager* pager, void* node);
+void print_constants(Pager* pager);
 void indent(uint32_t level);
 void print_tree(Pager* pager, uint32_t page_num, uint32_t indentation_level);
\ No newline at end of file
@@ -0,0 +1,354 @@
+/*
+
+This program implements secondary indexes for a minimalistic SQLite DB
+based on a tutorial at https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+
+/*
+	an index is a second B-tree in the same file, keyed by a hash of
+	the column, with a cell per row holding the row's id -- rows that
+	share a hash share a key, so an index is the one kind of tree
+	whose keys repeat, and a run of them can span several leaves
+*/
+
+/* what each IndexColumn is called in a statement */
+static const char* indexed_column_names[NUM_INDEXED_COLUMNS] = { "username", "email" };
+
+
+/*
+	finds the column with the given name
+
+	name: pointer to a string containing the column's name
+	column: set to the column, if there is one by that name
+	returns: false if no column that can be indexed has that name
+*/
+bool find_indexed_column(const char* name, IndexColumn* column) {
+	for (uint32_t i = 0; i < NUM_INDEXED_COLUMNS; i++) {
+		if (strcmp(name, indexed_column_names[i]) == 0) {
+			*column = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* returns the key a value of the given length is kept under in an
+index (a 32-bit FNV-1a hash of it) */
+uint32_t hash_index_value(const char* value, uint32_t length) {
+	uint32_t hash = 2166136261u;
+	for (uint32_t i = 0; i < length; i++) {
+		hash = (hash ^ (uint8_t) value[i]) * 16777619u;
+	}
+	return hash;
+}
+
+/* returns the number of the table's column that the given index is
+on -- a table only gets an index on a column it has */
+uint32_t get_indexed_column_num(Table* table, IndexColumn column) {
+	uint32_t column_num = 0;
+	find_column(&table->schema, indexed_column_names[column], &column_num);
+	return column_num;
+}
+
+/* returns the key an encoded row is kept under in an index on the
+given column (by its number in the table) */
+uint32_t get_index_key(Schema* schema, void* data, uint32_t column_num) {
+	char* value;
+	uint32_t length = get_column_string(schema, data, column_num, &value);
+	return hash_index_value(value, length);
+}
+
+/* returns true if any of the table's columns has an index */
+bool table_has_indexes(Table* table) {
+	for (uint32_t i = 0; i < NUM_INDEXED_COLUMNS; i++) {
+		if (table->indexes[i] != NULL) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+	sets up a Table struct for every index the table's catalog entry
+	lists
+
+	table: pointer to a freshly opened Table struct
+*/
+void open_indexes(Table* table) {
+	void* header = get_page(table->pager, DB_HEADER_PAGE_NUM);
+	void* entry = get_catalog_entry(header, table->catalog_entry);
+	for (uint32_t i = 0; i < NUM_INDEXED_COLUMNS; i++) {
+		uint32_t root_page_num = *get_catalog_index_root(entry, i);
+		table->indexes[i] = NULL;
+		if (root_page_num != 0) {
+			Table* index = calloc(1, sizeof(Table));
+			index->pager = table->pager;
+			index->root_page_num = root_page_num;
+			table->indexes[i] = index;
+		}
+	}
+}
+
+/* frees what open_indexes() and create_index() set up */
+void close_indexes(Table* table) {
+	for (uint32_t i = 0; i < NUM_INDEXED_COLUMNS; i++) {
+		free(table->indexes[i]);
+	}
+}
+
+/* qsort() comparator for index entries, ordered by key and then id */
+int compare_index_entries(const void* a, const void* b) {
+	IndexEntry* entry_a = (IndexEntry*) a;
+	IndexEntry* entry_b = (IndexEntry*) b;
+	if (entry_a->key != entry_b->key) {
+		return (entry_a->key > entry_b->key) - (entry_a->key < entry_b->key);
+	}
+	return (entry_a->id > entry_b->id) - (entry_a->id < entry_b->id);
+}
+
+/* qsort() comparator for ids */
+int compare_ids(const void* a, const void* b) {
+	uint32_t id_a = *(uint32_t*) a;
+	uint32_t id_b = *(uint32_t*) b;
+	return (id_a > id_b) - (id_a < id_b);
+}
+
+/*
+	fills an empty index with every row of the table -- the entries
+	are sorted and bulk loaded, so the index is written once, left to
+	right, rather than an entry at a time
+
+	table: pointer to the Table struct the index belongs to
+	index: pointer to the index's (empty) Table struct
+	column: the column the index is on
+*/
+void build_index(Table* table, Table* index, IndexColumn column) {
+	uint64_t capacity = 1024;
+	uint64_t num_entries = 0;
+	IndexEntry* entries = malloc(capacity * sizeof(IndexEntry));
+
+	uint32_t column_num = get_indexed_column_num(table, column);
+	Cursor* cursor = get_table_start(table);
+	while (!(cursor->end_of_table)) {
+		if (num_entries == capacity) {
+			capacity *= 2;
+			entries = realloc(entries, capacity * sizeof(IndexEntry));
+		}
+		entries[num_entries].key = get_index_key(&table->schema, get_cursor_value(cursor), column_num);
+		entries[num_entries].id = *get_leaf_key(cursor->node, cursor->cell_num);
+		num_entries++;
+
+		/* in concurrent mode, this is the writer, which holds on to
+		every page it reads until it lets go -- so it lets go a leaf
+		at a time, or a big table would fill the buffer pool */
+		uint32_t page_num = cursor->page_num;
+		advance_cursor(cursor);
+		if (cursor->page_num != page_num) {
+			release_write_latches(table->pager);
+		}
+	}
+	close_cursor(cursor);
+	qsort(entries, num_entries, sizeof(IndexEntry), compare_index_entries);
+
+	/* every entry becomes a cell of its own */
+	BulkLoader* loader = begin_bulk_load(index, 1);
+	loader->duplicate_keys = true;
+	for (uint64_t i = 0; i < num_entries; i++) {
+		uint32_t* id;
+		append_bulk_cell(loader, entries[i].key, sizeof(uint32_t), (void**) &id);
+		*id = entries[i].id;
+	}
+	finish_bulk_load(loader);
+	free(entries);
+}
+
+/* builds every index the table has from its rows, which the indexes
+have to be empty for */
+void build_indexes(Table* table) {
+	for (uint32_t i = 0; i < NUM_INDEXED_COLUMNS; i++) {
+		if (table->indexes[i] != NULL) {
+			build_index(table, table->indexes[i], i);
+		}
+	}
+}
+
+/*
+	creates an index on the given column and builds it from the rows
+	already in the table
+
+	table: pointer to the Table struct to index
+	column: the column to index
+	returns: status code signifying the success of execution
+*/
+ExecuteResult create_index(Table* table, IndexColumn column) {
+	if (table->indexes[column] != NULL) {
+		return EXECUTE_INDEX_EXISTS;
+	}
+
+	Pager* pager = table->pager;
+	Table* index = calloc(1, sizeof(Table));
+	index->pager = pager;
+	index->root_page_num = get_unused_page_num(pager);
+	void* root = get_page(pager, index->root_page_num);
+	mark_page_dirty(pager, index->root_page_num);
+	initialize_leaf_node(pager, root);
+	set_node_root(root, true);
+	build_index(table, index, column);
+
+	/* only a finished index goes in the catalog, and only then can
+	readers find it */
+	void* header = get_page(pager, DB_HEADER_PAGE_NUM);
+	mark_page_dirty(pager, DB_HEADER_PAGE_NUM);
+	*get_catalog_index_root(get_catalog_entry(header, table->catalog_entry), column) = index->root_page_num;
+	__atomic_store_n(&table->indexes[column], index, __ATOMIC_RELEASE);
+	return EXECUTE_SUCCESS;
+}
+
+/*
+	adds a row's cell to an index, or takes it out
+
+	index: pointer to the index's Table struct
+	key: hash of the row's value
+	id: the row's id
+	adding: true to add the cell, false to take it out
+*/
+void update_index(Table* index, uint32_t key, uint32_t id, bool adding) {
+	Pager* pager = index->pager;
+
+	/* the row's cell is somewhere in the run of cells with its key */
+	if (!adding) {
+		Cursor* cursor = find_range_in_table(index, key, key);
+		while (!cursor->end_of_table && *(uint32_t*) get_cursor_value(cursor) != id) {
+			advance_cursor(cursor);
+		}
+		bool found = !cursor->end_of_table;
+		uint32_t page_num = cursor->page_num;
+		uint32_t cell_num = cursor->cell_num;
+		close_cursor(cursor);
+		if (!found) {
+			return;
+		}
+
+		void* node = get_page(pager, page_num);
+		if (!delete_stays_in_leaf(pager, node, cell_num, cell_num + 1)) {
+			latch_path_for_write(pager, page_num);
+		}
+		delete_cells_in_leaf(index, page_num, cell_num, cell_num + 1);
+		return;
+	}
+
+	/* a new cell goes ahead of any others with its key, in the first
+	leaf that can hold the key */
+	uint32_t upper_bound;
+	bool has_upper_bound;
+	uint32_t page_num = find_leaf_with_bound(index, key, &upper_bound, &has_upper_bound);
+	void* node = get_page(pager, page_num);
+	uint32_t num_cells = *get_leaf_num_cells(node);
+	uint32_t cell_num = search_keys(get_leaf_key(node, 0), LEAF_NODE_SLOT_SIZE / LEAF_NODE_KEY_SIZE,
+		num_cells, key);
+
+	/* the key is within the leaf's bound, so the keys above the leaf
+	only change if it has to split */
+	uint32_t space_needed = get_leaf_space_used(node) + LEAF_NODE_SLOT_SIZE + sizeof(uint32_t);
+	if (space_needed <= pager->leaf_node_space_for_cells) {
+		mark_page_dirty(pager, page_num);
+		memcpy(insert_leaf_cell(pager, node, cell_num, key, sizeof(uint32_t)), &id, sizeof(uint32_t));
+		return;
+	}
+
+	latch_path_for_write(pager, page_num);
+	char* old_node = malloc(pager->page_size);
+	memcpy(old_node, node, pager->page_size);
+	LeafCell* cells = malloc((num_cells + 1) * sizeof(LeafCell));
+	collect_leaf_cells(old_node, cells);
+	memmove(cells + cell_num + 1, cells + cell_num, (num_cells - cell_num) * sizeof(LeafCell));
+	cells[cell_num].key = key;
+	cells[cell_num].length = sizeof(uint32_t);
+	cells[cell_num].value = &id;
+	split_leaf_cells(index, page_num, cells, num_cells + 1);
+	free(cells);
+	free(old_node);
+}
+
+/*
+	adds freshly inserted rows to every index the table has
+
+	table: pointer to the Table struct the rows went into
+	rows: pointer to the rows
+	num_rows: number of rows
+*/
+void add_rows_to_indexes(Table* table, Row* rows, uint32_t num_rows) {
+	for (uint32_t i = 0; i < NUM_INDEXED_COLUMNS; i++) {
+		Table* index = table->indexes[i];
+		uint32_t column_num = get_indexed_column_num(table, i);
+		for (uint32_t row = 0; index != NULL && row < num_rows; row++) {
+			update_index(index, get_index_key(&table->schema, rows[row].data, column_num), rows[row].id, true);
+			release_write_latches(table->pager);
+		}
+	}
+}
+
+/*
+	takes deleted rows out of every index the table has
+
+	table: pointer to the Table struct the rows were deleted from
+	rows: pointer to the rows
+	num_rows: number of rows
+*/
+void remove_rows_from_indexes(Table* table, Row* rows, uint32_t num_rows) {
+	for (uint32_t i = 0; i < NUM_INDEXED_COLUMNS; i++) {
+		Table* index = table->indexes[i];
+		uint32_t column_num = get_indexed_column_num(table, i);
+		for (uint32_t row = 0; index != NULL && row < num_rows; row++) {
+			update_index(index, get_index_key(&table->schema, rows[row].data, column_num), rows[row].id, false);
+			release_write_latches(table->pager);
+		}
+	}
+}
+
+/*
+	looks up the ids an index keeps under the given key
+
+	index: pointer to the index's Table struct
+	key: hash of the value being looked for
+	ids: set to the ids, sorted, which the caller frees
+	returns: number of ids
+*/
+uint32_t find_ids_in_index(Table* index, uint32_t key, uint32_t** ids) {
+	uint32_t capacity = 16;
+	*ids = malloc(capacity * sizeof(uint32_t));
+
+	while (true) {
+		uint32_t num_ids = 0;
+		Cursor* cursor = find_range_in_table(index, key, key);
+		while (!cursor->end_of_table) {
+			if (num_ids == capacity) {
+				capacity *= 2;
+				*ids = realloc(*ids, capacity * sizeof(uint32_t));
+			}
+			(*ids)[num_ids++] = *(uint32_t*) get_cursor_value(cursor);
+			advance_cursor(cursor);
+		}
+
+		/* a reader gives up on the next leaf if the writer has it,
+		which is only the end of the run if the run can't carry on
+		into it -- if it can, the lookup waits for the writer to let
+		go of the leaf and starts over */
+		void* node = cursor->node;
+		uint32_t next_page_num = *get_next_leaf_of_given_leaf(node);
+		bool cut_short = (cursor->cell_num >= *get_leaf_num_cells(node) && next_page_num != 0);
+		close_cursor(cursor);
+		if (!cut_short) {
+			qsort(*ids, num_ids, sizeof(uint32_t), compare_ids);
+			return num_ids;
+		}
+		latch_page(index->pager, next_page_num);
+		unlatch_page(index->pager, next_page_num);
+	}
+}
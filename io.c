@@ -0,0 +1,414 @@
+/*
+
+This program implements the I/O backends for a minimalistic SQLite DB
+based on a tutorial at https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+#include <sys/syscall.h>
+
+/*
+	the pager hands its reads and writes over in batches, and a batch
+	has all of its requests in flight at once -- through io_uring, a
+	small thread pool, or (for comparing) one at a time; --io-backend
+	picks one, otherwise it's io_uring if the kernel will give us a ring
+*/
+
+
+/*
+	fills in a request for a run of pages
+
+	request: pointer to the request to fill in
+	is_write: true to write the pages, false to read them
+	offset: where the run starts in the DB file
+	iov: buffers for the pages, in file order
+	iov_count: number of buffers
+*/
+void set_io_request(IoRequest* request, bool is_write, off_t offset, struct iovec* iov, uint32_t iov_count) {
+	request->is_write = is_write;
+	request->offset = offset;
+	request->iov = iov;
+	request->iov_count = iov_count;
+	request->length = 0;
+	for (uint32_t i = 0; i < iov_count; i++) {
+		request->length += iov[i].iov_len;
+	}
+	request->result = 0;
+}
+
+/*
+	carries out what's left of a request once the given number of
+	bytes have been moved, calling preadv()/pwritev() until all of it
+	is done -- a read only comes up short at the end of the file
+
+	file_descriptor: descriptor of the file to read or write
+	request: pointer to the request, whose result ends up as the
+		bytes moved (or -errno)
+	done: bytes of the request already moved
+*/
+void finish_io_request(int file_descriptor, IoRequest* request, size_t done) {
+	while (done < request->length) {
+		/* skip the buffers that are full already, and start the
+		next one partway in -- it's put back the way it was after */
+		uint32_t first = 0;
+		size_t skipped = 0;
+		while (skipped + request->iov[first].iov_len <= done) {
+			skipped += request->iov[first].iov_len;
+			first++;
+		}
+		struct iovec* iov = &request->iov[first];
+		struct iovec whole = *iov;
+		iov->iov_base = (char*) iov->iov_base + (done - skipped);
+		iov->iov_len -= done - skipped;
+		ssize_t result = request->is_write ?
+			pwritev(file_descriptor, iov, request->iov_count - first, request->offset + done) :
+			preadv(file_descriptor, iov, request->iov_count - first, request->offset + done);
+		*iov = whole;
+
+		if (result == -1 && errno == EINTR) {
+			continue;
+		}
+		if (result == -1) {
+			request->result = -errno;
+			return;
+		}
+		if (result == 0) {
+			break;
+		}
+		done += result;
+	}
+	request->result = done;
+}
+
+/* carries out a single request, leaving the bytes moved (or -errno)
+in its result */
+void do_io_request(int file_descriptor, IoRequest* request) {
+	finish_io_request(file_descriptor, request, 0);
+}
+
+/*
+	reads a buffer's worth from the given offset of a file that isn't
+	the DB's (or before the DB has a backend), coping with short reads
+
+	file_descriptor: descriptor of the file to read
+	buffer: where the bytes go
+	length: number of bytes to read
+	offset: where in the file to read them from
+	returns: true if every byte was read
+*/
+bool pread_fully(int file_descriptor, void* buffer, size_t length, off_t offset) {
+	struct iovec iov = { buffer, length };
+	IoRequest request;
+	set_io_request(&request, false, offset, &iov, 1);
+	do_io_request(file_descriptor, &request);
+	return request.result == (ssize_t) length;
+}
+
+/* writes a buffer at the given offset of a file, coping with short
+writes -- returns true if every byte was written */
+bool pwrite_fully(int file_descriptor, const void* buffer, size_t length, off_t offset) {
+	struct iovec iov = { (void*) buffer, length };
+	IoRequest request;
+	set_io_request(&request, true, offset, &iov, 1);
+	do_io_request(file_descriptor, &request);
+	return request.result == (ssize_t) length;
+}
+
+/* runs a batch one request at a time */
+void run_io_sync(IoBackend* backend, IoRequest* requests, uint32_t num_requests) {
+	for (uint32_t i = 0; i < num_requests; i++) {
+		do_io_request(backend->file_descriptor, &requests[i]);
+	}
+}
+
+/* nothing to clean up for the sync backend */
+void close_io_sync(IoBackend* backend) {
+}
+
+/* what every thread in the pool runs: take the next request of the
+current batch, do it, repeat -- until the backend is closed */
+void* run_io_thread(void* arg) {
+	IoBackend* backend = arg;
+	IoThreadPool* pool = backend->state;
+	pthread_mutex_lock(&pool->lock);
+	while (true) {
+		while (!pool->closing && pool->next_request >= pool->num_requests) {
+			pthread_cond_wait(&pool->work_ready, &pool->lock);
+		}
+		if (pool->closing) {
+			break;
+		}
+		IoRequest* request = &pool->requests[pool->next_request++];
+		pthread_mutex_unlock(&pool->lock);
+		do_io_request(backend->file_descriptor, request);
+		pthread_mutex_lock(&pool->lock);
+		if (++pool->num_done == pool->num_requests) {
+			pthread_cond_signal(&pool->work_done);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return NULL;
+}
+
+/* runs a batch on the thread pool, with the calling thread taking
+requests too until there are none left to take */
+void run_io_threads(IoBackend* backend, IoRequest* requests, uint32_t num_requests) {
+	IoThreadPool* pool = backend->state;
+	pthread_mutex_lock(&pool->lock);
+	pool->requests = requests;
+	pool->num_requests = num_requests;
+	pool->next_request = 0;
+	pool->num_done = 0;
+	if (num_requests > 1) {
+		pthread_cond_broadcast(&pool->work_ready);
+	}
+
+	while (pool->next_request < pool->num_requests) {
+		IoRequest* request = &pool->requests[pool->next_request++];
+		pthread_mutex_unlock(&pool->lock);
+		do_io_request(backend->file_descriptor, request);
+		pthread_mutex_lock(&pool->lock);
+		pool->num_done++;
+	}
+	while (pool->num_done < pool->num_requests) {
+		pthread_cond_wait(&pool->work_done, &pool->lock);
+	}
+
+	/* nothing is left for the threads to pick up once this returns */
+	pool->requests = NULL;
+	pool->num_requests = 0;
+	pool->next_request = 0;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/* stops the pool's threads and frees the pool */
+void close_io_threads(IoBackend* backend) {
+	IoThreadPool* pool = backend->state;
+	pthread_mutex_lock(&pool->lock);
+	pool->closing = true;
+	pthread_cond_broadcast(&pool->work_ready);
+	pthread_mutex_unlock(&pool->lock);
+	for (uint32_t i = 0; i < IO_THREADS; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work_ready);
+	pthread_cond_destroy(&pool->work_done);
+	free(pool);
+}
+
+/* sets up the thread pool behind the given backend */
+void open_io_threads(IoBackend* backend) {
+	IoThreadPool* pool = calloc(1, sizeof(IoThreadPool));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_ready, NULL);
+	pthread_cond_init(&pool->work_done, NULL);
+	backend->state = pool;
+	for (uint32_t i = 0; i < IO_THREADS; i++) {
+		if (pthread_create(&pool->threads[i], NULL, run_io_thread, backend) != 0) {
+			printf("Couldn't start an I/O thread: %d\n", errno);
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/*
+	sets up an io_uring ring with the given number of entries
+
+	num_entries: most requests in flight at once
+	returns: pointer to the ring's state, or NULL if the kernel won't
+		give us a ring
+*/
+IoUring* open_io_uring(uint32_t num_entries) {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	int ring_fd = syscall(__NR_io_uring_setup, num_entries, &params);
+	if (ring_fd == -1) {
+		return NULL;
+	}
+
+	IoUring* ring = calloc(1, sizeof(IoUring));
+	ring->ring_fd = ring_fd;
+	ring->num_entries = params.sq_entries;
+
+	/* newer kernels put both rings in one mapping */
+	ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single_mmap && ring->cq_ring_size > ring->sq_ring_size) {
+		ring->sq_ring_size = ring->cq_ring_size;
+	}
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		ring_fd, IORING_OFF_SQ_RING);
+	ring->cq_ring = single_mmap ? ring->sq_ring : mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		ring_fd, IORING_OFF_SQES);
+	if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+		printf("Got an io_uring but couldn't map it: %d\n", errno);
+		exit(EXIT_FAILURE);
+	}
+
+	ring->sq_tail = (uint32_t*) ((char*) ring->sq_ring + params.sq_off.tail);
+	ring->sq_mask = (uint32_t*) ((char*) ring->sq_ring + params.sq_off.ring_mask);
+	ring->sq_array = (uint32_t*) ((char*) ring->sq_ring + params.sq_off.array);
+	ring->cq_head = (uint32_t*) ((char*) ring->cq_ring + params.cq_off.head);
+	ring->cq_tail = (uint32_t*) ((char*) ring->cq_ring + params.cq_off.tail);
+	ring->cq_mask = (uint32_t*) ((char*) ring->cq_ring + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*) ((char*) ring->cq_ring + params.cq_off.cqes);
+	return ring;
+}
+
+/* runs a batch through io_uring, keeping as many requests in flight
+as the ring has room for */
+void run_io_uring(IoBackend* backend, IoRequest* requests, uint32_t num_requests) {
+	IoUring* ring = backend->state;
+	uint32_t num_queued = 0; /* put in the submission ring */
+	uint32_t num_unsubmitted = 0; /* queued, but not taken by the kernel yet */
+	uint32_t num_completed = 0;
+
+	while (num_completed < num_requests) {
+		/* queue requests while there's room for them */
+		uint32_t tail = *ring->sq_tail;
+		while (num_queued < num_requests && num_queued - num_completed < ring->num_entries) {
+			IoRequest* request = &requests[num_queued];
+			uint32_t index = tail & *ring->sq_mask;
+			struct io_uring_sqe* sqe = &ring->sqes[index];
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = request->is_write ? IORING_OP_WRITEV : IORING_OP_READV;
+			sqe->fd = backend->file_descriptor;
+			sqe->addr = (uint64_t) (uintptr_t) request->iov;
+			sqe->len = request->iov_count;
+			sqe->off = request->offset;
+			sqe->user_data = num_queued;
+			ring->sq_array[index] = index;
+			tail++;
+			num_queued++;
+			num_unsubmitted++;
+		}
+		/* the kernel mustn't see the new tail before the entries */
+		__atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+		/* submit, and wait for a completion if anything is in flight */
+		uint32_t num_in_flight = num_queued - num_unsubmitted - num_completed;
+		uint32_t min_complete = (num_in_flight > 0 || num_unsubmitted > 0) ? 1 : 0;
+		int result = syscall(__NR_io_uring_enter, ring->ring_fd, num_unsubmitted, min_complete,
+			IORING_ENTER_GETEVENTS, NULL, 0);
+		if (result == -1) {
+			if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+				printf("io_uring gave up on us: %d\n", errno);
+				exit(EXIT_FAILURE);
+			}
+		} else {
+			num_unsubmitted -= result;
+		}
+
+		/* collect whatever has finished */
+		uint32_t head = *ring->cq_head;
+		while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+			struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+			IoRequest* request = &requests[cqe->user_data];
+			/* the kernel is free to stop short (or give up with
+			EAGAIN), so whatever's left is finished off here */
+			if (cqe->res == -EAGAIN || cqe->res == -EINTR) {
+				finish_io_request(backend->file_descriptor, request, 0);
+			} else if (cqe->res > 0 && (size_t) cqe->res < request->length) {
+				finish_io_request(backend->file_descriptor, request, cqe->res);
+			} else {
+				request->result = cqe->res;
+			}
+			num_completed++;
+			head++;
+		}
+		__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+	}
+}
+
+/* unmaps the rings and closes the io_uring */
+void close_io_uring(IoBackend* backend) {
+	IoUring* ring = backend->state;
+	munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring != ring->sq_ring) {
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	}
+	munmap(ring->sq_ring, ring->sq_ring_size);
+	close(ring->ring_fd);
+	free(ring);
+}
+
+/*
+	sets up an I/O backend for the DB file
+
+	file_descriptor: descriptor of the open DB file
+	name: pointer to a string naming the backend, or NULL for the
+		best one available
+	returns: pointer to the new backend, or NULL if the named backend
+		isn't one we have or can't run here
+*/
+IoBackend* open_io_backend(int file_descriptor, const char* name) {
+	IoBackend* backend = malloc(sizeof(IoBackend));
+	backend->file_descriptor = file_descriptor;
+	backend->state = NULL;
+	pthread_mutex_init(&backend->lock, NULL);
+
+	if (name == NULL || strcmp(name, "io_uring") == 0) {
+		IoUring* ring = open_io_uring(IO_URING_ENTRIES);
+		if (ring != NULL) {
+			backend->name = "io_uring";
+			backend->run = run_io_uring;
+			backend->close = close_io_uring;
+			backend->state = ring;
+			return backend;
+		}
+		/* no io_uring here, so fall back on the thread pool unless
+		io_uring was asked for by name */
+		if (name != NULL) {
+			pthread_mutex_destroy(&backend->lock);
+			free(backend);
+			return NULL;
+		}
+	}
+
+	if (name == NULL || strcmp(name, "threads") == 0) {
+		backend->name = "threads";
+		backend->run = run_io_threads;
+		backend->close = close_io_threads;
+		open_io_threads(backend);
+	} else if (strcmp(name, "sync") == 0) {
+		backend->name = "sync";
+		backend->run = run_io_sync;
+		backend->close = close_io_sync;
+	} else {
+		pthread_mutex_destroy(&backend->lock);
+		free(backend);
+		return NULL;
+	}
+	return backend;
+}
+
+/* runs a batch of requests, returning once they've all finished --
+each request's result says how it went; batches from different
+threads take turns, since a ring or a thread pool only runs one */
+void run_io(IoBackend* backend, IoRequest* requests, uint32_t num_requests) {
+	/* a lone request has nothing to overlap with, and going through
+	a ring or another thread only adds to its latency */
+	if (num_requests == 1) {
+		do_io_request(backend->file_descriptor, requests);
+	} else if (num_requests > 1) {
+		pthread_mutex_lock(&backend->lock);
+		backend->run(backend, requests, num_requests);
+		pthread_mutex_unlock(&backend->lock);
+	}
+}
+
+/* shuts the backend down and frees it */
+void close_io_backend(IoBackend* backend) {
+	backend->close(backend);
+	pthread_mutex_destroy(&backend->lock);
+	free(backend);
+}
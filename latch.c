@@ -0,0 +1,299 @@
+/*
+
+This program implements the latches that let a minimalistic SQLite DB
+be read by many threads at once, based on a tutorial at
+https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+
+/*
+	with --concurrent, readers crab down the tree with read latches
+	while one writer at a time latches what it changes, top-down, and
+	holds it until the end of its step; the pool mutex only guards the
+	pool's bookkeeping, and nobody waits on a latch while holding it
+*/
+
+/* the pager the calling thread is writing to, if any */
+static __thread Pager* writing_pager = NULL;
+
+/*
+	sets up the latches for every frame of the buffer pool, if the
+	pager was opened for concurrent use
+
+	pager: pointer to a freshly opened Pager struct
+*/
+void open_latches(Pager* pager) {
+	if (!pager->concurrent) {
+		return;
+	}
+	pthread_rwlockattr_t attributes;
+	pthread_rwlockattr_init(&attributes);
+	pthread_rwlockattr_setkind_np(&attributes, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+	for (uint32_t i = 0; i < pager->num_frames; i++) {
+		pthread_rwlock_init(&pager->frames[i].latch, &attributes);
+	}
+	pthread_rwlockattr_destroy(&attributes);
+	pthread_mutex_init(&pager->pool_lock, NULL);
+	pthread_mutex_init(&pager->writer_lock, NULL);
+	pager->writer_frames = malloc(pager->num_frames * sizeof(uint32_t));
+	pager->num_writer_frames = 0;
+}
+
+/* tears down what open_latches() set up */
+void close_latches(Pager* pager) {
+	if (!pager->concurrent) {
+		return;
+	}
+	for (uint32_t i = 0; i < pager->num_frames; i++) {
+		pthread_rwlock_destroy(&pager->frames[i].latch);
+	}
+	pthread_mutex_destroy(&pager->pool_lock);
+	pthread_mutex_destroy(&pager->writer_lock);
+	free(pager->writer_frames);
+}
+
+/* takes the buffer pool's mutex (if there's anyone to share it with) */
+void lock_pool(Pager* pager) {
+	if (pager->concurrent) {
+		pthread_mutex_lock(&pager->pool_lock);
+	}
+}
+
+/* lets go of the buffer pool's mutex */
+void unlock_pool(Pager* pager) {
+	if (pager->concurrent) {
+		pthread_mutex_unlock(&pager->pool_lock);
+	}
+}
+
+/* returns true if the calling thread is the one writing to the pager */
+bool is_writer(Pager* pager) {
+	return writing_pager == pager;
+}
+
+/*
+	makes the calling thread the pager's writer, waiting for the
+	current one to finish first
+
+	pager: pointer to a populated Pager struct
+*/
+void begin_write(Pager* pager) {
+	if (!pager->concurrent) {
+		return;
+	}
+	pthread_mutex_lock(&pager->writer_lock);
+	writing_pager = pager;
+}
+
+/* lets go of everything the writer holds and lets the next one in */
+void end_write(Pager* pager) {
+	if (!pager->concurrent) {
+		return;
+	}
+	release_write_latches(pager);
+	writing_pager = NULL;
+	pthread_mutex_unlock(&pager->writer_lock);
+}
+
+/*
+	keeps the page in the given frame pinned until the writer's step
+	is over -- must be called with the pool mutex held
+
+	pager: pointer to a populated Pager struct
+	frame_index: index of the frame the writer just got
+*/
+void hold_frame_for_writer(Pager* pager, uint32_t frame_index) {
+	Frame* frame = &pager->frames[frame_index];
+	if (!frame->held_by_writer) {
+		frame->held_by_writer = true;
+		frame->pin_count++;
+		pager->writer_frames[pager->num_writer_frames++] = frame_index;
+	}
+}
+
+/*
+	latches the given page for writing, unless the writer has it
+	latched already -- the page has to be held by the writer
+
+	pager: pointer to a populated Pager struct
+	frame_index: index of the frame holding the page
+*/
+void latch_frame_for_write(Pager* pager, uint32_t frame_index) {
+	Frame* frame = &pager->frames[frame_index];
+	if (!frame->write_latched) {
+		pthread_rwlock_wrlock(&frame->latch);
+		frame->write_latched = true;
+	}
+}
+
+/*
+	latches every node from the root down to the given leaf for
+	writing, before a step that might change more than the leaf
+
+	pager: pointer to a populated Pager struct
+	page_num: number of the leaf
+*/
+void latch_path_for_write(Pager* pager, uint32_t page_num) {
+	if (!pager->concurrent) {
+		return;
+	}
+
+	/* the writer can follow the parent pointers up without latches,
+	since it's the only one that changes them */
+	uint32_t path[MAX_TREE_DEPTH];
+	uint32_t depth = 0;
+	void* node = get_page(pager, page_num);
+	path[depth++] = page_num;
+	while (!is_node_root(node)) {
+		page_num = *get_node_parent(node);
+		node = get_page(pager, page_num);
+		path[depth++] = page_num;
+	}
+
+	while (depth > 0) {
+		page_num = path[--depth];
+		lock_pool(pager);
+		uint32_t frame_index = find_frame(pager, page_num);
+		unlock_pool(pager);
+		latch_frame_for_write(pager, frame_index);
+	}
+}
+
+/*
+	ends the writer's step: its write latches are released and the
+	pages it was holding can be evicted again
+
+	pager: pointer to a populated Pager struct
+*/
+void release_write_latches(Pager* pager) {
+	if (!pager->concurrent) {
+		return;
+	}
+	lock_pool(pager);
+	for (uint32_t i = 0; i < pager->num_writer_frames; i++) {
+		Frame* frame = &pager->frames[pager->writer_frames[i]];
+		if (frame->write_latched) {
+			frame->write_latched = false;
+			pthread_rwlock_unlock(&frame->latch);
+		}
+		frame->held_by_writer = false;
+		frame->pin_count--;
+	}
+	pager->num_writer_frames = 0;
+	unlock_pool(pager);
+}
+
+/*
+	marks a frame that was just claimed as loading: it stays pinned,
+	and in concurrent mode latched for writing, until the page has
+	been read into it, so the read can happen without the pool mutex
+	-- must be called with the pool mutex held
+
+	pager: pointer to a populated Pager struct
+	frame_index: index of the claimed frame
+*/
+void start_loading_frame(Pager* pager, uint32_t frame_index) {
+	Frame* frame = &pager->frames[frame_index];
+	frame->loading = true;
+	frame->pin_count++;
+	/* nobody can hold the latch of a frame that was free to claim,
+	so this never has to wait with the pool mutex held */
+	if (pager->concurrent && pthread_rwlock_trywrlock(&frame->latch) != 0) {
+		printf("Somebody's latched frame %d, which was supposed to be free\n", frame_index);
+		exit(EXIT_FAILURE);
+	}
+}
+
+/* publishes a page read in after start_loading_frame(), waking up
+anyone waiting on it -- must be called with the pool mutex held */
+void finish_loading_frame(Pager* pager, uint32_t frame_index) {
+	Frame* frame = &pager->frames[frame_index];
+	frame->loading = false;
+	frame->pin_count--;
+	if (pager->concurrent) {
+		pthread_rwlock_unlock(&frame->latch);
+	}
+}
+
+/*
+	waits for another thread to finish reading a page into the given
+	frame; the pool mutex is let go while waiting on the frame's
+	latch, and the pin keeps the frame from being reused meanwhile
+
+	pager: pointer to a populated Pager struct, with the pool mutex held
+	frame_index: index of the loading frame
+*/
+void wait_for_frame_load(Pager* pager, uint32_t frame_index) {
+	Frame* frame = &pager->frames[frame_index];
+	frame->pin_count++;
+	while (frame->loading) {
+		unlock_pool(pager);
+		pthread_rwlock_rdlock(&frame->latch);
+		pthread_rwlock_unlock(&frame->latch);
+		lock_pool(pager);
+	}
+	frame->pin_count--;
+}
+
+/*
+	pins the given page and latches it for reading, waiting for the
+	writer if it has the page latched -- the writer itself just pins
+	it, since it never needs a latch to read
+
+	pager: pointer to a populated Pager struct
+	page_num: number of the desired page
+	returns: pointer to the page, which stays put until unlatch_page()
+*/
+void* latch_page(Pager* pager, uint32_t page_num) {
+	if (!pager->concurrent || is_writer(pager)) {
+		return pin_page(pager, page_num);
+	}
+	lock_pool(pager);
+	uint32_t frame_index = fetch_frame(pager, page_num);
+	Frame* frame = &pager->frames[frame_index];
+	frame->pin_count++;
+	unlock_pool(pager);
+	pthread_rwlock_rdlock(&frame->latch);
+	return frame->data;
+}
+
+/*
+	like latch_page(), but gives up instead of waiting
+
+	pager: pointer to a populated Pager struct
+	page_num: number of the desired page
+	returns: pointer to the page, or NULL if the writer has it
+*/
+void* try_latch_page(Pager* pager, uint32_t page_num) {
+	if (!pager->concurrent || is_writer(pager)) {
+		return pin_page(pager, page_num);
+	}
+	lock_pool(pager);
+	uint32_t frame_index = fetch_frame(pager, page_num);
+	Frame* frame = &pager->frames[frame_index];
+	void* page = NULL;
+	if (pthread_rwlock_tryrdlock(&frame->latch) == 0) {
+		frame->pin_count++;
+		page = frame->data;
+	}
+	unlock_pool(pager);
+	return page;
+}
+
+/* releases a latch from latch_page() or try_latch_page() */
+void unlatch_page(Pager* pager, uint32_t page_num) {
+	if (!pager->concurrent || is_writer(pager)) {
+		unpin_page(pager, page_num);
+		return;
+	}
+	lock_pool(pager);
+	Frame* frame = &pager->frames[find_frame(pager, page_num)];
+	pthread_rwlock_unlock(&frame->latch);
+	frame->pin_count--;
+	unlock_pool(pager);
+}
@@ -0,0 +1,127 @@
+/* 
+ 
+This program runs the command line for a minimalistic SQLite database
+based on a tutorial at https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h" 
+
+/* */
+int main(int argc, char* argv[]) {
+
+	/* require that the user specify a DB filename */
+	if (argc < 2) {
+		printf("Must supply a database filename.\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* anything after the filename tunes how the DB is opened, or
+	how its rows are written out */
+	DatabaseOptions options;
+	set_default_options(&options);
+	OutputFormat format = OUTPUT_TEXT;
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			if (!parse_output_format(argv[++i], &format)) {
+				printf("I can't write rows as '%s' -- try text, tsv, csv or binary\n", argv[i]);
+				exit(EXIT_FAILURE);
+			}
+		} else if (!parse_database_option(argc, argv, &i, &options)) {
+			printf("Unknown option '%s'\n", argv[i]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* initialize variables */
+	open_standard_output(format);
+	Statement statement;
+	statement.rows_to_insert = NULL;
+	statement.rows_capacity = 0;
+	InputBuffer* input_buffer = new_input_buffer();
+	char* filename = argv[1];
+	Database* database = open_database(filename, &options);
+
+	/* read standard input into the buffer until "-exit" is read */
+	while (true) {
+
+		/* ask for input to get something to store in the DB */
+		print_prompt();
+		read_input(input_buffer);
+
+		/* determine if the input was a command or statement (commands
+		have a "mk_" prefix */
+		if (input_buffer->buffer[0] == 'm' && input_buffer->buffer[1] == 'k') {
+
+			/* meta commands print with printf(), so what's buffered
+			goes out first, and what they print goes out right after */
+			flush_standard_output();
+			MetaCommandResult result = implement_command(input_buffer, database);
+			fflush(stdout);
+			switch (result) {
+				case (META_COMMAND_SUCCESS):
+					continue;
+				case (META_COMMAND_UNRECOGNIZED):
+					print_message("Look at you, trying to invent commands: '%s'\n", input_buffer->buffer);
+					continue;
+			}
+		}
+
+		/* if we've gotten here, the input was not a command */
+		switch (check_statement(input_buffer, &statement, database)) {
+			case (RECOGNIZED):
+				break;
+			case (UNRECOGNIZED):
+				print_message("Look at you, trying to invent statements: '%s'\n", input_buffer->buffer);	
+				continue;
+			case (SYNTAX_ERROR):
+				print_message("That syntax is wack\n");
+		        continue;
+	        case (STRING_TOO_LONG):
+	        	print_message("Your strings are coming on a little too long\n");
+	        	continue;
+        	case (NEGATIVE_ID):
+        		print_message("I like my IDs like I like my attitudes: positive\n");
+        		continue;
+        	case (UNKNOWN_TABLE):
+        		print_message("Error: never heard of that table\n");
+        		continue;
+        	case (UNKNOWN_COLUMN):
+        		print_message("Error: that table doesn't have that column\n");
+        		continue;
+		}
+
+		/* execute recognized statement */
+		switch (run_statement(&statement, database)) {
+			case (EXECUTE_SUCCESS):
+				print_message("Executed!\n");
+				break;
+			case (EXECUTE_TABLE_FULL):
+				print_message("Error: the table ate too much for dinner\n");
+				break;
+			case (EXECUTE_DUPLICATE_KEY):
+				print_message("Error: I don't like seconds\n");
+				break;
+			case (EXECUTE_INDEX_EXISTS):
+				print_message("Error: that column's already got an index\n");
+				break;
+			case (EXECUTE_TABLE_EXISTS):
+				print_message("Error: that table's already a thing\n");
+				break;
+			case (EXECUTE_CATALOG_FULL):
+				print_message("Error: this file can't keep track of any more tables\n");
+				break;
+			case (EXECUTE_UNSORTED_INPUT):
+			case (EXECUTE_TABLE_NOT_EMPTY):
+			case (EXECUTE_BAD_ROW):
+			case (EXECUTE_FILE_ERROR):
+				/* only a bulk load ends like this, and mk_bulkload
+				prints its own errors */
+				break;
+    	}
+	}
+}
+
@@ -0,0 +1,409 @@
+/*
+
+This program implements the output of results for a minimalistic
+SQLite DB based on a tutorial at https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+
+/*
+	rows, the prompt and messages all go through an OutputBuffer that
+	is written out when it fills up, before reading from a terminal,
+	before a meta command and at exit; --output picks text, tsv, csv
+	or binary rows, and with anything but text the prompt and the
+	messages go to stderr
+*/
+
+
+/* two digits for every number under 100, so an int is turned into
+text half as many divisions at a time */
+static const char digit_pairs[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static OutputBuffer standard_output;
+static bool input_is_terminal = false;
+
+
+/*
+	reads the name of an output format
+
+	name: pointer to a string containing text, tsv, csv or binary
+	format: set to the format by that name
+	returns: false if there's no format by that name
+*/
+bool parse_output_format(const char* name, OutputFormat* format) {
+	const char* names[] = { "text", "tsv", "csv", "binary" };
+	for (uint32_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+		if (strcmp(name, names[i]) == 0) {
+			*format = OUTPUT_TEXT + i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+	sets up an empty OutputBuffer -- it doesn't get any memory until
+	something is written into it
+
+	output: pointer to the OutputBuffer struct to set up
+	fd: file descriptor it's written to when it fills up, or -1 for a
+		buffer that grows instead
+	format: how rows are written into it
+*/
+void init_output_buffer(OutputBuffer* output, int fd, OutputFormat format) {
+	output->data = NULL;
+	output->length = 0;
+	output->capacity = 0;
+	output->fd = fd;
+	output->format = format;
+	output->row_start = 0;
+	output->num_values = 0;
+}
+
+/* frees the memory of an OutputBuffer, without writing it out */
+void free_output_buffer(OutputBuffer* output) {
+	free(output->data);
+	init_output_buffer(output, output->fd, output->format);
+}
+
+/* writes out everything in an OutputBuffer that has an fd */
+void flush_output(OutputBuffer* output) {
+	if (output->fd < 0) {
+		return;
+	}
+	size_t written = 0;
+	while (written < output->length) {
+		ssize_t result = write(output->fd, output->data + written, output->length - written);
+		if (result < 0 && errno == EINTR) {
+			continue;
+		}
+		if (result <= 0) {
+			/* there's nowhere for the rest to go, and exit() would
+			try to write it again */
+			output->length = 0;
+			fprintf(stderr, "Couldn't write the output %d\n", errno);
+			exit(EXIT_FAILURE);
+		}
+		written += result;
+	}
+	output->length = 0;
+}
+
+/*
+	makes sure the given number of bytes fits in an OutputBuffer
+	after what it already has, writing it out (if it has an fd) or
+	growing it if they don't
+
+	output: pointer to the OutputBuffer struct
+	length: number of bytes that are about to be written into it
+*/
+void make_output_room(OutputBuffer* output, size_t length) {
+	if (output->length + length <= output->capacity) {
+		return;
+	}
+	flush_output(output);
+	if (output->length + length <= output->capacity) {
+		return;
+	}
+	size_t capacity = (output->capacity == 0) ? OUTPUT_BUFFER_SIZE : output->capacity;
+	while (capacity < output->length + length) {
+		capacity *= 2;
+	}
+	output->data = realloc(output->data, capacity);
+	output->capacity = capacity;
+}
+
+/*
+	copies bytes into an OutputBuffer -- a run of bytes at least as
+	big as the buffer goes straight to the fd instead
+
+	output: pointer to the OutputBuffer struct
+	data: pointer to the bytes
+	length: number of bytes
+*/
+void write_output(OutputBuffer* output, const void* data, size_t length) {
+	if (length == 0) {
+		return;
+	}
+	if (output->fd >= 0 && output->capacity > 0 && length >= output->capacity) {
+		flush_output(output);
+		OutputBuffer direct = *output;
+		direct.data = (char*) data;
+		direct.length = length;
+		flush_output(&direct);
+		return;
+	}
+	make_output_room(output, length);
+	memcpy(output->data + output->length, data, length);
+	output->length += length;
+}
+
+/* writes the digits of a number into an OutputBuffer, two at a time
+from the end */
+void write_output_uint(OutputBuffer* output, uint64_t value) {
+	char digits[20];
+	char* end = digits + sizeof(digits);
+	char* start = end;
+	while (value >= 100) {
+		start -= 2;
+		memcpy(start, digit_pairs + (value % 100) * 2, 2);
+		value /= 100;
+	}
+	if (value >= 10) {
+		start -= 2;
+		memcpy(start, digit_pairs + value * 2, 2);
+	} else {
+		*--start = '0' + value;
+	}
+	write_output(output, start, end - start);
+}
+
+/* starts a row in an OutputBuffer, in its format */
+void begin_output_row(OutputBuffer* output) {
+	output->num_values = 0;
+	switch (output->format) {
+		case (OUTPUT_TEXT):
+			write_output(output, "(", 1);
+			break;
+		case (OUTPUT_BINARY):
+			/* the row's length is filled in at its end, so the whole
+			row has to fit without the buffer being written out */
+			make_output_room(output, OUTPUT_MAX_ROW_SIZE);
+			output->row_start = output->length;
+			output->length += sizeof(uint32_t);
+			break;
+		default:
+			break;
+	}
+}
+
+/* starts the next value of a row, after whatever separates it from
+the one before */
+void begin_output_value(OutputBuffer* output) {
+	if (output->num_values++ == 0) {
+		return;
+	}
+	switch (output->format) {
+		case (OUTPUT_TEXT):
+			write_output(output, ", ", 2);
+			break;
+		case (OUTPUT_TSV):
+			write_output(output, "\t", 1);
+			break;
+		case (OUTPUT_CSV):
+			write_output(output, ",", 1);
+			break;
+		case (OUTPUT_BINARY):
+			break;
+	}
+}
+
+/*
+	writes an int as the next value of a row
+
+	output: pointer to the OutputBuffer struct
+	value: the int
+	size: how many bytes it takes in a binary row (4 or 8)
+*/
+void write_int_value(OutputBuffer* output, int64_t value, uint32_t size) {
+	begin_output_value(output);
+	if (output->format == OUTPUT_BINARY) {
+		uint8_t length = size;
+		int32_t small_value = value;
+		write_output(output, &length, STRING_LENGTH_SIZE);
+		write_output(output, (size == sizeof(int32_t)) ? (void*) &small_value : (void*) &value, size);
+		return;
+	}
+	if (value < 0) {
+		write_output(output, "-", 1);
+		write_output_uint(output, -(uint64_t) value);
+	} else {
+		write_output_uint(output, value);
+	}
+}
+
+/* returns true if a character of a string has to be escaped (for
+tsv) or has to have the string quoted (for csv) */
+bool needs_escaping(OutputFormat format, char character) {
+	switch (character) {
+		case ('\n'):
+		case ('\r'):
+			return true;
+		case ('\t'):
+		case ('\\'):
+			return format == OUTPUT_TSV;
+		case (','):
+		case ('"'):
+			return format == OUTPUT_CSV;
+		default:
+			return false;
+	}
+}
+
+/*
+	writes a string as the next value of a row, escaping or quoting
+	it however the format needs
+
+	output: pointer to the OutputBuffer struct
+	string: pointer to the string, which doesn't have to be null
+		terminated
+	length: length of the string
+*/
+void write_string_value(OutputBuffer* output, const char* string, uint32_t length) {
+	begin_output_value(output);
+	switch (output->format) {
+		case (OUTPUT_TEXT):
+			write_output(output, string, length);
+			return;
+		case (OUTPUT_BINARY): {
+			uint8_t string_length = length;
+			write_output(output, &string_length, STRING_LENGTH_SIZE);
+			write_output(output, string, length);
+			return;
+		}
+		default:
+			break;
+	}
+
+	/* most strings have nothing to escape, and go in with one copy */
+	uint32_t i = 0;
+	while (i < length && !needs_escaping(output->format, string[i])) {
+		i++;
+	}
+	if (i == length) {
+		write_output(output, string, length);
+		return;
+	}
+
+	if (output->format == OUTPUT_TSV) {
+		for (i = 0; i < length; i++) {
+			switch (string[i]) {
+				case ('\t'): write_output(output, "\\t", 2); break;
+				case ('\n'): write_output(output, "\\n", 2); break;
+				case ('\r'): write_output(output, "\\r", 2); break;
+				case ('\\'): write_output(output, "\\\\", 2); break;
+				default: write_output(output, &string[i], 1); break;
+			}
+		}
+	} else {
+		write_output(output, "\"", 1);
+		for (i = 0; i < length; i++) {
+			if (string[i] == '"') {
+				write_output(output, "\"", 1);
+			}
+			write_output(output, &string[i], 1);
+		}
+		write_output(output, "\"", 1);
+	}
+}
+
+/* writes a NULL as the next value of a row -- a binary row has no
+way to say that, so a NULL has to be its row's only value */
+void write_null_value(OutputBuffer* output) {
+	if (output->format == OUTPUT_BINARY) {
+		return;
+	}
+	begin_output_value(output);
+	switch (output->format) {
+		case (OUTPUT_TEXT):
+			write_output(output, "NULL", 4);
+			break;
+		case (OUTPUT_TSV):
+			write_output(output, "\\N", 2);
+			break;
+		default:
+			break;
+	}
+}
+
+/* ends a row in an OutputBuffer, in its format */
+void end_output_row(OutputBuffer* output) {
+	switch (output->format) {
+		case (OUTPUT_TEXT):
+			write_output(output, ")\n", 2);
+			break;
+		case (OUTPUT_BINARY): {
+			uint32_t length = output->length - output->row_start - sizeof(uint32_t);
+			memcpy(output->data + output->row_start, &length, sizeof(uint32_t));
+			break;
+		}
+		default:
+			write_output(output, "\n", 1);
+			break;
+	}
+}
+
+/*
+	sets up the buffer for standard output, which is written out at
+	exit if it isn't before
+
+	format: how rows are written to standard output
+*/
+void open_standard_output(OutputFormat format) {
+	init_output_buffer(&standard_output, STDOUT_FILENO, format);
+	make_output_room(&standard_output, OUTPUT_BUFFER_SIZE);
+	input_is_terminal = isatty(STDIN_FILENO);
+	atexit(flush_standard_output);
+}
+
+/* returns the buffer for standard output, setting it up for text if
+it hasn't been yet */
+OutputBuffer* get_standard_output() {
+	if (standard_output.data == NULL) {
+		open_standard_output(OUTPUT_TEXT);
+	}
+	return &standard_output;
+}
+
+/* writes out everything in standard output's buffer */
+void flush_standard_output() {
+	flush_output(&standard_output);
+}
+
+/* writes out standard output's buffer if somebody's waiting at a
+terminal to see it before typing the next line */
+void flush_output_for_input() {
+	if (input_is_terminal) {
+		flush_standard_output();
+	}
+}
+
+/*
+	prints a message for whoever's typing -- into standard output's
+	buffer with text output, or to stderr with anything else, so the
+	rows are all standard output gets
+
+	format: printf() format string, followed by its arguments
+*/
+void print_message(const char* format, ...) {
+	va_list arguments;
+	va_start(arguments, format);
+	OutputBuffer* output = get_standard_output();
+	if (output->format != OUTPUT_TEXT) {
+		vfprintf(stderr, format, arguments);
+	} else {
+		char message[MAX_MESSAGE_SIZE];
+		int length = vsnprintf(message, sizeof(message), format, arguments);
+		if (length >= (int) sizeof(message)) {
+			length = sizeof(message) - 1;
+		}
+		if (length > 0) {
+			write_output(output, message, length);
+		}
+	}
+	va_end(arguments);
+}
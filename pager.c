@@ -10,14 +10,155 @@ at Olin College of Engineering.
 
 #include "diylite.h"
 
+/* fills in the options used when the caller doesn't care */
+void set_default_options(DatabaseOptions* options) {
+	options->cache_frames = 0;
+	options->use_mmap = false;
+	options->use_wal = false;
+	options->group_commit_ms = DEFAULT_GROUP_COMMIT_MS;
+	options->group_commit_bytes = DEFAULT_GROUP_COMMIT_BYTES;
+	options->checkpoint_bytes = DEFAULT_CHECKPOINT_BYTES;
+	options->page_size = DEFAULT_PAGE_SIZE;
+	options->key_search = NULL;
+	options->max_read_ahead = DEFAULT_MAX_READ_AHEAD;
+	options->io_backend = NULL;
+	options->concurrent = false;
+	options->scan_threads = 1;
+}
+
+/* 
+	reads one of the command line flags that tune how the DB is
+	opened, along with its value if it takes one
+
+	argc: number of command line arguments
+	argv: the command line arguments
+	i: index of the flag; moved onto the value if the flag takes one
+	options: pointer to the options the flag sets
+	returns: false if argv[i] isn't one of the DB flags
+*/
+bool parse_database_option(int argc, char* argv[], int* i, DatabaseOptions* options) {
+	bool has_value = (*i + 1 < argc);
+	if (strcmp(argv[*i], "--cache-frames") == 0 && has_value) {
+		options->cache_frames = atoi(argv[++*i]);
+	} else if (strcmp(argv[*i], "--mmap") == 0) {
+		options->use_mmap = true;
+	} else if (strcmp(argv[*i], "--wal") == 0) {
+		options->use_wal = true;
+	} else if (strcmp(argv[*i], "--group-commit-ms") == 0 && has_value) {
+		options->group_commit_ms = atoi(argv[++*i]);
+	} else if (strcmp(argv[*i], "--group-commit-kb") == 0 && has_value) {
+		options->group_commit_bytes = atoi(argv[++*i]) * 1024;
+	} else if (strcmp(argv[*i], "--checkpoint-kb") == 0 && has_value) {
+		options->checkpoint_bytes = atoi(argv[++*i]) * 1024;
+	} else if (strcmp(argv[*i], "--page-size") == 0 && has_value) {
+		options->page_size = atoi(argv[++*i]);
+	} else if (strcmp(argv[*i], "--key-search") == 0 && has_value) {
+		options->key_search = argv[++*i];
+	} else if (strcmp(argv[*i], "--read-ahead") == 0 && has_value) {
+		options->max_read_ahead = atoi(argv[++*i]);
+	} else if (strcmp(argv[*i], "--io-backend") == 0 && has_value) {
+		options->io_backend = argv[++*i];
+	} else if (strcmp(argv[*i], "--concurrent") == 0) {
+		options->concurrent = true;
+	} else if (strcmp(argv[*i], "--scan-threads") == 0 && has_value) {
+		options->scan_threads = atoi(argv[++*i]);
+	} else {
+		return false;
+	}
+	return true;
+}
+
+/* returns true for the page sizes a DB can use: a power of two from
+MIN_PAGE_SIZE to MAX_PAGE_SIZE */
+bool is_valid_page_size(uint32_t page_size) {
+	return page_size >= MIN_PAGE_SIZE && page_size <= MAX_PAGE_SIZE &&
+		(page_size & (page_size - 1)) == 0;
+}
+
+/*
+	works out the node layout for the given page size -- bigger pages
+	mean more rows per leaf and more children per internal node, so a
+	shallower tree and fewer reads per scan
+
+	pager: pointer to the Pager struct to fill in
+	page_size: the DB's page size, which must be valid
+*/
+void set_page_layout(Pager* pager, uint32_t page_size) {
+	pager->page_size = page_size;
+	pager->leaf_node_space_for_cells = page_size - LEAF_NODE_HEADER_SIZE;
+	pager->leaf_node_max_cells = pager->leaf_node_space_for_cells / (LEAF_NODE_SLOT_SIZE + MIN_ROW_SIZE);
+	/* well under half, so that evening out two leaves doesn't leave
+	one about to underflow again */
+	pager->leaf_node_min_space_used = pager->leaf_node_space_for_cells / 4;
+	pager->internal_node_max_cells = (page_size - INTERNAL_NODE_HEADER_SIZE) / INTERNAL_NODE_CELL_SIZE;
+	pager->internal_node_min_cells = pager->internal_node_max_cells / 2;
+}
+
+/*
+	finds out the page size of a DB file, writing the header page
+	first if the file is new
+
+	fd: descriptor of the open DB file
+	options: pointer to the options the DB is being opened with
+	returns: the file's page size
+*/
+uint32_t read_page_size(int fd, DatabaseOptions* options) {
+	char fields[DB_HEADER_FIELDS_SIZE];
+
+	/* a new file gets its header page straight away, so the page size
+	is on disk before anything can be logged in the WAL with it */
+	struct stat file_info;
+	if (fstat(fd, &file_info) == -1) {
+		printf("Couldn't look at the DB file %d\n", errno);
+		exit(EXIT_FAILURE);
+	}
+	if (file_info.st_size == 0) {
+		if (!is_valid_page_size(options->page_size)) {
+			printf("A page size of %u? Pick a power of two from %d to %d\n",
+				options->page_size, MIN_PAGE_SIZE, MAX_PAGE_SIZE);
+			exit(EXIT_FAILURE);
+		}
+		char* header = calloc(1, options->page_size);
+		memcpy(header + DB_MAGIC_OFFSET, DB_MAGIC, DB_MAGIC_SIZE);
+		*(uint32_t*)(header + DB_PAGE_SIZE_OFFSET) = options->page_size;
+		*(uint32_t*)(header + DB_FORMAT_VERSION_OFFSET) = DB_FORMAT_VERSION;
+		if (!pwrite_fully(fd, header, options->page_size, 0) || fsync(fd) == -1) {
+			printf("Error writing the header page: %d\n", errno);
+			exit(EXIT_FAILURE);
+		}
+		free(header);
+	}
+
+	if (!pread_fully(fd, fields, DB_HEADER_FIELDS_SIZE, 0) ||
+		memcmp(fields + DB_MAGIC_OFFSET, DB_MAGIC, DB_MAGIC_SIZE) != 0) {
+		printf("That file doesn't look like one of mine -- no diylite header\n");
+		exit(EXIT_FAILURE);
+	}
+
+	uint32_t format_version = *(uint32_t*)(fields + DB_FORMAT_VERSION_OFFSET);
+	if (format_version != DB_FORMAT_VERSION) {
+		printf("That file's format is version %u and I only speak version %d -- start a new one\n",
+			format_version, DB_FORMAT_VERSION);
+		exit(EXIT_FAILURE);
+	}
+
+	uint32_t page_size = *(uint32_t*)(fields + DB_PAGE_SIZE_OFFSET);
+	if (!is_valid_page_size(page_size)) {
+		printf("The header says the pages are %u bytes, which is nonsense\n", page_size);
+		exit(EXIT_FAILURE);
+	}
+	return page_size;
+}
+
 /*
 	opens the given file and uses its contents to initialize a
 	Pager struct
 	
 	filename: pointer to a string containing the DB filename
+	options: pointer to the options the DB is being opened with
 	returns: pointer to a Pager struct for the existing DB file
 */
-Pager* open_pager(const char* filename) {
+Pager* open_pager(const char* filename, DatabaseOptions* options) {
 	int fd = open(filename,
 	/* read/write mode | create file if it does not exist */
 		O_RDWR | O_CREAT,
@@ -30,145 +171,756 @@ Pager* open_pager(const char* filename) {
 		exit(EXIT_FAILURE);
 	}
 
-	off_t file_length = lseek(fd, 0, SEEK_END);
+	/* the page size decides how the WAL's records are laid out, so
+	it's needed before recovery; then finish any statements a crash
+	left in the WAL before looking at the rest of the file */
+	uint32_t page_size = read_page_size(fd, options);
+	recover_wal(fd, filename, page_size);
+
+	struct stat file_info;
+	if (fstat(fd, &file_info) == -1) {
+		printf("Couldn't look at the DB file %d\n", errno);
+		exit(EXIT_FAILURE);
+	}
+	off_t file_length = file_info.st_size;
 
 	/* initialize a Pager struct with the gathered file information */
 	Pager* pager = malloc(sizeof(Pager));
 	pager->file_descriptor = fd;
 	pager->file_length = file_length;
-	pager->num_pages = (file_length / PAGE_SIZE);
+	set_page_layout(pager, page_size);
+	pager->num_pages = (file_length / page_size);
 
 	/* make sure the DB file is wholesome...lol */
-	if (file_length % PAGE_SIZE != 0) {
+	if (file_length % page_size != 0) {
 		printf("The DB file is not a whole number of pages. Someone's been bribing this file because it is corrupt AF\n");
 		exit(EXIT_FAILURE);
 	}
 
-	/* initialize the page cache to all NULLs */	
-	for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++) {
-		pager->pages[i] = NULL;
+	/* set up the buffer pool; the memory behind each frame is only
+	allocated the first time the frame is used, so small DBs stay small */
+	uint32_t min_frames = MIN_CACHE_FRAMES;
+	/* the writer in concurrent mode holds on to everything it touches
+	until the end of its step, and splitting an internal node rewrites
+	the parent pointer of every child that moves -- so it needs room
+	for a couple of those */
+	if (options->concurrent && min_frames < 2 * pager->internal_node_max_cells) {
+		min_frames = 2 * pager->internal_node_max_cells;
+	}
+	uint32_t num_frames = options->cache_frames;
+	if (num_frames == 0) {
+		num_frames = (DEFAULT_CACHE_FRAMES > min_frames) ? DEFAULT_CACHE_FRAMES : min_frames;
+	} else if (num_frames < min_frames) {
+		printf("%u frames won't fit what a statement might hold on to; give me at least %u\n",
+			num_frames, min_frames);
+		exit(EXIT_FAILURE);
+	}
+	pager->num_frames = num_frames;
+	pager->frames = calloc(num_frames, sizeof(Frame));
+	pager->frames_in_use = 0;
+	pager->clock_hand = 0;
+
+	if (options->concurrent && options->use_mmap) {
+		printf("Latches need frames to live in, so --concurrent and --mmap don't mix\n");
+		exit(EXIT_FAILURE);
+	}
+	pager->concurrent = options->concurrent;
+	open_latches(pager);
+
+	/* scan threads are readers like any other, so they need latches */
+	pager->scan_threads = (options->scan_threads > 0) ? options->scan_threads : 1;
+	if (pager->scan_threads > 1 && !options->concurrent) {
+		printf("Scan threads would trip over each other without latches -- add --concurrent\n");
+		exit(EXIT_FAILURE);
 	}
 
+	/* initialize the page table to all empty buckets */
+	pager->num_buckets = num_frames;
+	pager->buckets = malloc(num_frames * sizeof(uint32_t));
+	for (uint32_t i = 0; i < num_frames; i++) {
+		pager->buckets[i] = INVALID_FRAME;
+	}
+
+	/* in mmap mode, chunks of the file get mapped as they're first
+	touched, so there's nothing to map yet */
+	pager->use_mmap = options->use_mmap;
+	pager->chunks = NULL;
+	pager->num_chunks = 0;
+	pager->num_dirty_mapped_pages = 0;
+	pager->max_read_ahead = options->max_read_ahead;
+
+	pager->io = open_io_backend(fd, options->io_backend);
+	if (pager->io == NULL) {
+		printf("There's no '%s' I/O around here -- try io_uring, threads or sync\n", options->io_backend);
+		exit(EXIT_FAILURE);
+	}
+
+	/* node searches go through whichever kernel is chosen here, so
+	pick it before anything gets searched */
+	if (options->key_search != NULL && !set_key_search_kernel(options->key_search)) {
+		printf("I don't know how to search keys with '%s' -- not on this CPU, anyway\n", options->key_search);
+		exit(EXIT_FAILURE);
+	}
+	/* the kernel is picked the first time it's asked for, so pick it
+	now rather than have reader threads race to do it */
+	get_key_search_kernel();
+
+	memset(&pager->stats, 0, sizeof(Stats));
+	pager->stats_dump_file = NULL;
+	pager->wal = NULL;
+	if (options->use_wal) {
+		pager->wal = open_wal(filename, options);
+	}
+	pager->statement_pages = NULL;
+	pager->num_statement_pages = 0;
+	pager->statement_pages_capacity = 0;
+
 	return pager;
 }
 
+/* returns the index of the frame holding the given page, or 
+INVALID_FRAME if the page isn't cached */
+uint32_t find_frame(Pager* pager, uint32_t page_num) {
+	uint32_t frame_index = pager->buckets[page_num % pager->num_buckets];
+	while (frame_index != INVALID_FRAME && 
+		pager->frames[frame_index].page_num != page_num) {
+		frame_index = pager->frames[frame_index].next_in_bucket;
+	}
+	return frame_index;
+}
+
+/* unlinks the given frame from its page table bucket */
+void remove_frame_from_bucket(Pager* pager, uint32_t frame_index) {
+	uint32_t* link = &pager->buckets[pager->frames[frame_index].page_num % pager->num_buckets];
+	while (*link != frame_index) {
+		link = &pager->frames[*link].next_in_bucket;
+	}
+	*link = pager->frames[frame_index].next_in_bucket;
+}
+
 /*
-	gets the specified page number from the Pager struct
+	picks a frame to reuse with the CLOCK algorithm: the hand sweeps
+	the pool, giving recently referenced frames a second chance and
+	skipping pinned ones; the victim is written back if it's dirty,
+	or into the WAL if its statement hasn't committed yet
 	
 	pager: pointer to a populated Pager struct
-	page_num: number of the desired page
-	returns: pointer to the desired page
+	returns: index of the now-empty frame, or INVALID_FRAME if every
+		frame is pinned (or, for a reader, uncommitted)
 */
-void* get_page(Pager* pager, uint32_t page_num) {
-	/* make sure the page is gettable before proceeding */
-	if (page_num > TABLE_MAX_PAGES) {
-		printf("Page #%d is out of order! Or rather, bounds...\n", 
-			page_num);
-		exit(EXIT_FAILURE);
+uint32_t evict_frame(Pager* pager) {
+	/* two full sweeps are enough to clear every reference bit, so
+	if we still haven't found a victim, everything is pinned */
+	for (uint32_t i = 0; i < 2 * pager->num_frames; i++) {
+		uint32_t frame_index = pager->clock_hand;
+		Frame* frame = &pager->frames[frame_index];
+		pager->clock_hand = (frame_index + 1) % pager->num_frames;
+
+		/* only the writer can steal an uncommitted page, since it
+		goes into the WAL under the writer's statement */
+		if (frame->pin_count > 0 ||
+			(frame->in_statement && pager->concurrent && !is_writer(pager))) {
+			continue;
+		}
+		if (frame->referenced) {
+			frame->referenced = false;
+			continue;
+		}
+
+		/* an uncommitted page can't reach the DB file, so it goes into
+		the WAL; otherwise the WAL records for a page go to disk
+		before the page does */
+		if (frame->in_statement) {
+			log_evicted_page(pager, frame_index);
+		} else if (frame->dirty) {
+			if (pager->wal != NULL) {
+				sync_wal(pager->wal);
+			}
+			write_back_frames(pager, frame_index);
+		}
+		remove_frame_from_bucket(pager, frame_index);
+		return frame_index;
 	}
+	return INVALID_FRAME;
+}
 
-	/* check if the page has been allocated/cached yet;
-	it handles cache miss */
-	if (pager->pages[page_num] == NULL) {
-		/* allocate memory for the page */
-		void* page = malloc(PAGE_SIZE);
-		uint32_t num_pages = pager->file_length / PAGE_SIZE;
+/*
+	takes a frame for the given page -- a fresh one while the pool is
+	filling up, otherwise by evicting one -- and adds it to the page
+	table; the frame's contents are left for the caller to fill in
 
-		/* if possible, read the page into memory */
-		if (page_num <= num_pages) {
-			lseek(pager->file_descriptor, page_num * PAGE_SIZE, SEEK_SET);
-			ssize_t bytes_read = read(pager->file_descriptor, page, PAGE_SIZE);
-			if (bytes_read == -1) {
-				printf("Couldn't read file %d\n", errno);
-				exit(EXIT_FAILURE);
-			}
+	pager: pointer to a populated Pager struct
+	page_num: number of the page that's going in the frame
+	returns: index of the frame, or INVALID_FRAME if nothing could be
+		evicted
+*/
+uint32_t claim_frame(Pager* pager, uint32_t page_num) {
+	uint32_t frame_index;
+	if (pager->frames_in_use < pager->num_frames) {
+		frame_index = pager->frames_in_use++;
+		pager->frames[frame_index].data = malloc(pager->page_size);
+	} else {
+		frame_index = evict_frame(pager);
+		if (frame_index == INVALID_FRAME) {
+			return INVALID_FRAME;
 		}
+	}
 
-		/* adds the page to the pager cache */
-		pager->pages[page_num] = page;
+	Frame* frame = &pager->frames[frame_index];
+	frame->page_num = page_num;
+	frame->pin_count = 0;
+	frame->dirty = false;
+	frame->in_statement = false;
+	frame->loading = false;
+
+	/* adds the page to the page table */
+	uint32_t bucket = page_num % pager->num_buckets;
+	frame->next_in_bucket = pager->buckets[bucket];
+	pager->buckets[bucket] = frame_index;
+	return frame_index;
+}
+
+/*
+	finds the frame holding the given page, reading the page into
+	the buffer pool if it isn't there yet -- must be called with the
+	pool mutex held, but the mutex is let go while the page is read,
+	so other threads can use the pool in the meantime
+	
+	pager: pointer to a populated Pager struct
+	page_num: number of the desired page
+	returns: index of the frame holding the page
+*/
+uint32_t fetch_frame(Pager* pager, uint32_t page_num) {
+	uint32_t frame_index = find_frame(pager, page_num);
+
+	/* check if the page has been cached yet; it handles cache miss */
+	if (frame_index == INVALID_FRAME) {
+		pager->stats.cache_misses++;
+
+		frame_index = claim_frame(pager, page_num);
+		if (frame_index == INVALID_FRAME) {
+			printf("All %d cached pages are pinned or uncommitted; the cache needs more frames\n",
+				pager->num_frames);
+			exit(EXIT_FAILURE);
+		}
+		Frame* frame = &pager->frames[frame_index];
 
 		/* we no longer have partial pages since each node gets 
 		one page, so we always increment when a new page is added */
+		uint32_t num_pages_on_disk = pager->file_length / pager->page_size;
 		if (page_num >= pager->num_pages) {
 			pager->num_pages = page_num + 1;
 		}
+
+		/* if possible, read the page into memory; pages past the end
+		of the file start out zeroed, and a page the WAL has a newer
+		image of comes from there (under the mutex, since a
+		checkpoint could empty the WAL under a read) */
+		off_t logged_offset = (pager->wal != NULL) ? find_logged_page(pager->wal, page_num) : 0;
+		if (logged_offset != 0) {
+			read_logged_page(pager, logged_offset, frame->data);
+		} else if (page_num < num_pages_on_disk) {
+			start_loading_frame(pager, frame_index);
+			unlock_pool(pager);
+			struct iovec iov = { frame->data, pager->page_size };
+			IoRequest request;
+			set_io_request(&request, false, (off_t) page_num * pager->page_size, &iov, 1);
+			run_io(pager->io, &request, 1);
+			if (request.result != (ssize_t) pager->page_size) {
+				printf("Couldn't read file %d\n", request.result < 0 ? (int) -request.result : 0);
+				exit(EXIT_FAILURE);
+			}
+			lock_pool(pager);
+			finish_loading_frame(pager, frame_index);
+			pager->stats.pages_read++;
+			pager->stats.bytes_read += pager->page_size;
+		} else {
+			memset(frame->data, 0, pager->page_size);
+		}
+	} else {
+		pager->stats.cache_hits++;
+		if (pager->frames[frame_index].loading) {
+			wait_for_frame_load(pager, frame_index);
+		}
 	}
 
-	return pager->pages[page_num];
+	pager->frames[frame_index].referenced = true;
+
+	return frame_index;
 }
 
 /*
-	writes the specified page to disk
+	in mmap mode, finds the given page inside the file mapping, mapping
+	its chunk on first use -- the mapping is private, so the kernel
+	makes a copy of any page we write to and the file is only changed
+	by an explicit flush
+
+	pager: pointer to a populated Pager struct
+	page_num: number of the desired page
+	returns: pointer into the mapping, or NULL if the page has to come
+		from the buffer pool (mmap is off, the page is past the end of
+		the file, it's already cached in a frame, or the WAL has a
+		newer image of it)
+*/
+void* get_mapped_page(Pager* pager, uint32_t page_num) {
+	if (!pager->use_mmap || page_num >= pager->file_length / pager->page_size ||
+		find_frame(pager, page_num) != INVALID_FRAME ||
+		(pager->wal != NULL && find_logged_page(pager->wal, page_num) != 0)) {
+		return NULL;
+	}
+
+	/* grow the chunk table if the file has grown past it */
+	uint32_t chunk_num = page_num / MMAP_CHUNK_PAGES;
+	if (chunk_num >= pager->num_chunks) {
+		uint32_t num_chunks = chunk_num + 1;
+		pager->chunks = realloc(pager->chunks, num_chunks * sizeof(MappedChunk));
+		memset(pager->chunks + pager->num_chunks, 0, 
+			(num_chunks - pager->num_chunks) * sizeof(MappedChunk));
+		pager->num_chunks = num_chunks;
+	}
+
+	/* map the whole chunk even if the file ends partway through it;
+	we never touch pages past the end of the file, and once the file 
+	grows those pages become valid without remapping */
+	MappedChunk* chunk = &pager->chunks[chunk_num];
+	if (chunk->data == NULL) {
+		void* data = mmap(NULL, MMAP_CHUNK_PAGES * pager->page_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE, pager->file_descriptor, (off_t) chunk_num * MMAP_CHUNK_PAGES * pager->page_size);
+		if (data == MAP_FAILED) {
+			printf("Couldn't map the DB file %d\n", errno);
+			exit(EXIT_FAILURE);
+		}
+		chunk->data = data;
+	}
+
+	return (char*) chunk->data + (page_num % MMAP_CHUNK_PAGES) * pager->page_size;
+}
+
+/*
+	gets the specified page number from the Pager struct -- the 
+	pointer is only good until the next get_page() call, which may
+	evict it; use pin_page() to hold on to a page for longer
+
+	in concurrent mode, other threads may evict it at any time, so
+	readers have to latch the page first (see latch_page()); the
+	writer's pages stay put until the end of its step
 	
 	pager: pointer to a populated Pager struct
 	page_num: number of the desired page
-	size: page size
+	returns: pointer to the desired page
 */
-void flush_pager(Pager* pager, uint32_t page_num) {
-	/* check if the page is populated */
-	if (pager->pages[page_num] == NULL) {
-		printf("Tried to flush a null page\n");
-		exit(EXIT_FAILURE);
+void* get_page(Pager* pager, uint32_t page_num) {
+	void* mapped_page = get_mapped_page(pager, page_num);
+	if (mapped_page != NULL) {
+		pager->stats.cache_hits++;
+		return mapped_page;
 	}
 
-	/* check if the page_num is a valid location */
-	off_t offset = lseek(pager->file_descriptor, page_num * PAGE_SIZE, SEEK_SET);
-	if (offset == -1) {
-		printf("Error seeking: %d\n", errno);
+	lock_pool(pager);
+	uint32_t frame_index = fetch_frame(pager, page_num);
+	if (is_writer(pager)) {
+		hold_frame_for_writer(pager, frame_index);
+	}
+	void* page = pager->frames[frame_index].data;
+	unlock_pool(pager);
+	return page;
+}
+
+/*
+	gets the specified page and keeps it in the cache until it is
+	unpinned; pins nest, so every pin_page() needs an unpin_page()
+	
+	pager: pointer to a populated Pager struct
+	page_num: number of the desired page
+	returns: pointer to the desired page
+*/
+void* pin_page(Pager* pager, uint32_t page_num) {
+	/* mapped pages are never evicted, so they don't need pins */
+	void* mapped_page = get_mapped_page(pager, page_num);
+	if (mapped_page != NULL) {
+		pager->stats.cache_hits++;
+		return mapped_page;
+	}
+
+	lock_pool(pager);
+	uint32_t frame_index = fetch_frame(pager, page_num);
+	if (is_writer(pager)) {
+		hold_frame_for_writer(pager, frame_index);
+	}
+	Frame* frame = &pager->frames[frame_index];
+	frame->pin_count += 1;
+	void* page = frame->data;
+	unlock_pool(pager);
+	return page;
+}
+
+/* releases one pin on the given page so it can be evicted again */
+void unpin_page(Pager* pager, uint32_t page_num) {
+	if (get_mapped_page(pager, page_num) != NULL) {
+		return;
+	}
+
+	lock_pool(pager);
+	uint32_t frame_index = find_frame(pager, page_num);
+	if (frame_index == INVALID_FRAME || pager->frames[frame_index].pin_count == 0) {
+		printf("Tried to unpin page #%d, which isn't pinned\n", page_num);
 		exit(EXIT_FAILURE);
 	}
+	pager->frames[frame_index].pin_count -= 1;
+	unlock_pool(pager);
+}
+
+/*
+	reads the given pages into the buffer pool ahead of anyone asking
+	for them, so a get_page() on them later is a cache hit -- pages
+	that sit next to each other in the file are read with one request,
+	and all of the requests go to the I/O backend as a single batch
+
+	in mmap mode the pages come from the mapping rather than the pool,
+	so the OS is only asked to start reading them into its page cache
+
+	pager: pointer to a populated Pager struct
+	page_nums: the pages to read, in any order (they get sorted)
+	num_pages: number of pages
+*/
+void read_ahead_pages(Pager* pager, uint32_t* page_nums, uint32_t num_pages) {
+	qsort(page_nums, num_pages, sizeof(uint32_t), compare_page_nums);
+	lock_pool(pager);
+
+	struct iovec* iov = malloc(num_pages * sizeof(struct iovec));
+	IoRequest* requests = malloc(num_pages * sizeof(IoRequest));
+	uint32_t* frame_indexes = malloc(num_pages * sizeof(uint32_t));
+	uint32_t num_requests = 0;
+	uint32_t num_read = 0;
+	uint32_t num_pages_on_disk = pager->file_length / pager->page_size;
+	for (uint32_t i = 0; i < num_pages; i++) {
+		uint32_t page_num = page_nums[i];
+		/* pages that haven't been written yet have nothing to read,
+		and pages in the WAL are left for fetch_frame() */
+		if (page_num >= num_pages_on_disk || find_frame(pager, page_num) != INVALID_FRAME ||
+			(pager->wal != NULL && find_logged_page(pager->wal, page_num) != 0)) {
+			continue;
+		}
+
+		if (pager->use_mmap) {
+			posix_fadvise(pager->file_descriptor, (off_t) page_num * pager->page_size,
+				pager->page_size, POSIX_FADV_WILLNEED);
+			pager->stats.pages_read_ahead++;
+			continue;
+		}
+
+		/* read-ahead is only a guess, so rather than fail it just
+		stops when nothing can be evicted; the frames stay pinned
+		until they've been read, so they can't evict each other */
+		uint32_t frame_index = claim_frame(pager, page_num);
+		if (frame_index == INVALID_FRAME) {
+			break;
+		}
+		start_loading_frame(pager, frame_index);
+		pager->frames[frame_index].referenced = true;
+		frame_indexes[num_read] = frame_index;
+		iov[num_read].iov_base = pager->frames[frame_index].data;
+		iov[num_read].iov_len = pager->page_size;
+
+		/* extend the last request if this page follows its last one */
+		IoRequest* last = (num_requests > 0) ? &requests[num_requests - 1] : NULL;
+		if (last != NULL && last->iov_count < FLUSH_MAX_RUN_PAGES &&
+			last->offset + (off_t) last->length == (off_t) page_num * pager->page_size) {
+			last->iov_count++;
+			last->length += pager->page_size;
+		} else {
+			set_io_request(&requests[num_requests++], false,
+				(off_t) page_num * pager->page_size, iov + num_read, 1);
+		}
+		num_read++;
+	}
+
+	/* the claimed frames are marked as loading, so the reads can
+	happen without the pool mutex */
+	unlock_pool(pager);
+	run_io(pager->io, requests, num_requests);
+	for (uint32_t i = 0; i < num_requests; i++) {
+		if (requests[i].result != (ssize_t) requests[i].length) {
+			printf("Couldn't read file %d\n", requests[i].result < 0 ? (int) -requests[i].result : 0);
+			exit(EXIT_FAILURE);
+		}
+	}
+	lock_pool(pager);
+
+	for (uint32_t i = 0; i < num_read; i++) {
+		finish_loading_frame(pager, frame_indexes[i]);
+	}
+	pager->stats.pages_read += num_read;
+	pager->stats.bytes_read += (uint64_t) num_read * pager->page_size;
+	pager->stats.pages_read_ahead += num_read;
+	unlock_pool(pager);
+
+	free(frame_indexes);
+	free(requests);
+	free(iov);
+}
+
+/*
+	records that the given cached page has been modified, so it gets
+	written back on eviction or close -- anything that writes through
+	a page pointer must call this while the page is still cached
 
-	/* try to write to the specified page */
-	ssize_t bytes_written = write(pager->file_descriptor, pager->pages[page_num], PAGE_SIZE);
-	if (bytes_written == -1) {
-		printf("Error writing: %d\n", errno);
+	pager: pointer to a populated Pager struct
+	page_num: number of the modified page
+*/
+void mark_page_dirty(Pager* pager, uint32_t page_num) {
+	/* mapped pages are tracked with a bit per page in their chunk */
+	if (get_mapped_page(pager, page_num) != NULL) {
+		MappedChunk* chunk = &pager->chunks[page_num / MMAP_CHUNK_PAGES];
+		uint32_t bit = page_num % MMAP_CHUNK_PAGES;
+		if (!(chunk->dirty[bit / 8] & (1 << (bit % 8)))) {
+			chunk->dirty[bit / 8] |= (1 << (bit % 8));
+			pager->num_dirty_mapped_pages++;
+		}
+		if (pager->wal != NULL) {
+			add_statement_page(pager, page_num);
+		}
+		return;
+	}
+
+	lock_pool(pager);
+	uint32_t frame_index = find_frame(pager, page_num);
+	if (frame_index == INVALID_FRAME) {
+		printf("Tried to dirty page #%d, which isn't cached\n", page_num);
 		exit(EXIT_FAILURE);
 	}
+	pager->frames[frame_index].dirty = true;
+	if (pager->wal != NULL) {
+		pager->frames[frame_index].in_statement = true;
+		add_statement_page(pager, page_num);
+	}
+
+	/* in concurrent mode, readers have to be kept off the page until
+	the writer's step is done with it */
+	bool writer = is_writer(pager);
+	if (writer) {
+		hold_frame_for_writer(pager, frame_index);
+	}
+	unlock_pool(pager);
+	if (writer) {
+		latch_frame_for_write(pager, frame_index);
+	}
+}
+
+/* qsort() comparator that orders dirty pages by page number */
+int compare_dirty_pages(const void* a, const void* b) {
+	uint32_t page_a = ((DirtyPage*)a)->page_num;
+	uint32_t page_b = ((DirtyPage*)b)->page_num;
+	return (page_a > page_b) - (page_a < page_b);
+}
+
+/*
+	writes the given dirty pages to disk -- the pages are sorted by
+	page number and each run of consecutive pages becomes one request,
+	and all of the requests go to the I/O backend as a single batch
+
+	pager: pointer to a populated Pager struct
+	dirty_pages: the pages to write, in any order
+	num_dirty: number of pages
+*/
+void write_dirty_pages(Pager* pager, DirtyPage* dirty_pages, uint32_t num_dirty) {
+	qsort(dirty_pages, num_dirty, sizeof(DirtyPage), compare_dirty_pages);
+
+	/* one buffer per page, and at most one request per page */
+	struct iovec* iov = malloc(num_dirty * sizeof(struct iovec));
+	IoRequest* requests = malloc(num_dirty * sizeof(IoRequest));
+	uint32_t num_requests = 0;
+	uint32_t run_start = 0;
+	while (run_start < num_dirty) {
+		/* extend the run while the next page follows the last one */
+		uint32_t run_length = 1;
+		while (run_start + run_length < num_dirty && run_length < FLUSH_MAX_RUN_PAGES &&
+			dirty_pages[run_start + run_length].page_num == 
+			dirty_pages[run_start].page_num + run_length) {
+			run_length++;
+		}
+
+		for (uint32_t i = run_start; i < run_start + run_length; i++) {
+			iov[i].iov_base = dirty_pages[i].data;
+			iov[i].iov_len = pager->page_size;
+		}
+		set_io_request(&requests[num_requests++], true,
+			(off_t) dirty_pages[run_start].page_num * pager->page_size, iov + run_start, run_length);
+		run_start += run_length;
+	}
+
+	run_io(pager->io, requests, num_requests);
+
+	for (uint32_t i = 0; i < num_requests; i++) {
+		IoRequest* request = &requests[i];
+		if (request->result != (ssize_t) request->length) {
+			printf("Error writing: %d\n", request->result < 0 ? (int) -request->result : 0);
+			exit(EXIT_FAILURE);
+		}
+		pager->stats.pages_written += request->iov_count;
+		pager->stats.bytes_written += request->result;
+
+		/* writing past the end of the file grows it */
+		if (request->offset + request->result > pager->file_length) {
+			pager->file_length = request->offset + request->result;
+		}
+	}
+
+	/* a written mapped page no longer needs its private copy; 
+	dropping it lets the mapping share the kernel's page cache 
+	again, which now holds the same bytes -- and a page the WAL had
+	a newer image of than the DB file doesn't any more */
+	for (uint32_t i = 0; i < num_dirty; i++) {
+		DirtyPage* page = &dirty_pages[i];
+		if (pager->wal != NULL) {
+			forget_logged_page(pager->wal, page->page_num);
+		}
+		if (page->frame != NULL) {
+			page->frame->dirty = false;
+		} else {
+			madvise(page->data, pager->page_size, MADV_DONTNEED);
+		}
+	}
+
+	free(requests);
+	free(iov);
+}
+
+/* writes every dirty page to disk; clean pages aren't written at all */
+void flush_dirty_pages(Pager* pager) {
+	lock_pool(pager);
+	/* collect the dirty pages from the buffer pool... */
+	uint32_t max_dirty = pager->frames_in_use + pager->num_chunks * MMAP_CHUNK_PAGES;
+	DirtyPage* dirty_pages = malloc(max_dirty * sizeof(DirtyPage));
+	uint32_t num_dirty = 0;
+	for (uint32_t i = 0; i < pager->frames_in_use; i++) {
+		if (pager->frames[i].dirty) {
+			dirty_pages[num_dirty].page_num = pager->frames[i].page_num;
+			dirty_pages[num_dirty].data = pager->frames[i].data;
+			dirty_pages[num_dirty].frame = &pager->frames[i];
+			num_dirty++;
+		}
+	}
+
+	/* ...and from the file mapping */
+	for (uint32_t chunk_num = 0; chunk_num < pager->num_chunks; chunk_num++) {
+		MappedChunk* chunk = &pager->chunks[chunk_num];
+		for (uint32_t bit = 0; chunk->data != NULL && bit < MMAP_CHUNK_PAGES; bit++) {
+			if (chunk->dirty[bit / 8] & (1 << (bit % 8))) {
+				dirty_pages[num_dirty].page_num = chunk_num * MMAP_CHUNK_PAGES + bit;
+				dirty_pages[num_dirty].data = (char*) chunk->data + bit * pager->page_size;
+				dirty_pages[num_dirty].frame = NULL;
+				num_dirty++;
+			}
+		}
+		memset(chunk->dirty, 0, sizeof(chunk->dirty));
+	}
+	pager->num_dirty_mapped_pages = 0;
+
+	write_dirty_pages(pager, dirty_pages, num_dirty);
+	unlock_pool(pager);
+	free(dirty_pages);
+}
+
+/*
+	in mmap mode without the WAL, nothing but a flush writes mapped
+	pages back, so this writes them back once there are more of them
+	than the buffer pool has frames -- that keeps the private copies
+	to about the pool's size; must only run between statements
+
+	pager: pointer to a populated Pager struct
+*/
+void trim_mapped_pages(Pager* pager) {
+	if (pager->num_dirty_mapped_pages > pager->num_frames) {
+		flush_dirty_pages(pager);
+	}
+}
+
+/*
+	writes back the dirty page in the given frame, which is about to
+	be evicted, along with the next few dirty pages the CLOCK hand is
+	coming up on -- they all go out in one batch, and those frames
+	are clean by the time the hand gets to them
+
+	pager: pointer to a populated Pager struct
+	frame_index: index of the frame being evicted
+*/
+void write_back_frames(Pager* pager, uint32_t frame_index) {
+	DirtyPage dirty_pages[WRITE_BACK_BATCH_PAGES];
+	uint32_t num_dirty = 0;
+	for (uint32_t i = 0; i < pager->num_frames && num_dirty < WRITE_BACK_BATCH_PAGES; i++) {
+		Frame* frame = &pager->frames[(frame_index + i) % pager->num_frames];
+		/* uncommitted pages can't reach the DB file yet, and a pinned
+		page may still be in the middle of being changed */
+		if (!frame->dirty || frame->in_statement || frame->pin_count > 0) {
+			continue;
+		}
+		dirty_pages[num_dirty].page_num = frame->page_num;
+		dirty_pages[num_dirty].data = frame->data;
+		dirty_pages[num_dirty].frame = frame;
+		num_dirty++;
+	}
+	write_dirty_pages(pager, dirty_pages, num_dirty);
 }
 
 /* 
-	initializes and returns a Table struct 
+	initializes and returns a Database struct, with a Table struct for
+	every table in the catalog
 
 	filename: pointer to a string containing the DB filename
-	returns: pointer to a Table struct for the DB file
+	options: pointer to the options the DB is being opened with
+	returns: pointer to a Database struct for the DB file
 */
-Table* open_database(const char* filename) {
+Database* open_database(const char* filename, DatabaseOptions* options) {
 	/* initialize table pager, which keeps track of the pages;
 	it uses malloc(), so it will have to be freed later */
-	Pager* pager = open_pager(filename);
-	Table* table = malloc(sizeof(Table));
-	table->pager = pager;
-	table->root_page_num = 0;
-
-	/* if the DB file does not yet exist, create one */
-	if (pager->num_pages == 0) {
-		void* root_node = get_page(pager, 0);
-		initialize_leaf_node(root_node);
+	Pager* pager = open_pager(filename, options);
+	Database* database = malloc(sizeof(Database));
+	database->pager = pager;
+
+	/* if the DB file was just created, it only has the header page
+	open_pager() wrote, so the first table needs an empty root and
+	an entry in the catalog */
+	if (pager->num_pages == 1) {
+		void* root_node = get_page(pager, ROOT_PAGE_NUM);
+		mark_page_dirty(pager, ROOT_PAGE_NUM);
+		initialize_leaf_node(pager, root_node);
 		/* the first node in the table will be the root node */
 		set_node_root(root_node, true); 
+
+		void* header = get_page(pager, DB_HEADER_PAGE_NUM);
+		void* entry = get_catalog_entry(header, 0);
+		mark_page_dirty(pager, DB_HEADER_PAGE_NUM);
+		*get_catalog_root_page(entry) = ROOT_PAGE_NUM;
+		strcpy(get_catalog_name(entry), DEFAULT_TABLE_NAME);
 	}
+	commit_statement(pager);
+	open_catalog(database);
 
-	return table;
+	return database;
 }
 
 /*
 	saves the cache to disk and frees the cache memory structures
 	
-	pager: pointer to the DB table
+	database: pointer to the DB
 */
-void close_database(Table* table) {
-	Pager* pager = table->pager;
-
-	/* run through each cached page; if it's not empty, save it 
-	to disk and free the page */
-	for (uint32_t i = 0; i < pager->num_pages; i++) {
-		if (pager->pages[i] == NULL) {
-			continue;
-		}
-	    flush_pager(pager, i);
-	    free(pager->pages[i]);
-	    pager->pages[i] = NULL;
+void close_database(Database* database) {
+	Pager* pager = database->pager;
+	stop_stats_dump(pager);
+
+	/* save every modified page to disk (through a final checkpoint
+	when the WAL is on), then free the frames */
+	if (pager->wal != NULL) {
+		close_wal(pager);
+	} else {
+		flush_dirty_pages(pager);
+	}
+	for (uint32_t i = 0; i < pager->frames_in_use; i++) {
+		free(pager->frames[i].data);
 	}
+	close_latches(pager);
+	close_io_backend(pager->io);
 
 	int result = close(pager->file_descriptor);
 	if (result == -1) {
@@ -176,21 +928,79 @@ void close_database(Table* table) {
 		exit(EXIT_FAILURE);
 	}
 
-	/* free every page in the Pager struct */
-	for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++) {
-		void* page = pager->pages[i];
-		if (page) {
-			free(page);
-			pager->pages[i] = NULL;
+	/* unmap the file and free the buffer pool and the Pager struct */
+	for (uint32_t i = 0; i < pager->num_chunks; i++) {
+		if (pager->chunks[i].data != NULL) {
+			munmap(pager->chunks[i].data, MMAP_CHUNK_PAGES * pager->page_size);
 		}
 	}
-
+	free(pager->chunks);
+	free(pager->statement_pages);
+	free(pager->frames);
+	free(pager->buckets);
 	free(pager);
+	close_catalog(database);
+	free(database);
+}
+
+/* returns a pointer to the head of the free page list in the
+header page -- this is both a getter and a setter */
+uint32_t* get_free_list_head(void* header) {
+	return header + FREE_LIST_HEAD_OFFSET;
+}
+
+/* returns a pointer to the number of free pages in the header
+page -- this is both a getter and a setter */
+uint32_t* get_num_free_pages(void* header) {
+	return header + NUM_FREE_PAGES_OFFSET;
 }
 
-/* returns the number of the first unused page in the pager */
+/* returns a pointer to the number of the free page after the given
+free page -- this is both a getter and a setter */
+uint32_t* get_free_page_next(void* page) {
+	return page + FREE_PAGE_NEXT_OFFSET;
+}
+
+/* 
+	hands out a page for a new node -- pages freed by deletes are
+	reused first, and the file only grows once there are none left
+
+	pager: pointer to a populated Pager struct
+	returns: number of the page to use
+*/
 uint32_t get_unused_page_num(Pager* pager) { 
-	return pager->num_pages; 
+	void* header = get_page(pager, DB_HEADER_PAGE_NUM);
+	uint32_t page_num = *get_free_list_head(header);
+	if (page_num == 0) {
+		return pager->num_pages;
+	}
+
+	/* pop the page off the front of the list */
+	pin_page(pager, DB_HEADER_PAGE_NUM);
+	void* page = get_page(pager, page_num);
+	uint32_t next_page_num = *get_free_page_next(page);
+	mark_page_dirty(pager, DB_HEADER_PAGE_NUM);
+	*get_free_list_head(header) = next_page_num;
+	*get_num_free_pages(header) -= 1;
+	unpin_page(pager, DB_HEADER_PAGE_NUM);
+	return page_num;
+}
+
+/* 
+	puts a page that's no longer part of the tree on the free list
+
+	pager: pointer to a populated Pager struct
+	page_num: number of the page to free
+*/
+void free_page(Pager* pager, uint32_t page_num) {
+	void* header = pin_page(pager, DB_HEADER_PAGE_NUM);
+	void* page = get_page(pager, page_num);
+	mark_page_dirty(pager, page_num);
+	mark_page_dirty(pager, DB_HEADER_PAGE_NUM);
+	*get_free_page_next(page) = *get_free_list_head(header);
+	*get_free_list_head(header) = page_num;
+	*get_num_free_pages(header) += 1;
+	unpin_page(pager, DB_HEADER_PAGE_NUM);
 }
 
 
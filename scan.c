@@ -0,0 +1,236 @@
+/*
+
+This program implements parallel scans for a minimalistic SQLite DB
+based on a tutorial at https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+
+/*
+	with --scan-threads, a select's key range is cut into partitions
+	along the tree and the threads take them one at a time, each with
+	an ordinary latching cursor (so it needs --concurrent); their rows
+	go out in key order, or as they finish for "select unordered"
+*/
+
+
+/*
+	cuts the keys from first_key to last_key into ranges that follow
+	the tree, going down a level at a time until there are at least
+	target of them or the leaves are reached
+
+	table: pointer to the Table struct to scan
+	first_key: smallest key to scan
+	last_key: biggest key to scan
+	target: how many partitions to aim for
+	partitions: set to the partitions, in key order; the caller frees it
+	returns: number of partitions
+*/
+uint32_t plan_scan_partitions(Table* table, uint32_t first_key, uint32_t last_key, uint32_t target, ScanPartition** partitions) {
+	Pager* pager = table->pager;
+	uint32_t capacity = 1;
+	uint32_t num_partitions = 0;
+	ScanPartition* level = malloc(capacity * sizeof(ScanPartition));
+	if (first_key <= last_key) {
+		level[0].page_num = table->root_page_num;
+		level[0].first_key = first_key;
+		level[0].last_key = last_key;
+		num_partitions = 1;
+	}
+
+	bool found_internal = true;
+	while (num_partitions < target && found_internal) {
+		/* every node on the level is latched on its own, so this only
+		ever holds one latch at a time */
+		found_internal = false;
+		uint32_t next_capacity = 0;
+		uint32_t next_num = 0;
+		ScanPartition* next_level = NULL;
+		for (uint32_t i = 0; i < num_partitions; i++) {
+			ScanPartition* partition = &level[i];
+			void* node = latch_page(pager, partition->page_num);
+			uint32_t num_children = 1;
+			if (get_node_type(node) == NODE_INTERNAL) {
+				num_children = *get_internal_node_num_keys(node) + 1;
+				found_internal = true;
+			}
+			if (next_num + num_children > next_capacity) {
+				next_capacity = 2 * (next_num + num_children);
+				next_level = realloc(next_level, next_capacity * sizeof(ScanPartition));
+			}
+			if (num_children == 1) {
+				next_level[next_num++] = *partition;
+				unlatch_page(pager, partition->page_num);
+				continue;
+			}
+
+			/* each child takes the keys after the one to its left, up
+			to its own, clipped to the partition's range */
+			uint32_t child_first_key = partition->first_key;
+			for (uint32_t child = 0; child < num_children; child++) {
+				uint32_t child_last_key = partition->last_key;
+				if (child < num_children - 1 && *get_internal_node_key(node, child) < child_last_key) {
+					child_last_key = *get_internal_node_key(node, child);
+				}
+				if (child_first_key <= child_last_key) {
+					next_level[next_num].page_num = *get_internal_node_child(node, child);
+					next_level[next_num].first_key = child_first_key;
+					next_level[next_num].last_key = child_last_key;
+					next_num++;
+				}
+				if (child_last_key == partition->last_key) {
+					break;
+				}
+				if (child_last_key >= child_first_key) {
+					child_first_key = child_last_key + 1;
+				}
+			}
+			unlatch_page(pager, partition->page_num);
+		}
+		free(level);
+		level = next_level;
+		num_partitions = next_num;
+	}
+
+	*partitions = level;
+	return num_partitions;
+}
+
+/*
+	one of the scan threads: takes partitions one at a time until
+	there are none left
+
+	arg: pointer to the ParallelScan struct
+*/
+void* run_scan_thread(void* arg) {
+	ParallelScan* scan = arg;
+	while (true) {
+		uint32_t partition = __atomic_fetch_add(&scan->next_partition, 1, __ATOMIC_RELAXED);
+		if (partition >= scan->num_partitions) {
+			return NULL;
+		}
+		scan->visit(scan, partition);
+	}
+}
+
+/*
+	plans a parallel scan of the keys from first_key to last_key --
+	the caller can set up whatever it keeps per partition before
+	handing the scan to run_parallel_scan()
+
+	table: pointer to the Table struct to scan
+	first_key: smallest key to scan
+	last_key: biggest key to scan
+	returns: pointer to a ParallelScan struct with its partitions planned
+*/
+ParallelScan* plan_parallel_scan(Table* table, uint32_t first_key, uint32_t last_key) {
+	ParallelScan* scan = malloc(sizeof(ParallelScan));
+	scan->table = table;
+	scan->num_partitions = plan_scan_partitions(table, first_key, last_key,
+		table->pager->scan_threads * SCAN_PARTITIONS_PER_THREAD, &scan->partitions);
+	scan->next_partition = 0;
+	return scan;
+}
+
+/*
+	runs a planned scan on scan_threads threads, calling the visitor
+	once for every partition from whichever thread takes it, then
+	frees the scan once every partition has been visited
+
+	scan: pointer to a ParallelScan struct from plan_parallel_scan()
+	visit: function that scans one partition
+	arg: whatever the visitor needs, handed over in the ParallelScan
+*/
+void run_parallel_scan(ParallelScan* scan, void (*visit)(ParallelScan* scan, uint32_t partition), void* arg) {
+	uint32_t num_threads = scan->table->pager->scan_threads;
+	scan->visit = visit;
+	scan->arg = arg;
+
+	/* the thread that asked scans too, rather than sit and wait */
+	pthread_t* threads = malloc(num_threads * sizeof(pthread_t));
+	for (uint32_t i = 1; i < num_threads; i++) {
+		pthread_create(&threads[i], NULL, run_scan_thread, scan);
+	}
+	run_scan_thread(scan);
+	for (uint32_t i = 1; i < num_threads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+	free(scan->partitions);
+	free(scan);
+}
+
+/*
+	visitor for a parallel select: writes the partition's rows into a
+	buffer of its own, then hands the buffer to the output
+
+	scan: pointer to the ParallelScan struct, with a SelectOutput
+	partition: index of the partition to scan
+*/
+void select_partition(ParallelScan* scan, uint32_t partition) {
+	SelectOutput* output = scan->arg;
+	ScanPartition* range = &scan->partitions[partition];
+	OutputBuffer* standard_output = get_standard_output();
+	OutputBuffer rows;
+	init_output_buffer(&rows, -1, standard_output->format);
+
+	Schema* schema = &scan->table->schema;
+	Cursor* cursor = find_range_in_table(scan->table, range->first_key, range->last_key);
+	while (!(cursor->end_of_table)) {
+		write_row(&rows, schema, output->projection, get_cursor_value(cursor));
+		advance_cursor(cursor);
+	}
+	close_cursor(cursor);
+
+	/* in key order, a buffer waits for the ones before it, and the
+	thread that finishes the one everybody's waiting on writes out
+	every buffer that's ready after it */
+	pthread_mutex_lock(&output->lock);
+	if (output->unordered) {
+		write_output(standard_output, rows.data, rows.length);
+		free_output_buffer(&rows);
+	} else {
+		output->buffers[partition] = rows.data;
+		output->lengths[partition] = rows.length;
+		output->finished[partition] = true;
+		while (output->next_to_write < scan->num_partitions && output->finished[output->next_to_write]) {
+			uint32_t next = output->next_to_write++;
+			write_output(standard_output, output->buffers[next], output->lengths[next]);
+			free(output->buffers[next]);
+			output->buffers[next] = NULL;
+		}
+	}
+	pthread_mutex_unlock(&output->lock);
+}
+
+/*
+	prints every row from first_key to last_key using the scan threads
+
+	table: pointer to the Table struct to scan
+	first_key: smallest id to print
+	last_key: biggest id to print
+	unordered: true if the rows can come out in any order
+	projection: pointer to the Projection struct with the columns to print
+*/
+void parallel_select(Table* table, uint32_t first_key, uint32_t last_key, bool unordered, Projection* projection) {
+	ParallelScan* scan = plan_parallel_scan(table, first_key, last_key);
+	SelectOutput output;
+	output.unordered = unordered;
+	output.projection = projection;
+	output.buffers = calloc(scan->num_partitions, sizeof(char*));
+	output.lengths = calloc(scan->num_partitions, sizeof(size_t));
+	output.finished = calloc(scan->num_partitions, sizeof(bool));
+	output.next_to_write = 0;
+	pthread_mutex_init(&output.lock, NULL);
+
+	run_parallel_scan(scan, select_partition, &output);
+
+	pthread_mutex_destroy(&output.lock);
+	free(output.buffers);
+	free(output.lengths);
+	free(output.finished);
+}
@@ -0,0 +1,360 @@
+/*
+
+This program implements table schemas and the row codec that follows
+from them for a minimalistic SQLite DB based on a tutorial at
+https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+
+/*
+	a row keeps its ints and chars first, in declared order, then its
+	varchars, each behind a length byte; compile_schema() works out once
+	where every fixed column starts, so encoding, decoding and printing
+	a row are one walk along it -- the default columns lay rows out the
+	way the first table always has
+*/
+
+
+/*
+	gives a schema the first table's columns
+
+	schema: pointer to the Schema struct to fill in
+*/
+void set_default_schema(Schema* schema) {
+	const char* names[] = { "id", "username", "email" };
+	ColumnType types[] = { COLUMN_INT, COLUMN_VARCHAR, COLUMN_VARCHAR };
+	uint32_t sizes[] = { INT_COLUMN_SIZE, COLUMN_USERNAME_SIZE, COLUMN_EMAIL_SIZE };
+	schema->num_columns = 3;
+	for (uint32_t i = 0; i < schema->num_columns; i++) {
+		strcpy(schema->columns[i].name, names[i]);
+		schema->columns[i].type = types[i];
+		schema->columns[i].size = sizes[i];
+	}
+	compile_schema(schema);
+}
+
+/*
+	works out the row layout for a schema's columns: where each int
+	and char starts, which varchar each varchar is, and how big a row
+	can get
+
+	schema: pointer to a Schema struct with its columns filled in
+	returns: false if a row could be too long to keep
+*/
+bool compile_schema(Schema* schema) {
+	uint32_t offset = 0;
+	uint32_t num_varchars = 0;
+	uint32_t varchars_size = 0;
+	for (uint32_t i = 0; i < schema->num_columns; i++) {
+		Column* column = &schema->columns[i];
+		switch (column->type) {
+			case (COLUMN_INT):
+				column->offset = offset;
+				offset += INT_COLUMN_SIZE;
+				break;
+			case (COLUMN_CHAR):
+				column->offset = offset;
+				offset += column->size;
+				break;
+			case (COLUMN_VARCHAR):
+				column->offset = num_varchars++;
+				varchars_size += STRING_LENGTH_SIZE + column->size;
+				break;
+		}
+	}
+	schema->fixed_size = offset;
+	schema->num_varchars = num_varchars;
+	schema->max_size = offset + varchars_size;
+	return schema->max_size <= MAX_ROW_SIZE;
+}
+
+/*
+	reads one column of a create table statement, like "name varchar(32)"
+
+	definition: pointer to a string containing the column's name and type
+	column: pointer to the Column struct to fill in
+	returns: an enum representing whether the column was parsed correctly
+*/
+ParsingResult parse_column(char* definition, Column* column) {
+	char name[COLUMN_NAME_MAX_LENGTH + 2];
+	char type[16];
+	int characters_read = -1;
+	sscanf(definition, " %16s %15s %n", name, type, &characters_read);
+	if (characters_read != (int) strlen(definition)) return SYNTAX_ERROR;
+	if (strlen(name) > COLUMN_NAME_MAX_LENGTH) return STRING_TOO_LONG;
+	strcpy(column->name, name);
+
+	if (strcmp(type, "int") == 0) {
+		column->type = COLUMN_INT;
+		column->size = INT_COLUMN_SIZE;
+		return RECOGNIZED;
+	}
+
+	/* a string's size comes in parentheses after its type */
+	uint32_t size;
+	characters_read = -1;
+	if (sscanf(type, "char(%u)%n", &size, &characters_read) == 1) {
+		column->type = COLUMN_CHAR;
+	} else if (sscanf(type, "varchar(%u)%n", &size, &characters_read) == 1) {
+		column->type = COLUMN_VARCHAR;
+	}
+	if (characters_read != (int) strlen(type) || size == 0) return SYNTAX_ERROR;
+	if (size > MAX_STRING_SIZE) return STRING_TOO_LONG;
+	column->size = size;
+	return RECOGNIZED;
+}
+
+/*
+	reads the column list of a create table statement, like
+	"(id int, name varchar(32), age int)"
+
+	definition: pointer to a string containing the column list, which
+		gets split up as it's read
+	schema: pointer to the Schema struct to fill in
+	returns: an enum representing whether the columns were parsed correctly
+*/
+ParsingResult parse_schema(char* definition, Schema* schema) {
+	size_t length = strlen(definition);
+	if (length < 2 || definition[0] != '(' || definition[length - 1] != ')') {
+		return SYNTAX_ERROR;
+	}
+	definition[length - 1] = '\0';
+
+	schema->num_columns = 0;
+	for (char* piece = strtok(definition + 1, ","); piece != NULL; piece = strtok(NULL, ",")) {
+		if (schema->num_columns == MAX_COLUMNS) {
+			return SYNTAX_ERROR;
+		}
+		Column* column = &schema->columns[schema->num_columns];
+		ParsingResult result = parse_column(piece, column);
+		if (result != RECOGNIZED) {
+			return result;
+		}
+		uint32_t existing;
+		if (find_column(schema, column->name, &existing)) {
+			return SYNTAX_ERROR;
+		}
+		schema->num_columns++;
+	}
+
+	/* the first column is the key */
+	if (schema->num_columns == 0 || strcmp(schema->columns[0].name, "id") != 0 ||
+		schema->columns[0].type != COLUMN_INT) {
+		return SYNTAX_ERROR;
+	}
+	if (!compile_schema(schema)) {
+		return STRING_TOO_LONG;
+	}
+	return RECOGNIZED;
+}
+
+/*
+	finds the column with the given name
+
+	schema: pointer to the Schema struct to look in
+	name: pointer to a string containing the column's name
+	column_num: set to the column's number, if there is one by that name
+	returns: false if the schema has no column by that name
+*/
+bool find_column(Schema* schema, const char* name, uint32_t* column_num) {
+	for (uint32_t i = 0; i < schema->num_columns; i++) {
+		if (strcmp(schema->columns[i].name, name) == 0) {
+			*column_num = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+	checks one value for each column and encodes them into a row
+
+	schema: pointer to the Schema struct of the row's table
+	values: pointer to one string per column (NULL if it's missing)
+	row: pointer to the Row struct to fill in
+	returns: an enum representing whether the row was parsed correctly
+*/
+ParsingResult encode_row(Schema* schema, char** values, Row* row) {
+	/* check that the row had all of the required fields */
+	for (uint32_t i = 0; i < schema->num_columns; i++) {
+		if (values[i] == NULL) return SYNTAX_ERROR;
+	}
+
+	int id = atoi(values[0]);
+	if (id < 0) return NEGATIVE_ID;
+	row->id = id;
+
+	/* the ints and chars go where the schema says, and the varchars
+	one after another after them */
+	char* varchar = row->data + schema->fixed_size;
+	for (uint32_t i = 0; i < schema->num_columns; i++) {
+		Column* column = &schema->columns[i];
+		if (column->type == COLUMN_INT) {
+			int32_t value = atoi(values[i]);
+			memcpy(row->data + column->offset, &value, INT_COLUMN_SIZE);
+			continue;
+		}
+
+		size_t length = strlen(values[i]);
+		if (length > column->size) return STRING_TOO_LONG;
+		if (column->type == COLUMN_CHAR) {
+			memcpy(row->data + column->offset, values[i], length);
+			memset(row->data + column->offset + length, 0, column->size - length);
+		} else {
+			*(uint8_t*) varchar = length;
+			memcpy(varchar + STRING_LENGTH_SIZE, values[i], length);
+			varchar += STRING_LENGTH_SIZE + length;
+		}
+	}
+	row->length = varchar - row->data;
+	return RECOGNIZED;
+}
+
+/*
+	finds a string column's value in an encoded row
+
+	schema: pointer to the Schema struct of the row's table
+	data: pointer to the encoded row
+	column_num: number of the column, which has to be a string
+	string: set to point at the value in the row (which isn't null
+		terminated)
+	returns: length of the value
+*/
+uint32_t get_column_string(Schema* schema, void* data, uint32_t column_num, char** string) {
+	Column* column = &schema->columns[column_num];
+	if (column->type == COLUMN_CHAR) {
+		*string = (char*) data + column->offset;
+		return strnlen(*string, column->size);
+	}
+
+	char* varchar = (char*) data + schema->fixed_size;
+	for (uint32_t i = 0; i < column->offset; i++) {
+		varchar += STRING_LENGTH_SIZE + *(uint8_t*) varchar;
+	}
+	*string = varchar + STRING_LENGTH_SIZE;
+	return *(uint8_t*) varchar;
+}
+
+/* returns true if a string column of an encoded row holds the given
+value */
+bool column_holds_value(Schema* schema, void* data, uint32_t column_num, const char* value) {
+	char* string;
+	uint32_t length = get_column_string(schema, data, column_num, &string);
+	return length == strlen(value) && memcmp(string, value, length) == 0;
+}
+
+/*
+	decodes a row out of a leaf into a Row struct, still encoded
+
+	source: pointer to the encoded row in the leaf
+	length: length of the encoded row
+	destination: pointer to the Row struct to fill in
+*/
+void deserialize_row(void* source, uint32_t length, Row* destination) {
+	memcpy(&(destination->id), source, ID_SIZE);
+	memcpy(destination->data, source, length);
+	destination->length = length;
+}
+
+/* returns the number of bytes the given row takes once serialized */
+uint32_t get_serialized_row_size(Row* row) {
+	return row->length;
+}
+
+/*
+	serializes the given row at the given location -- it's encoded
+	already, so it's only copied
+
+	source: pointer to the Row we want to serialize
+	destination: pointer to where the serialized row should be stored
+	returns: number of bytes written
+*/
+uint32_t serialize_row(Row* source, void* destination) {
+	memcpy(destination, source->data, source->length);
+	return source->length;
+}
+
+/*
+	sets a select up to print every column of its table, in the order
+	they were declared
+
+	schema: pointer to the Schema struct of the select's table
+	projection: pointer to the Projection struct to fill in
+*/
+void project_all_columns(Schema* schema, Projection* projection) {
+	projection->num_columns = schema->num_columns;
+	for (uint32_t i = 0; i < schema->num_columns; i++) {
+		projection->columns[i] = i;
+	}
+	projection->num_varchars = schema->num_varchars;
+}
+
+/*
+	adds a column to the ones a select prints
+
+	schema: pointer to the Schema struct of the select's table
+	name: pointer to a string containing the column's name
+	projection: pointer to the Projection struct to add it to
+	returns: false if the table has no column by that name
+*/
+bool project_column(Schema* schema, const char* name, Projection* projection) {
+	uint32_t column_num;
+	if (!find_column(schema, name, &column_num)) {
+		return false;
+	}
+	projection->columns[projection->num_columns++] = column_num;
+
+	/* a varchar is only found by walking past the ones before it, so
+	the walk goes as far as the last one that's wanted */
+	Column* column = &schema->columns[column_num];
+	if (column->type == COLUMN_VARCHAR && column->offset + 1 > projection->num_varchars) {
+		projection->num_varchars = column->offset + 1;
+	}
+	return true;
+}
+
+/*
+	writes the wanted columns of an encoded row into an OutputBuffer,
+	reading nothing else out of it but the lengths of the varchars
+	before the last wanted one
+
+	output: pointer to the OutputBuffer struct to write to
+	schema: pointer to the Schema struct of the row's table
+	projection: pointer to the Projection struct with the wanted columns
+	data: pointer to the encoded row
+*/
+void write_row(OutputBuffer* output, Schema* schema, Projection* projection, void* data) {
+	char* varchars[MAX_COLUMNS];
+	char* varchar = (char*) data + schema->fixed_size;
+	for (uint32_t i = 0; i < projection->num_varchars; i++) {
+		varchars[i] = varchar;
+		varchar += STRING_LENGTH_SIZE + *(uint8_t*) varchar;
+	}
+
+	begin_output_row(output);
+	for (uint32_t i = 0; i < projection->num_columns; i++) {
+		Column* column = &schema->columns[projection->columns[i]];
+		if (column->type == COLUMN_INT) {
+			int32_t value;
+			memcpy(&value, (char*) data + column->offset, INT_COLUMN_SIZE);
+			write_int_value(output, value, INT_COLUMN_SIZE);
+		} else if (column->type == COLUMN_CHAR) {
+			char* string = (char*) data + column->offset;
+			write_string_value(output, string, strnlen(string, column->size));
+		} else {
+			varchar = varchars[column->offset];
+			write_string_value(output, varchar + STRING_LENGTH_SIZE, *(uint8_t*) varchar);
+		}
+	}
+	end_output_row(output);
+}
+
+/* writes the wanted columns of an encoded row to standard output */
+void print_row(Schema* schema, Projection* projection, void* data) {
+	write_row(get_standard_output(), schema, projection, data);
+}
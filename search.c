@@ -0,0 +1,178 @@
+/*
+
+This program searches the keys of a node for a minimalistic SQLite DB
+based on a tutorial at https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS
+#endif
+
+/*
+	a node search binary searches down to KEY_SEARCH_WINDOW keys and
+	then counts the keys below the one it wants a vector at a time;
+	the compares are signed, so both sides get their top bit flipped
+*/
+
+/* the kernels, fastest first -- the first one the CPU supports is
+the default */
+static KeySearchKernel key_search_kernels[] = {
+#ifdef HAVE_X86_KERNELS
+	{ "avx2", count_keys_below_avx2 },
+	{ "sse2", count_keys_below_sse2 },
+#endif
+	{ "scalar", count_keys_below_scalar }
+};
+
+#define NUM_KEY_SEARCH_KERNELS (sizeof(key_search_kernels) / sizeof(KeySearchKernel))
+
+static KeySearchKernel* key_search_kernel = NULL;
+
+/*
+	counts the keys smaller than the given key, one at a time
+
+	keys: pointer to the first key
+	stride: distance between two keys, in words
+	num_keys: number of keys to look at
+	key: the key being searched for
+	returns: the number of keys below it
+*/
+uint32_t count_keys_below_scalar(const uint32_t* keys, uint32_t stride, uint32_t num_keys, uint32_t key) {
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < num_keys; i++) {
+		count += (keys[i * stride] < key);
+	}
+	return count;
+}
+
+#ifdef HAVE_X86_KERNELS
+
+/* counts the keys smaller than the given key four words at a time
+(so four keys, or two at a stride of two) */
+__attribute__((target("sse2")))
+uint32_t count_keys_below_sse2(const uint32_t* keys, uint32_t stride, uint32_t num_keys, uint32_t key) {
+	const __m128i sign = _mm_set1_epi32(0x80000000);
+	const __m128i needle = _mm_xor_si128(_mm_set1_epi32(key), sign);
+	/* only the lanes that hold keys get counted */
+	const __m128i lanes = (stride == 1) ? _mm_set1_epi32(-1) : _mm_set_epi32(0, -1, 0, -1);
+	uint32_t keys_per_load = 4 / stride;
+
+	/* a lane that compares true is all ones (-1), so subtracting the
+	compares keeps a running count in each lane */
+	__m128i counts = _mm_setzero_si128();
+	uint32_t i = 0;
+	for (; i + keys_per_load <= num_keys; i += keys_per_load) {
+		__m128i block = _mm_xor_si128(_mm_loadu_si128((const __m128i*) (keys + i * stride)), sign);
+		counts = _mm_sub_epi32(counts, _mm_and_si128(_mm_cmpgt_epi32(needle, block), lanes));
+	}
+	counts = _mm_add_epi32(counts, _mm_shuffle_epi32(counts, _MM_SHUFFLE(1, 0, 3, 2)));
+	counts = _mm_add_epi32(counts, _mm_shuffle_epi32(counts, _MM_SHUFFLE(2, 3, 0, 1)));
+	uint32_t count = _mm_cvtsi128_si32(counts);
+	return count + count_keys_below_scalar(keys + i * stride, stride, num_keys - i, key);
+}
+
+/* counts the keys smaller than the given key eight words at a time
+(so eight keys, or four at a stride of two) */
+__attribute__((target("avx2")))
+uint32_t count_keys_below_avx2(const uint32_t* keys, uint32_t stride, uint32_t num_keys, uint32_t key) {
+	const __m256i sign = _mm256_set1_epi32(0x80000000);
+	const __m256i needle = _mm256_xor_si256(_mm256_set1_epi32(key), sign);
+	const __m256i lanes = (stride == 1) ? _mm256_set1_epi32(-1) : _mm256_set_epi32(0, -1, 0, -1, 0, -1, 0, -1);
+	uint32_t keys_per_load = 8 / stride;
+
+	__m256i counts = _mm256_setzero_si256();
+	uint32_t i = 0;
+	for (; i + keys_per_load <= num_keys; i += keys_per_load) {
+		__m256i block = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*) (keys + i * stride)), sign);
+		counts = _mm256_sub_epi32(counts, _mm256_and_si256(_mm256_cmpgt_epi32(needle, block), lanes));
+	}
+	__m128i halves = _mm_add_epi32(_mm256_castsi256_si128(counts), _mm256_extracti128_si256(counts, 1));
+	halves = _mm_add_epi32(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(1, 0, 3, 2)));
+	halves = _mm_add_epi32(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+	uint32_t count = _mm_cvtsi128_si32(halves);
+	return count + count_keys_below_scalar(keys + i * stride, stride, num_keys - i, key);
+}
+
+#endif
+
+/* returns true if the CPU can run the given kernel */
+bool is_key_search_kernel_supported(KeySearchKernel* kernel) {
+#ifdef HAVE_X86_KERNELS
+	__builtin_cpu_init();
+	if (strcmp(kernel->name, "avx2") == 0) {
+		return __builtin_cpu_supports("avx2");
+	}
+	if (strcmp(kernel->name, "sse2") == 0) {
+		return __builtin_cpu_supports("sse2");
+	}
+#endif
+	return true;
+}
+
+/* returns the kernel node searches use, picking the fastest one the
+CPU supports if none has been chosen yet */
+KeySearchKernel* get_key_search_kernel() {
+	if (key_search_kernel == NULL) {
+		for (uint32_t i = 0; i < NUM_KEY_SEARCH_KERNELS; i++) {
+			if (is_key_search_kernel_supported(&key_search_kernels[i])) {
+				key_search_kernel = &key_search_kernels[i];
+				break;
+			}
+		}
+	}
+	return key_search_kernel;
+}
+
+/*
+	makes node searches use the kernel with the given name
+
+	name: pointer to a string containing the kernel's name
+	returns: false if there's no such kernel or the CPU can't run it
+*/
+bool set_key_search_kernel(const char* name) {
+	for (uint32_t i = 0; i < NUM_KEY_SEARCH_KERNELS; i++) {
+		if (strcmp(key_search_kernels[i].name, name) == 0) {
+			if (!is_key_search_kernel_supported(&key_search_kernels[i])) {
+				return false;
+			}
+			key_search_kernel = &key_search_kernels[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+	finds where the given key belongs among a node's sorted keys
+
+	keys: pointer to the first key
+	stride: distance between two keys, in words
+	num_keys: number of keys
+	key: the key being searched for
+	returns: index of the first key that's at least the given key
+		(num_keys if they're all smaller)
+*/
+uint32_t search_keys(const uint32_t* keys, uint32_t stride, uint32_t num_keys, uint32_t key) {
+	/* halve the range until it fits in a window -- the answer is
+	always between first and first + length, and the step is a
+	conditional move rather than a branch the CPU has to guess */
+	uint32_t first = 0;
+	uint32_t length = num_keys;
+	while (length > KEY_SEARCH_WINDOW) {
+		uint32_t half = length / 2;
+		first = (keys[(first + half) * stride] < key) ? first + half : first;
+		length -= half;
+	}
+
+	/* everything before the window is smaller and the answer is no
+	further than its end, so it's the window's start plus how many
+	of its keys are smaller */
+	return first + get_key_search_kernel()->count_keys_below(keys + first * stride, stride, length, key);
+}
@@ -7,12 +7,12 @@
 
 describe 'database' do # this sets the prefix for the tests
 	before do
-		`rm -rf test.db`
+		`rm -rf test.db test.db-wal test.rows`
 	end
 	
-	def run_script(commands) # each test calls this function
+	def run_script(commands, options = "") # each test calls this function
 		raw_output = nil
-		IO.popen("./diylite test.db", "r+") do |pipe| # it runs the executable
+		IO.popen("./diylite test.db #{options}", "r+") do |pipe| # it runs the executable
 			commands.each do |command|
 				# it feeds commands to the script's fake command line (db >)
 				begin
@@ -121,6 +121,26 @@ describe 'database' do # this sets the prefix for the tests
 		])
 	end
 
+	it 'packs short rows into a leaf and reads back long ones' do
+		rows = (1..80).map { |i| "#{i} user#{i} person#{i}@example.com" }
+		script = [
+			"insert " + rows.join(" "),
+			"insert 81 #{"a"*32} #{"b"*255}",
+			"mk_btree",
+			"select where id between 80 and 81",
+			"mk_exit",
+		]
+		result = run_script(script)
+
+		expect(result[3]).to eq("leaf (size 81)")
+		expect(result[-4..-1]).to eq([
+			"db > (80, user80, person80@example.com)",
+			"(81, #{"a"*32}, #{"b"*255})",
+			"Executed!",
+			"db > ",
+		])
+	end
+
 	it 'prints constants' do
 		script = [
 			"mk_constants",
@@ -130,18 +150,71 @@ describe 'database' do # this sets the prefix for the tests
 
 		expect(result).to match_array([
 			"db > Constants:",
+			"PAGE_SIZE: 4096",
 			"ROW_SIZE: 293",
 			"COMMON_NODE_HEADER_SIZE: 6",
-			"LEAF_NODE_HEADER_SIZE: 14",
-			"LEAF_NODE_CELL_SIZE: 297",
-			"LEAF_NODE_SPACE_FOR_CELLS: 4082",
-			"LEAF_NODE_MAX_CELLS: 13",
-			"INTERNAL_NODE_HEADER_SIZE: 14",
+			"LEAF_NODE_HEADER_SIZE: 18",
+			"LEAF_NODE_SLOT_SIZE: 8",
+			"LEAF_NODE_MAX_CELL_SIZE: 301",
+			"LEAF_NODE_SPACE_FOR_CELLS: 4078",
+			"LEAF_NODE_MAX_CELLS: 291",
+			"INTERNAL_NODE_HEADER_SIZE: 18",
 			"INTERNAL_NODE_CELL_SIZE: 8",
+			"INTERNAL_NODE_MAX_CELLS: 509",
 			"db > ",
 		])
 	end
 
+	it 'keeps the page size the DB was created with' do
+		script = (1..200).map do |i|
+			"insert #{i} user#{i} person#{i}@example.com"
+		end
+		script << "mk_exit"
+		run_script(script, "--page-size 16384")
+		expect(File.size("test.db") % 16384).to eq(0)
+
+		# the header decides, not the flag
+		result = run_script(["mk_constants", "select where id = 200", "mk_exit"], "--page-size 4096")
+		expect(result).to include("PAGE_SIZE: 16384")
+		expect(result).to include("LEAF_NODE_SPACE_FOR_CELLS: 16366")
+		expect(result).to include("db > (200, user200, person200@example.com)")
+	end
+
+	it 'turns away a file with a different format version' do
+		run_script(["mk_exit"])
+		File.open("test.db", "r+b") do |file|
+			file.seek(20)
+			file.write([99].pack("V"))
+		end
+		result = run_script(["mk_exit"])
+		expect(result).to eq(["That file's format is version 99 and I only speak version 1 -- start a new one"])
+	end
+
+	it 'finds the same rows with every way of searching keys' do
+		# even ids only, in a scrambled order, so the odd ones are
+		# misses that land between keys
+		script = (1..2000).to_a.shuffle(random: Random.new(14)).map do |i|
+			"insert #{2 * i} user#{i} person#{i}@example.com"
+		end
+		script << "mk_exit"
+		run_script(script)
+
+		lookups = [1, 2, 3, 64, 65, 1001, 2000, 3998, 3999, 4000, 4001].map do |id|
+			"select where id = #{id}"
+		end
+		lookups << "select where id between 1999 and 2007"
+		lookups << "mk_exit"
+		scalar = run_script(lookups, "--key-search scalar")
+		expect(run_script(lookups)).to eq(scalar)
+		expect(scalar).to include("db > (2000, user1000, person1000@example.com)")
+		expect(scalar).to include("db > (4000, user2000, person2000@example.com)")
+		expect(scalar.count { |line| line.start_with?("db > (") }).to eq(6)
+		expect(scalar).to include("(2006, user1003, person1003@example.com)")
+
+		result = run_script(["mk_exit"], "--key-search abacus")
+		expect(result).to include("I don't know how to search keys with 'abacus' -- not on this CPU, anyway")
+	end
+
 	it 'allows printing out the structure of a one-node btree' do
 		script = [3, 1, 2].map do |i|
 			"insert #{i} user#{i} person#{i}@example.com"
@@ -183,12 +256,13 @@ describe 'database' do # this sets the prefix for the tests
 	end
 
 	it 'allows printing out the structure of a 3-leaf-node btree' do
+		# rows as long as they get, so only 13 fit in a leaf
 		script = (1..14).map do |i|
-			"insert #{i} user#{i} person#{i}@example.com"
+			"insert #{i} #{"a"*32} #{"a"*255}"
 		end
 
 		script << "mk_btree"
-		script << "insert 15 user15 person15@example.com"
+		script << "insert 15 #{"a"*32} #{"a"*255}"
 		script << "mk_exit"
 		result = run_script(script)
 
@@ -285,4 +359,563 @@ describe 'database' do # this sets the prefix for the tests
 		result = run_script(script)
 	end
 
+	it 'keeps every row when the cache is smaller than the table' do
+		script = (1..300).map do |i|
+			"insert #{i} user#{i} person#{i}@example.com"
+		end
+		script << "mk_exit"
+		run_script(script, "--cache-frames 16")
+
+		result = run_script(["select", "mk_exit"], "--cache-frames 16")
+		expect(result.length).to eq(302)
+		expect(result.first).to eq("db > (1, user1, person1@example.com)")
+		expect(result[299]).to eq("(300, user300, person300@example.com)")
+	end
+
+	it 'reads and updates rows through the file mapping' do
+		script = (1..20).map do |i|
+			"insert #{i} user#{i} person#{i}@example.com"
+		end
+		script << "mk_exit"
+		run_script(script, "--mmap")
+
+		result = run_script([
+			"insert 21 user21 person21@example.com",
+			"mk_exit",
+		], "--mmap")
+		expect(result).to eq(["db > Executed!", "db > "])
+
+		result = run_script(["select", "mk_exit"], "--mmap")
+		expect(result.length).to eq(23)
+		expect(result[20]).to eq("(21, user21, person21@example.com)")
+	end
+
+	it 'recovers logged inserts after a crash' do
+		script = (1..30).map do |i|
+			"insert #{i} user#{i} person#{i}@example.com"
+		end
+		# no mk_exit: the input runs out and the process dies without
+		# ever flushing its pages
+		result = run_script(script, "--wal")
+		expect(result.last).to eq("db > Error reading input")
+
+		result = run_script(["select", "mk_exit"])
+		expect(result.length).to eq(32)
+		expect(result[29]).to eq("(30, user30, person30@example.com)")
+	end
+
+	it 'keeps an acknowledged commit after the process is killed' do
+		IO.popen("./diylite test.db --wal --group-commit-ms 50", "r+") do |pipe|
+			# a meta command flushes what's been printed so far, so
+			# "Executed!" shows up as soon as the insert commits
+			pipe.puts "insert 1 user1 person1@example.com"
+			pipe.puts "mk_flush"
+			output = ""
+			output << pipe.readpartial(4096) until output.include?("Executed!")
+			Process.kill("KILL", pipe.pid)
+		end
+
+		result = run_script(["select", "mk_exit"])
+		expect(result).to eq([
+			"db > (1, user1, person1@example.com)",
+			"Executed!",
+			"db > ",
+		])
+	end
+
+	it 'bulk loads sorted rows and keeps inserting afterwards' do
+		rows = (1..100).map do |i|
+			"#{i * 2} user#{i} person#{i}@example.com"
+		end
+		File.write("test.rows", rows.join("\n") + "\n")
+
+		result = run_script(["mk_bulkload test.rows 0.5", "mk_exit"])
+		expect(result).to eq(["db > Loaded 100 rows", "db > "])
+
+		result = run_script([
+			"insert 51 user51 person51@example.com",
+			"insert 52 user52 person52@example.com",
+			"select",
+			"mk_exit",
+		])
+		expect(result[0]).to eq("db > Executed!")
+		expect(result[1]).to eq("db > Error: I don't like seconds")
+		expect(result.length).to eq(105)
+		expect(result[2]).to eq("db > (2, user1, person1@example.com)")
+		expect(result[27]).to eq("(51, user51, person51@example.com)")
+		expect(result[102]).to eq("(200, user100, person100@example.com)")
+	end
+
+	it 'never leaves an internal node with one child after a sparse bulk load' do
+		rows = (1..100).map do |i|
+			"#{i} user#{i} person#{i}@example.com"
+		end
+		File.write("test.rows", rows.join("\n") + "\n")
+
+		result = run_script(["mk_bulkload test.rows 0.1", "mk_btree", "mk_exit"])
+		expect(result[0]).to eq("db > Loaded 100 rows")
+		expect(result.grep(/internal \(size 0\)/)).to eq([])
+	end
+
+	it 'inserts many rows in one statement, in any order' do
+		rows = (1..40).to_a.reverse.map do |i|
+			"#{i} user#{i} person#{i}@example.com"
+		end
+		result = run_script([
+			"insert #{rows.join(" ")}",
+			"insert 41 user41 person41@example.com 30 dup dup@example.com",
+			"select",
+			"mk_exit",
+		])
+		expect(result[0]).to eq("db > Executed!")
+		expect(result[1]).to eq("db > Error: I don't like seconds")
+		expect(result.length).to eq(44)
+		expect(result[2]).to eq("db > (1, user1, person1@example.com)")
+		expect(result[41]).to eq("(40, user40, person40@example.com)")
+	end
+
+	it 'splits one leaf into more leaves than the cache has frames' do
+		rows = (1..3000).map do |i|
+			"#{i} user#{i} person#{i}@example.com"
+		end
+		result = run_script([
+			"insert #{rows.join(" ")}",
+			"select count(*)",
+			"select where id between 2999 and 3000",
+			"mk_exit",
+		], "--cache-frames 16")
+		expect(result).to eq([
+			"db > Executed!",
+			"db > (3000)",
+			"Executed!",
+			"db > (2999, user2999, person2999@example.com)",
+			"(3000, user3000, person3000@example.com)",
+			"Executed!",
+			"db > ",
+		])
+	end
+
+	it 'logs more changed pages than the cache holds in one statement' do
+		rows = (1..20000).map do |i|
+			"#{i} user#{i} person#{i}@example.com"
+		end
+		run_script(["insert #{rows.join(" ")}", "mk_exit"], "--wal --cache-frames 16")
+		result = run_script(["select count(*)", "mk_exit"], "--wal")
+		expect(result[0]).to eq("db > (20000)")
+	end
+
+	it 'selects a single id or a range of ids' do
+		script = (1..30).map do |i|
+			"insert #{i * 2} user#{i} person#{i}@example.com"
+		end
+		script += [
+			"select where id = 14",
+			"select where id = 15",
+			"select where id between 25 and 31",
+			"select where id = 14 please",
+			"mk_exit",
+		]
+		result = run_script(script)
+		expect(result[30..-1]).to eq([
+			"db > (14, user7, person7@example.com)",
+			"Executed!",
+			"db > Executed!",
+			"db > (26, user13, person13@example.com)",
+			"(28, user14, person14@example.com)",
+			"(30, user15, person15@example.com)",
+			"Executed!",
+			"db > That syntax is wack",
+			"db > ",
+		])
+	end
+
+	it 'finds every row after the root internal node splits' do
+		# long emails keep a leaf down to 14 rows, so 8000 rows need more
+		# leaves than the root can hold; 100 rows per insert keeps the
+		# output small enough for the pipe
+		email = lambda { |i| "person#{i}@example.com".rjust(255, "x") }
+		ids = (1..8000).to_a.shuffle(random: Random.new(42))
+		script = ids.each_slice(100).map do |slice|
+			"insert " + slice.map { |i| "#{i} user#{i} #{email.call(i)}" }.join(" ")
+		end
+		script += [1, 4321, 8000].map { |i| "select where id = #{i}" }
+		script << "select"
+		script << "mk_exit"
+		result = run_script(script)
+
+		expect(result[80..85]).to eq([
+			"db > (1, user1, #{email.call(1)})",
+			"Executed!",
+			"db > (4321, user4321, #{email.call(4321)})",
+			"Executed!",
+			"db > (8000, user8000, #{email.call(8000)})",
+			"Executed!",
+		])
+		expect(result.length).to eq(80 + 6 + 8000 + 2)
+		expect(result[-3]).to eq("(8000, user8000, #{email.call(8000)})")
+	end
+
+	it 'deletes rows and reuses the freed pages' do
+		inserts = lambda do |ids|
+			ids.each_slice(100).map do |slice|
+				"insert " + slice.map { |i| "#{i} user#{i} person#{i}@example.com" }.join(" ")
+			end
+		end
+		run_script(inserts.call((1..300).to_a) + ["mk_exit"])
+		size_before = File.size("test.db")
+
+		result = run_script([
+			"delete where id between 3 and 299",
+			"delete where id = 1",
+			"delete where id = 1",
+			"delete",
+			"select",
+			"mk_exit",
+		])
+		expect(result).to eq([
+			"db > Executed!",
+			"db > Executed!",
+			"db > Executed!",
+			"db > That syntax is wack",
+			"db > (2, user2, person2@example.com)",
+			"(300, user300, person300@example.com)",
+			"Executed!",
+			"db > ",
+		])
+
+		# putting the rows back shouldn't need any new pages
+		result = run_script(inserts.call([1] + (3..299).to_a) + ["select where id = 150", "mk_exit"])
+		expect(result[-3]).to eq("db > (150, user150, person150@example.com)")
+		expect(File.size("test.db")).to eq(size_before)
+	end
+
+	it 'counts splits and statements until the stats are reset' do
+		script = (1..20).map do |i|
+			"insert #{i} #{"a"*32} #{"a"*255}"
+		end
+		script += ["mk_stats", "mk_stats_reset", "mk_stats", "mk_exit"]
+		result = run_script(script)
+
+		expect(result).to include("leaf splits: 1")
+		expect(result).to include("root splits: 1")
+		expect(result).to include("statements: 20")
+		expect(result).to include("statements: 0")
+		expect(result.last).to eq("db > ")
+	end
+
+	it 'gives the same answers with every I/O backend' do
+		# a tiny cache, so pages get written back as they're evicted
+		script = (1..600).to_a.shuffle(random: Random.new(16)).map do |i|
+			"insert #{i} user#{i} person#{i}@example.com"
+		end
+		script << "mk_exit"
+		# (the default is io_uring where the kernel has it)
+		results = ["", "--io-backend threads", "--io-backend sync"].map do |backend|
+			`rm -rf test.db`
+			run_script(script, "#{backend} --cache-frames 16")
+			run_script(["select where id between 290 and 310", "mk_exit"], "#{backend} --cache-frames 16")
+		end
+		expect(results[1]).to eq(results[0])
+		expect(results[2]).to eq(results[0])
+		expect(results[0].length).to eq(23)
+
+		result = run_script(["mk_exit"], "--io-backend carrier-pigeon")
+		expect(result).to include("There's no 'carrier-pigeon' I/O around here -- try io_uring, threads or sync")
+	end
+
+	it 'reads leaves ahead of a scan unless told not to' do
+		script = (1..1000).map do |i|
+			"insert #{i} user#{i} person#{i}@example.com"
+		end
+		script << "mk_exit"
+		run_script(script)
+
+		scans = ["select", "select where id between 500 and 520", "mk_stats", "mk_exit"]
+		result = run_script(scans)
+		ahead = result.find { |line| line.start_with?("pages read ahead: ") }
+		expect(ahead.split(": ").last.to_i > 0).to eq(true)
+		expect(result.count { |line| line.include?("(1000, user1000,") }).to eq(1)
+
+		without = run_script(scans, "--read-ahead 0")
+		expect(without).to include("pages read ahead: 0")
+		# the leaves read ahead are already in the cache when the scan gets there
+		misses = lambda { |lines| lines.find { |line| line.start_with?("cache misses: ") }.split(": ").last.to_i }
+		expect(misses.call(result) < misses.call(without)).to eq(true)
+		rows = lambda { |lines| lines.grep(/^(db > )?\(\d+, /) }
+		expect(rows.call(without)).to eq(rows.call(result))
+		expect(rows.call(result).length).to eq(1021)
+	end
+
+	it 'gives the same answers with latches on' do
+		script = (1..800).to_a.shuffle(random: Random.new(18)).each_slice(40).map do |slice|
+			"insert " + slice.map { |i| "#{i} user#{i} person#{i}@example.com" }.join(" ")
+		end
+		script += [
+			"delete where id between 100 and 450",
+			"delete where id = 700",
+			"select where id between 440 and 470",
+			"select",
+			"mk_exit",
+		]
+		results = ["", "--concurrent"].map do |options|
+			`rm -rf test.db`
+			run_script(script, options)
+		end
+		expect(results[1]).to eq(results[0])
+		expect(results[0].grep(/\(\d+, /).length).to eq(20 + 448)
+
+		result = run_script(["mk_exit"], "--concurrent --mmap")
+		expect(result).to include("Latches need frames to live in, so --concurrent and --mmap don't mix")
+
+		result = run_script(["mk_exit"], "--concurrent --cache-frames 16")
+		expect(result).to include("16 frames won't fit what a statement might hold on to; give me at least 1018")
+	end
+
+	it 'splits a select between scan threads' do
+		script = (1..2000).to_a.shuffle(random: Random.new(19)).each_slice(100).map do |slice|
+			"insert " + slice.map { |i| "#{i} user#{i} person#{i}@example.com" }.join(" ")
+		end
+		script << "mk_exit"
+		run_script(script)
+
+		selects = ["select", "select where id between 150 and 1700", "select where id = 1999", "mk_exit"]
+		expect(run_script(selects, "--concurrent --scan-threads 4")).to eq(run_script(selects))
+
+		# unordered, the same rows come out, in whatever order they're done
+		rows = lambda do |statement|
+			result = run_script([statement, "mk_exit"], "--concurrent --scan-threads 4")
+			result.map { |line| line.sub("db > ", "") }.grep(/^\(\d+, /)
+		end
+		unordered = rows.call("select unordered where id between 150 and 1700")
+		expect(unordered.sort).to eq(rows.call("select where id between 150 and 1700").sort)
+		expect(unordered.length).to eq(1551)
+
+		result = run_script(["mk_exit"], "--scan-threads 4")
+		expect(result).to include("Scan threads would trip over each other without latches -- add --concurrent")
+	end
+
+	it 'counts, sums and finds the smallest and biggest id without printing rows' do
+		ids = (1..3000).step(3).to_a
+		script = ids.shuffle(random: Random.new(20)).each_slice(100).map do |slice|
+			"insert " + slice.map { |i| "#{i} user#{i} person#{i}@example.com" }.join(" ")
+		end
+		script << "delete where id between 1201 and 1500"
+		script << "mk_exit"
+		run_script(script)
+		ids.reject! { |i| i.between?(1201, 1500) }
+
+		aggregates = [
+			"select count(*)",
+			"select min(id)",
+			"select max(id)",
+			"select sum(id)",
+			"select count(*) where id between 100 and 2500",
+			"select min(id) where id between 100 and 2500",
+			"select max(id) where id between 100 and 2500",
+			"select sum(id) where id = 1000",
+			"select count(*) where id between 1201 and 1500",
+			"select max(id) where id between 1201 and 1500",
+			"mk_exit",
+		]
+		in_range = ids.select { |i| i.between?(100, 2500) }
+		expected = [
+			"db > (#{ids.length})",
+			"db > (#{ids.min})",
+			"db > (#{ids.max})",
+			"db > (#{ids.sum})",
+			"db > (#{in_range.length})",
+			"db > (#{in_range.min})",
+			"db > (#{in_range.max})",
+			"db > (1000)",
+			"db > (0)",
+			"db > (NULL)",
+		].flat_map { |line| [line, "Executed!"] }
+		expect(run_script(aggregates)).to eq(expected + ["db > "])
+		expect(run_script(aggregates, "--concurrent --scan-threads 4")).to eq(expected + ["db > "])
+	end
+
+	it 'finds rows by email and username through an index' do
+		script = (1..500).to_a.shuffle(random: Random.new(21)).each_slice(50).map do |slice|
+			"insert " + slice.map { |i| "#{i} user#{i % 7} person#{i}@example.com" }.join(" ")
+		end
+		script << "create index on email"
+		script << "insert 501 user3 person250@example.com"
+		script << "delete where id between 240 and 260"
+		script << "create index on username"
+		script << "create index on email"
+		script << "create index on id"
+		script << "mk_exit"
+		result = run_script(script)
+		expect(result).to include("db > Error: that column's already got an index")
+		expect(result).to include("db > That syntax is wack")
+
+		# the indexes are in the file, so they're still there after a reopen
+		lookups = [
+			"select where email = person250@example.com",
+			"select where email = person77@example.com",
+			"select where email = person1000@example.com",
+			"select where username = user3",
+			"mk_exit",
+		]
+		user3 = (1..500).select { |i| i % 7 == 3 && !i.between?(240, 260) }
+		expected = [
+			"db > (501, user3, person250@example.com)",
+			"Executed!",
+			"db > (77, user0, person77@example.com)",
+			"Executed!",
+			"db > Executed!",
+			"db > (#{user3[0]}, user3, person#{user3[0]}@example.com)",
+		] + user3[1..-1].map { |i| "(#{i}, user3, person#{i}@example.com)" } + [
+			"(501, user3, person250@example.com)",
+			"Executed!",
+			"db > ",
+		]
+		expect(run_script(lookups)).to eq(expected)
+		expect(run_script(lookups, "--concurrent")).to eq(expected)
+	end
+
+	it 'keeps any number of rows with the same value in an index' do
+		script = ["create index on username"]
+		script += (1..3000).to_a.shuffle(random: Random.new(22)).each_slice(100).map do |slice|
+			"insert " + slice.map { |i| "#{i} user#{i % 2} person#{i}@example.com" }.join(" ")
+		end
+		script << "delete where id between 100 and 2900"
+		script << "mk_exit"
+		run_script(script)
+
+		user1 = (1..3000).select { |i| i.odd? && !i.between?(100, 2900) }
+		expected = [
+			"db > (#{user1[0]}, user1, person#{user1[0]}@example.com)",
+		] + user1[1..-1].map { |i| "(#{i}, user1, person#{i}@example.com)" } + [
+			"Executed!",
+			"db > ",
+		]
+		lookups = ["select where username = user1", "mk_exit"]
+		expect(run_script(lookups)).to eq(expected)
+		expect(run_script(lookups, "--concurrent")).to eq(expected)
+	end
+
+	it 'keeps several tables in one file' do
+		script = [
+			"create table pets",
+			"create table pets",
+			"create table averyveryverylongname",
+			"insert 1 user1 person1@example.com",
+		]
+		script += (1..300).map { |i| "insert into pets #{i} pet#{i} pet#{i}@example.com" }
+		script << "create index on pets (email)"
+		script << "delete from pets where id between 2 and 299"
+		script << "insert into nowhere 1 a b"
+		script << "mk_exit"
+		result = run_script(script)
+		expect(result).to include("db > Error: that table's already a thing")
+		expect(result).to include("db > Your strings are coming on a little too long")
+		expect(result).to include("db > Error: never heard of that table")
+
+		# the catalog is in the file, so the tables are still there after a reopen
+		lookups = [
+			"select",
+			"select from users",
+			"select from pets",
+			"select count(*) from pets",
+			"select from pets where email = pet300@example.com",
+			"mk_exit",
+		]
+		expected = [
+			"db > (1, user1, person1@example.com)",
+			"Executed!",
+			"db > (1, user1, person1@example.com)",
+			"Executed!",
+			"db > (1, pet1, pet1@example.com)",
+			"(300, pet300, pet300@example.com)",
+			"Executed!",
+			"db > (2)",
+			"Executed!",
+			"db > (300, pet300, pet300@example.com)",
+			"Executed!",
+			"db > ",
+		]
+		expect(run_script(lookups)).to eq(expected)
+		expect(run_script(lookups, "--concurrent")).to eq(expected)
+	end
+
+	it 'creates tables with their own columns' do
+		script = [
+			"create table pets (id int, name char(8), age int, owner varchar(20))",
+			"create table bad (name int)",
+			"create table bad (id int, id int)",
+			"create table bad (id int, name blob)",
+			"insert into pets 1 rex 4 alice",
+			"insert into pets 2 fido 11 bob",
+			"insert into pets 3 toolongname 1 carol",
+			"insert into pets 4 spot",
+			"mk_exit",
+		]
+		result = run_script(script)
+		expect(result.count("db > That syntax is wack")).to eq(4)
+		expect(result).to include("db > Your strings are coming on a little too long")
+
+		# the columns are in the catalog, so they're still there after a reopen
+		lookups = [
+			"select from pets",
+			"select from pets where name = fido",
+			"mk_exit",
+		]
+		expect(run_script(lookups)).to eq([
+			"db > (1, rex, 4, alice)",
+			"(2, fido, 11, bob)",
+			"Executed!",
+			"db > (2, fido, 11, bob)",
+			"Executed!",
+			"db > ",
+		])
+	end
+
+	it 'prints only the columns a select names' do
+		script = [
+			"create table pets (id int, name char(8), owner varchar(20), vet varchar(10))",
+			"insert into pets 1 rex alice drx",
+			"insert into pets 2 fido bob dry",
+			"insert 1 user1 person1@example.com",
+			"select id",
+			"select email, id",
+			"select vet, name from pets where id = 2",
+			"select owner ,id from pets where name = rex",
+			"select nope from pets",
+			"mk_exit",
+		]
+		result = run_script(script)
+		expect(result).to include(
+			"db > (1)",
+			"db > (person1@example.com, 1)",
+			"db > (dry, fido)",
+			"db > (alice, 1)",
+			"db > Error: that table doesn't have that column",
+		)
+	end
+
+	it 'writes rows as tsv or csv with nothing else on standard output' do
+		script = [
+			"insert 1 user1 a,\"b@example.com",
+			"insert 2 us\tr2 person2@example.com",
+			"select",
+			"select sum(id) where id = 9",
+			"select count(*)",
+			"mk_exit",
+		]
+		expect(run_script(script, "--output csv 2>/dev/null")).to eq([
+			"1,user1,\"a,\"\"b@example.com\"",
+			"2,us\tr2,person2@example.com",
+			"",
+			"2",
+		])
+		`rm -rf test.db`
+		expect(run_script(script, "--output tsv 2>/dev/null")).to eq([
+			"1\tuser1\ta,\"b@example.com",
+			"2\tus\\tr2\tperson2@example.com",
+			"\\N",
+			"2",
+		])
+	end
+
 end
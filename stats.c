@@ -0,0 +1,172 @@
+/*
+
+This program keeps statistics for a minimalistic SQLite DB based on
+a tutorial at https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+
+/*
+	the counters live in the pager, which every read, write and node
+	operation already goes through, and are bumped where things happen;
+	the WAL counts its own fsyncs, since its flusher thread does them
+*/
+
+
+/* returns a monotonic timestamp in nanoseconds */
+uint64_t get_time_ns() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* zeroes every counter (the dump settings are left alone) */
+void reset_stats(Pager* pager) {
+	memset(&pager->stats, 0, sizeof(Stats));
+	if (pager->wal != NULL) {
+		pthread_mutex_lock(&pager->wal->lock);
+		pager->wal->num_syncs = 0;
+		pthread_mutex_unlock(&pager->wal->lock);
+	}
+}
+
+/* returns the number of fsyncs so far, on the DB file and the WAL */
+uint64_t get_num_fsyncs(Pager* pager) {
+	uint64_t num_fsyncs = pager->stats.fsyncs;
+	if (pager->wal != NULL) {
+		pthread_mutex_lock(&pager->wal->lock);
+		num_fsyncs += pager->wal->num_syncs;
+		pthread_mutex_unlock(&pager->wal->lock);
+	}
+	return num_fsyncs;
+}
+
+/* returns the histogram bucket for a statement time -- bucket i holds
+times under 2^(i+1) microseconds, and the last bucket holds the rest */
+uint32_t get_latency_bucket(uint64_t elapsed_ns) {
+	uint64_t elapsed_us = elapsed_ns / 1000;
+	uint32_t bucket = 0;
+	while (elapsed_us > 1 && bucket < STATS_LATENCY_BUCKETS - 1) {
+		elapsed_us >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+/*
+	counts a finished statement and how long it took, then dumps the
+	stats if a dump is due
+
+	pager: pointer to a populated Pager struct
+	elapsed_ns: how long the statement took
+*/
+void record_statement_time(Pager* pager, uint64_t elapsed_ns) {
+	Stats* stats = &pager->stats;
+	lock_pool(pager);
+	stats->statements++;
+	stats->statement_ns += elapsed_ns;
+	if (elapsed_ns > stats->max_statement_ns) {
+		stats->max_statement_ns = elapsed_ns;
+	}
+	stats->statement_latencies[get_latency_bucket(elapsed_ns)]++;
+	unlock_pool(pager);
+
+	if (pager->stats_dump_file != NULL &&
+		get_time_ns() - pager->last_stats_dump_ns >= pager->stats_dump_interval_ns) {
+		dump_stats(pager);
+	}
+}
+
+/* prints the counters for the mk_stats command */
+void print_stats(Pager* pager) {
+	Stats* stats = &pager->stats;
+	uint64_t lookups = stats->cache_hits + stats->cache_misses;
+	printf("cache hits: %llu\n", (unsigned long long) stats->cache_hits);
+	printf("cache misses: %llu\n", (unsigned long long) stats->cache_misses);
+	printf("cache hit rate: %.1f%%\n", lookups > 0 ? 100.0 * stats->cache_hits / lookups : 0.0);
+	printf("pages read: %llu (%llu bytes)\n",
+		(unsigned long long) stats->pages_read, (unsigned long long) stats->bytes_read);
+	printf("pages read ahead: %llu\n", (unsigned long long) stats->pages_read_ahead);
+	printf("pages written: %llu (%llu bytes)\n",
+		(unsigned long long) stats->pages_written, (unsigned long long) stats->bytes_written);
+	printf("wal bytes written: %llu\n", (unsigned long long) stats->wal_bytes_written);
+	printf("fsyncs: %llu\n", (unsigned long long) get_num_fsyncs(pager));
+	printf("leaf splits: %llu\n", (unsigned long long) stats->leaf_splits);
+	printf("internal splits: %llu\n", (unsigned long long) stats->internal_splits);
+	printf("root splits: %llu\n", (unsigned long long) stats->root_splits);
+	printf("leaf merges: %llu\n", (unsigned long long) stats->leaf_merges);
+	printf("internal merges: %llu\n", (unsigned long long) stats->internal_merges);
+	printf("statements: %llu\n", (unsigned long long) stats->statements);
+	if (stats->statements == 0) {
+		return;
+	}
+
+	printf("statement time: mean %.1f us, max %.1f us\n",
+		stats->statement_ns / 1e3 / stats->statements, stats->max_statement_ns / 1e3);
+	for (uint32_t i = 0; i < STATS_LATENCY_BUCKETS; i++) {
+		if (stats->statement_latencies[i] == 0) {
+			continue;
+		}
+		if (i == STATS_LATENCY_BUCKETS - 1) {
+			printf("  >= %llu us: %llu\n", 1ULL << i, (unsigned long long) stats->statement_latencies[i]);
+		} else {
+			printf("  < %llu us: %llu\n", 1ULL << (i + 1), (unsigned long long) stats->statement_latencies[i]);
+		}
+	}
+}
+
+/*
+	starts appending the stats to a file every so often, replacing
+	any dump that was already running
+
+	pager: pointer to a populated Pager struct
+	path: pointer to a string containing the dump file's path
+	interval_seconds: least time between two dumps
+	returns: false if the file couldn't be opened
+*/
+bool start_stats_dump(Pager* pager, const char* path, double interval_seconds) {
+	FILE* file = fopen(path, "a");
+	if (file == NULL) {
+		return false;
+	}
+	stop_stats_dump(pager);
+	pager->stats_dump_file = file;
+	pager->stats_dump_interval_ns = interval_seconds * 1e9;
+	pager->last_stats_dump_ns = get_time_ns();
+	return true;
+}
+
+/* stops the periodic dump, if there is one */
+void stop_stats_dump(Pager* pager) {
+	if (pager->stats_dump_file != NULL) {
+		fclose(pager->stats_dump_file);
+		pager->stats_dump_file = NULL;
+	}
+}
+
+/* appends one line of counters to the dump file, stamped with the
+wall clock time so it can be lined up with other logs */
+void dump_stats(Pager* pager) {
+	Stats* stats = &pager->stats;
+	fprintf(pager->stats_dump_file,
+		"time=%lld cache_hits=%llu cache_misses=%llu pages_read=%llu bytes_read=%llu "
+		"pages_read_ahead=%llu pages_written=%llu bytes_written=%llu wal_bytes_written=%llu "
+		"fsyncs=%llu leaf_splits=%llu internal_splits=%llu root_splits=%llu leaf_merges=%llu "
+		"internal_merges=%llu statements=%llu statement_ns=%llu max_statement_ns=%llu\n",
+		(long long) time(NULL), (unsigned long long) stats->cache_hits,
+		(unsigned long long) stats->cache_misses, (unsigned long long) stats->pages_read,
+		(unsigned long long) stats->bytes_read, (unsigned long long) stats->pages_read_ahead,
+		(unsigned long long) stats->pages_written, (unsigned long long) stats->bytes_written,
+		(unsigned long long) stats->wal_bytes_written, (unsigned long long) get_num_fsyncs(pager),
+		(unsigned long long) stats->leaf_splits, (unsigned long long) stats->internal_splits,
+		(unsigned long long) stats->root_splits, (unsigned long long) stats->leaf_merges,
+		(unsigned long long) stats->internal_merges, (unsigned long long) stats->statements,
+		(unsigned long long) stats->statement_ns,
+		(unsigned long long) stats->max_statement_ns);
+	fflush(pager->stats_dump_file);
+	pager->last_stats_dump_ns = get_time_ns();
+}
@@ -0,0 +1,656 @@
+/*
+
+This program implements the write-ahead log (WAL) for a minimalistic
+SQLite DB based on a tutorial at https://cstack.github.io/db_tutorial/.
+
+Written/copied by Mary Keenan for Project 1 of Software Systems 2019
+at Olin College of Engineering.
+
+*/
+
+#include "diylite.h"
+
+/*
+	a statement counts once its commit record is in the WAL and synced,
+	and no page reaches the DB file before its WAL records are synced,
+	so after a crash the DB file plus the WAL add up to a consistent
+	tree; a checkpoint folds the WAL into the DB file and empties it
+*/
+
+
+/*
+	computes the FNV-1a checksum of a WAL record, so recovery can tell
+	a complete record from a torn one
+
+	header: pointer to the record header (its checksum is skipped)
+	data: pointer to the page image, or NULL for commit records
+	page_size: size of the page image
+	returns: checksum of the record
+*/
+uint32_t compute_wal_checksum(WalRecordHeader* header, void* data, uint32_t page_size) {
+	uint32_t hash = 2166136261u;
+	uint8_t* bytes = (uint8_t*) header;
+	for (size_t i = 0; i < offsetof(WalRecordHeader, checksum); i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	bytes = data;
+	for (size_t i = 0; data != NULL && i < page_size; i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+/* builds the WAL filename for the given DB filename; the caller frees
+the returned string */
+char* get_wal_path(const char* filename) {
+	char* wal_path = malloc(strlen(filename) + strlen(WAL_SUFFIX) + 1);
+	strcpy(wal_path, filename);
+	strcat(wal_path, WAL_SUFFIX);
+	return wal_path;
+}
+
+/*
+	replays every committed statement left in the WAL into the DB file,
+	then removes the WAL -- this runs on every open, so a DB that
+	crashed with the WAL on is repaired even if it's reopened without it
+
+	file_descriptor: descriptor of the open DB file
+	filename: pointer to a string containing the DB filename
+	page_size: the DB's page size, which is also the size of every
+		page image in the WAL
+*/
+void recover_wal(int file_descriptor, const char* filename, uint32_t page_size) {
+	char* wal_path = get_wal_path(filename);
+	int wal_fd = open(wal_path, O_RDWR);
+	if (wal_fd == -1) {
+		free(wal_path);
+		return;
+	}
+
+	/* frames of the statement we're reading, remembered by their
+	position in the WAL until we know whether it committed */
+	uint32_t capacity = 64;
+	uint32_t num_pending = 0;
+	off_t* pending_offsets = malloc(capacity * sizeof(off_t));
+	uint32_t* pending_pages = malloc(capacity * sizeof(uint32_t));
+	uint64_t pending_txn_id = 0;
+	void* page = malloc(page_size);
+
+	off_t offset = 0;
+	WalRecordHeader header;
+	while (pread_fully(wal_fd, &header, sizeof(header), offset)) {
+		off_t data_offset = offset + sizeof(header);
+
+		if (header.type == WAL_RECORD_PAGE) {
+			/* a torn or garbled page means the log ends here */
+			if (!pread_fully(wal_fd, page, page_size, data_offset) ||
+				compute_wal_checksum(&header, page, page_size) != header.checksum) {
+				break;
+			}
+			/* frames from a statement that never committed are dropped */
+			if (header.txn_id != pending_txn_id) {
+				num_pending = 0;
+				pending_txn_id = header.txn_id;
+			}
+			if (num_pending == capacity) {
+				capacity *= 2;
+				pending_offsets = realloc(pending_offsets, capacity * sizeof(off_t));
+				pending_pages = realloc(pending_pages, capacity * sizeof(uint32_t));
+			}
+			pending_offsets[num_pending] = data_offset;
+			pending_pages[num_pending] = header.page_num;
+			num_pending++;
+			offset = data_offset + page_size;
+		} else if (header.type == WAL_RECORD_COMMIT &&
+			compute_wal_checksum(&header, NULL, 0) == header.checksum &&
+			header.txn_id == pending_txn_id && header.page_num == num_pending) {
+			/* the statement committed, so copy its pages into the DB */
+			for (uint32_t i = 0; i < num_pending; i++) {
+				if (!pread_fully(wal_fd, page, page_size, pending_offsets[i]) ||
+					!pwrite_fully(file_descriptor, page, page_size, (off_t) pending_pages[i] * page_size)) {
+					printf("Error replaying the write-ahead log: %d\n", errno);
+					exit(EXIT_FAILURE);
+				}
+			}
+			num_pending = 0;
+			offset = data_offset;
+		} else {
+			break;
+		}
+	}
+
+	/* the replayed pages have to be safe before the WAL goes away */
+	fsync(file_descriptor);
+	close(wal_fd);
+	unlink(wal_path);
+	free(wal_path);
+
+	free(page);
+	free(pending_offsets);
+	free(pending_pages);
+}
+
+/*
+	background thread that makes pending commits durable: it wakes up
+	once per group commit window and syncs whatever has been appended,
+	which releases every commit waiting on that sync
+
+	arg: pointer to the Wal struct
+*/
+void* run_wal_flusher(void* arg) {
+	Wal* wal = arg;
+	pthread_mutex_lock(&wal->lock);
+	while (!wal->stopping) {
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += (long) wal->group_commit_ms * 1000000;
+		deadline.tv_sec += deadline.tv_nsec / 1000000000;
+		deadline.tv_nsec %= 1000000000;
+		pthread_cond_timedwait(&wal->wake, &wal->lock, &deadline);
+
+		if (wal->synced_length < wal->length) {
+			pthread_mutex_unlock(&wal->lock);
+			sync_wal(wal);
+			pthread_mutex_lock(&wal->lock);
+		}
+	}
+	pthread_mutex_unlock(&wal->lock);
+	return NULL;
+}
+
+/*
+	opens (and empties) the WAL for a DB whose recovery already ran,
+	starting the background flusher if commits are grouped by time
+
+	filename: pointer to a string containing the DB filename
+	options: pointer to the options the DB is being opened with
+	returns: pointer to a Wal struct ready for appends
+*/
+Wal* open_wal(const char* filename, DatabaseOptions* options) {
+	Wal* wal = malloc(sizeof(Wal));
+	wal->path = get_wal_path(filename);
+	wal->file_descriptor = open(wal->path, O_RDWR | O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR);
+	if (wal->file_descriptor == -1) {
+		printf("The write-ahead log could not be opened\n");
+		exit(EXIT_FAILURE);
+	}
+
+	wal->length = 0;
+	wal->synced_length = 0;
+	wal->generation = 0;
+	wal->num_syncs = 0;
+	wal->next_txn_id = 1;
+	wal->group_commit_ms = options->group_commit_ms;
+	wal->group_commit_bytes = options->group_commit_bytes;
+	wal->checkpoint_bytes = options->checkpoint_bytes;
+
+	pthread_mutex_init(&wal->lock, NULL);
+	pthread_cond_init(&wal->wake, NULL);
+	pthread_cond_init(&wal->synced, NULL);
+	wal->stopping = false;
+	wal->num_syncing = 0;
+	wal->num_waiting = 0;
+	wal->logged_pages = NULL;
+	wal->logged_pages_capacity = 0;
+	wal->num_logged_pages = 0;
+	wal->statement_records = 0;
+	/* with no time window, every commit syncs on its own */
+	if (wal->group_commit_ms > 0) {
+		pthread_create(&wal->flusher, NULL, run_wal_flusher, wal);
+	}
+
+	return wal;
+}
+
+/*
+	fsyncs everything appended to the WAL so far, if anything is
+	waiting -- this makes every commit before the call durable; the
+	lock isn't held during the fsync, so appends can keep going
+
+	wal: pointer to an open Wal struct
+*/
+void sync_wal(Wal* wal) {
+	pthread_mutex_lock(&wal->lock);
+	off_t target = wal->length;
+	uint64_t generation = wal->generation;
+	if (wal->synced_length >= target) {
+		pthread_mutex_unlock(&wal->lock);
+		return;
+	}
+	wal->num_syncing++;
+	pthread_mutex_unlock(&wal->lock);
+
+	if (fdatasync(wal->file_descriptor) == -1) {
+		printf("Error syncing the write-ahead log: %d\n", errno);
+		exit(EXIT_FAILURE);
+	}
+
+	/* a checkpoint may have emptied the WAL while we were syncing */
+	pthread_mutex_lock(&wal->lock);
+	if (wal->generation == generation && wal->synced_length < target) {
+		wal->synced_length = target;
+	}
+	wal->num_syncing--;
+	wal->num_syncs++;
+	pthread_cond_broadcast(&wal->synced);
+	pthread_mutex_unlock(&wal->lock);
+}
+
+/*
+	adds a page to the list of pages changed by the current statement;
+	those pages are logged when the statement commits and are kept out
+	of the DB file until then
+
+	pager: pointer to a Pager struct with the WAL on
+	page_num: number of the modified page
+*/
+void add_statement_page(Pager* pager, uint32_t page_num) {
+	if (pager->num_statement_pages == pager->statement_pages_capacity) {
+		pager->statement_pages_capacity = 2 * pager->statement_pages_capacity + 16;
+		pager->statement_pages = realloc(pager->statement_pages,
+			pager->statement_pages_capacity * sizeof(uint32_t));
+	}
+	pager->statement_pages[pager->num_statement_pages++] = page_num;
+}
+
+/*
+	finds the slot for the given page in the table of logged pages --
+	the one holding it, or the empty one it would go in
+
+	wal: pointer to an open Wal struct with a table
+	page_num: number of the page
+	returns: pointer to the slot
+*/
+LoggedPage* find_logged_page_slot(Wal* wal, uint32_t page_num) {
+	uint32_t mask = wal->logged_pages_capacity - 1;
+	uint32_t slot = (page_num * 2654435761u) & mask;
+	while (wal->logged_pages[slot].offset != 0 && wal->logged_pages[slot].page_num != page_num) {
+		slot = (slot + 1) & mask;
+	}
+	return &wal->logged_pages[slot];
+}
+
+/* returns where the latest image of the given page is in the WAL, or
+0 if the DB file has the latest one */
+off_t find_logged_page(Wal* wal, uint32_t page_num) {
+	if (wal->num_logged_pages == 0) {
+		return 0;
+	}
+	off_t offset = find_logged_page_slot(wal, page_num)->offset;
+	return (offset > 0) ? offset : 0;
+}
+
+/*
+	records that the latest image of the given page is in the WAL, at
+	the given offset, growing the table if it's half full
+
+	wal: pointer to an open Wal struct
+	page_num: number of the page
+	offset: where the page's image starts in the WAL
+*/
+void remember_logged_page(Wal* wal, uint32_t page_num, off_t offset) {
+	if (2 * (wal->num_logged_pages + 1) > wal->logged_pages_capacity) {
+		LoggedPage* old_pages = wal->logged_pages;
+		uint32_t old_capacity = wal->logged_pages_capacity;
+		wal->logged_pages_capacity = (old_capacity == 0) ? 64 : 2 * old_capacity;
+		wal->logged_pages = calloc(wal->logged_pages_capacity, sizeof(LoggedPage));
+		wal->num_logged_pages = 0;
+		for (uint32_t i = 0; i < old_capacity; i++) {
+			if (old_pages[i].offset > 0) {
+				*find_logged_page_slot(wal, old_pages[i].page_num) = old_pages[i];
+				wal->num_logged_pages++;
+			}
+		}
+		free(old_pages);
+	}
+
+	LoggedPage* slot = find_logged_page_slot(wal, page_num);
+	if (slot->offset == 0) {
+		wal->num_logged_pages++;
+	}
+	slot->page_num = page_num;
+	slot->offset = offset;
+}
+
+/* records that the DB file has caught up with the given page; the
+slot stays taken, so the pages after it can still be found */
+void forget_logged_page(Wal* wal, uint32_t page_num) {
+	if (wal->num_logged_pages == 0) {
+		return;
+	}
+	LoggedPage* slot = find_logged_page_slot(wal, page_num);
+	if (slot->offset > 0) {
+		slot->offset = -1;
+	}
+}
+
+/*
+	steals an uncommitted page from the buffer pool: it can't go to
+	the DB file until its statement commits, so its image goes into
+	the WAL under the statement's transaction instead, and comes back
+	from there if it's needed again -- must be called with the pool
+	mutex held, by the writer
+
+	pager: pointer to a Pager struct with the WAL on
+	frame_index: index of the frame being evicted
+*/
+void log_evicted_page(Pager* pager, uint32_t frame_index) {
+	Wal* wal = pager->wal;
+	Frame* frame = &pager->frames[frame_index];
+
+	/* the statement's commit record will count this record too */
+	WalRecordHeader header;
+	memset(&header, 0, sizeof(WalRecordHeader));
+	header.type = WAL_RECORD_PAGE;
+	header.page_num = frame->page_num;
+	header.txn_id = wal->next_txn_id;
+	header.checksum = compute_wal_checksum(&header, frame->data, pager->page_size);
+	struct iovec iov[2] = {
+		{ &header, sizeof(WalRecordHeader) },
+		{ frame->data, pager->page_size },
+	};
+	ssize_t record_bytes = sizeof(WalRecordHeader) + pager->page_size;
+	IoRequest request;
+	set_io_request(&request, true, wal->length, iov, 2);
+	do_io_request(wal->file_descriptor, &request);
+	if (request.result != record_bytes) {
+		printf("Error writing the write-ahead log: %d\n", errno);
+		exit(EXIT_FAILURE);
+	}
+
+	remember_logged_page(wal, frame->page_num, wal->length + sizeof(WalRecordHeader));
+	pthread_mutex_lock(&wal->lock);
+	wal->length += record_bytes;
+	pthread_mutex_unlock(&wal->lock);
+	wal->statement_records++;
+	pager->stats.wal_bytes_written += record_bytes;
+	frame->dirty = false;
+	frame->in_statement = false;
+}
+
+/*
+	reads a page image back from the WAL
+
+	pager: pointer to a Pager struct with the WAL on
+	offset: where the image starts, from find_logged_page()
+	page: where to put the page
+*/
+void read_logged_page(Pager* pager, off_t offset, void* page) {
+	if (!pread_fully(pager->wal->file_descriptor, page, pager->page_size, offset)) {
+		printf("Couldn't read a page back from the write-ahead log: %d\n", errno);
+		exit(EXIT_FAILURE);
+	}
+	pager->stats.pages_read++;
+	pager->stats.bytes_read += pager->page_size;
+}
+
+/*
+	copies every page whose latest image is only in the WAL into the
+	DB file and empties the table, ahead of the WAL being emptied --
+	the WAL has to be synced first, and dirty frames written after,
+	since a frame may hold a newer image than the WAL
+
+	pager: pointer to a Pager struct with the WAL on
+*/
+void copy_logged_pages(Pager* pager) {
+	Wal* wal = pager->wal;
+	void* page = malloc(pager->page_size);
+	for (uint32_t i = 0; i < wal->logged_pages_capacity; i++) {
+		LoggedPage* slot = &wal->logged_pages[i];
+		if (slot->offset <= 0) {
+			continue;
+		}
+		read_logged_page(pager, slot->offset, page);
+		off_t file_offset = (off_t) slot->page_num * pager->page_size;
+		if (!pwrite_fully(pager->file_descriptor, page, pager->page_size, file_offset)) {
+			printf("Error writing: %d\n", errno);
+			exit(EXIT_FAILURE);
+		}
+		pager->stats.pages_written++;
+		pager->stats.bytes_written += pager->page_size;
+		if (file_offset + (off_t) pager->page_size > pager->file_length) {
+			pager->file_length = file_offset + pager->page_size;
+		}
+	}
+	free(page);
+	free(wal->logged_pages);
+	wal->logged_pages = NULL;
+	wal->logged_pages_capacity = 0;
+	wal->num_logged_pages = 0;
+}
+
+/* qsort() comparator for page numbers */
+int compare_page_nums(const void* a, const void* b) {
+	uint32_t page_a = *(uint32_t*)a;
+	uint32_t page_b = *(uint32_t*)b;
+	return (page_a > page_b) - (page_a < page_b);
+}
+
+/*
+	logs every page the current statement changed, followed by a
+	commit record, syncing the WAL right away if the group commit
+	window is full and checkpointing if the WAL has grown too big;
+	without the WAL, it only keeps mmap mode's private copies in check
+
+	pager: pointer to a populated Pager struct
+	returns: where the commit record ends, for wait_for_commit()
+*/
+WalCommit log_statement(Pager* pager) {
+	Wal* wal = pager->wal;
+	WalCommit commit_end = { 0, 0 };
+	if (wal == NULL) {
+		trim_mapped_pages(pager);
+		return commit_end;
+	}
+	if (pager->num_statement_pages == 0) {
+		return commit_end;
+	}
+
+	/* a page shows up once per write, so sort out the repeats */
+	qsort(pager->statement_pages, pager->num_statement_pages, sizeof(uint32_t), compare_page_nums);
+	uint32_t num_pages = 0;
+	for (uint32_t i = 0; i < pager->num_statement_pages; i++) {
+		if (num_pages == 0 || pager->statement_pages[i] != pager->statement_pages[num_pages - 1]) {
+			pager->statement_pages[num_pages++] = pager->statement_pages[i];
+		}
+	}
+
+	/* a page that was evicted since it changed is in the WAL already */
+	uint32_t num_cached = 0;
+	for (uint32_t i = 0; i < num_pages; i++) {
+		uint32_t page_num = pager->statement_pages[i];
+		lock_pool(pager);
+		bool cached = (find_frame(pager, page_num) != INVALID_FRAME);
+		unlock_pool(pager);
+		if (cached || find_logged_page(wal, page_num) == 0) {
+			pager->statement_pages[num_cached++] = page_num;
+		}
+	}
+	num_pages = num_cached;
+
+	/* append the page images, a batch of pages per pwritev() */
+	uint64_t txn_id = wal->next_txn_id++;
+	WalRecordHeader headers[WAL_MAX_BATCH_PAGES];
+	struct iovec iov[2 * WAL_MAX_BATCH_PAGES];
+	for (uint32_t start = 0; start < num_pages; start += WAL_MAX_BATCH_PAGES) {
+		uint32_t batch = num_pages - start;
+		if (batch > WAL_MAX_BATCH_PAGES) {
+			batch = WAL_MAX_BATCH_PAGES;
+		}
+
+		for (uint32_t i = 0; i < batch; i++) {
+			uint32_t page_num = pager->statement_pages[start + i];
+			/* the page can't have been evicted, so this is a cache hit */
+			void* page = get_page(pager, page_num);
+			memset(&headers[i], 0, sizeof(WalRecordHeader));
+			headers[i].type = WAL_RECORD_PAGE;
+			headers[i].page_num = page_num;
+			headers[i].txn_id = txn_id;
+			headers[i].checksum = compute_wal_checksum(&headers[i], page, pager->page_size);
+			iov[2 * i].iov_base = &headers[i];
+			iov[2 * i].iov_len = sizeof(WalRecordHeader);
+			iov[2 * i + 1].iov_base = page;
+			iov[2 * i + 1].iov_len = pager->page_size;
+
+			/* the page is committed now, so it may be evicted again */
+			lock_pool(pager);
+			uint32_t frame_index = find_frame(pager, page_num);
+			if (frame_index != INVALID_FRAME) {
+				pager->frames[frame_index].in_statement = false;
+			}
+			unlock_pool(pager);
+		}
+
+		ssize_t batch_bytes = batch * (sizeof(WalRecordHeader) + pager->page_size);
+		IoRequest request;
+		set_io_request(&request, true, wal->length, iov, 2 * batch);
+		do_io_request(wal->file_descriptor, &request);
+		if (request.result != batch_bytes) {
+			printf("Error writing the write-ahead log: %d\n", errno);
+			exit(EXIT_FAILURE);
+		}
+		pthread_mutex_lock(&wal->lock);
+		wal->length += batch_bytes;
+		pthread_mutex_unlock(&wal->lock);
+		pager->stats.wal_bytes_written += batch_bytes;
+	}
+
+	/* the commit record says how many pages the statement logged */
+	WalRecordHeader commit;
+	memset(&commit, 0, sizeof(WalRecordHeader));
+	commit.type = WAL_RECORD_COMMIT;
+	commit.page_num = num_pages + wal->statement_records;
+	commit.txn_id = txn_id;
+	commit.checksum = compute_wal_checksum(&commit, NULL, 0);
+	if (!pwrite_fully(wal->file_descriptor, &commit, sizeof(commit), wal->length)) {
+		printf("Error writing the write-ahead log: %d\n", errno);
+		exit(EXIT_FAILURE);
+	}
+	pager->stats.wal_bytes_written += sizeof(commit);
+	pthread_mutex_lock(&wal->lock);
+	wal->length += sizeof(commit);
+	commit_end.end = wal->length;
+	commit_end.generation = wal->generation;
+	off_t unsynced_bytes = wal->length - wal->synced_length;
+	pthread_mutex_unlock(&wal->lock);
+	pager->num_statement_pages = 0;
+	wal->statement_records = 0;
+
+	if (unsynced_bytes >= wal->group_commit_bytes || wal->group_commit_ms == 0) {
+		sync_wal(wal);
+	}
+	if (wal->length >= wal->checkpoint_bytes) {
+		checkpoint(pager);
+	}
+	return commit_end;
+}
+
+/*
+	waits until the given commit record is on disk -- a statement
+	isn't done until then; it's called after the writer has let go,
+	so the next statement can log its pages and share the same sync
+
+	if no sync is running and nobody else is waiting, there's nothing
+	to group with, so it syncs right away; otherwise it waits for the
+	running sync, or for the flusher thread's next one
+
+	pager: pointer to a populated Pager struct
+	commit: what log_statement() returned
+*/
+void wait_for_commit(Pager* pager, WalCommit commit) {
+	Wal* wal = pager->wal;
+	if (wal == NULL || commit.end == 0) {
+		return;
+	}
+
+	/* a checkpoint syncs everything, so a new generation means the
+	record is safe */
+	pthread_mutex_lock(&wal->lock);
+	while (wal->synced_length < commit.end && wal->generation == commit.generation) {
+		if (wal->num_syncing == 0 && wal->num_waiting == 0) {
+			pthread_mutex_unlock(&wal->lock);
+			sync_wal(wal);
+			pthread_mutex_lock(&wal->lock);
+		} else {
+			wal->num_waiting++;
+			pthread_cond_wait(&wal->synced, &wal->lock);
+			wal->num_waiting--;
+		}
+	}
+	pthread_mutex_unlock(&wal->lock);
+}
+
+/*
+	logs the current statement and waits for it to be durable, for
+	callers that don't have anyone to let in first
+
+	pager: pointer to a populated Pager struct
+*/
+void commit_statement(Pager* pager) {
+	wait_for_commit(pager, log_statement(pager));
+}
+
+/*
+	folds the WAL into the DB file: sync the WAL, write every page
+	that's only in the WAL and every dirty page to the DB file, sync
+	the DB file, then empty the WAL; must only run between statements
+
+	pager: pointer to a populated Pager struct
+*/
+void checkpoint(Pager* pager) {
+	Wal* wal = pager->wal;
+	if (wal == NULL) {
+		flush_dirty_pages(pager);
+		return;
+	}
+
+	sync_wal(wal);
+	lock_pool(pager);
+	copy_logged_pages(pager);
+	unlock_pool(pager);
+	flush_dirty_pages(pager);
+	if (fsync(pager->file_descriptor) == -1) {
+		printf("Error syncing the DB file: %d\n", errno);
+		exit(EXIT_FAILURE);
+	}
+	pager->stats.fsyncs++;
+
+	pthread_mutex_lock(&wal->lock);
+	if (ftruncate(wal->file_descriptor, 0) == -1) {
+		printf("Error truncating the write-ahead log: %d\n", errno);
+		exit(EXIT_FAILURE);
+	}
+	wal->length = 0;
+	wal->synced_length = 0;
+	wal->generation++;
+	pthread_cond_broadcast(&wal->synced);
+	pthread_mutex_unlock(&wal->lock);
+}
+
+/*
+	checkpoints the DB one last time and removes the WAL file
+
+	pager: pointer to a populated Pager struct
+*/
+void close_wal(Pager* pager) {
+	Wal* wal = pager->wal;
+
+	/* stop the flusher before the last checkpoint */
+	if (wal->group_commit_ms > 0) {
+		pthread_mutex_lock(&wal->lock);
+		wal->stopping = true;
+		pthread_cond_signal(&wal->wake);
+		pthread_mutex_unlock(&wal->lock);
+		pthread_join(wal->flusher, NULL);
+	}
+
+	checkpoint(pager);
+	close(wal->file_descriptor);
+	unlink(wal->path);
+	pthread_mutex_destroy(&wal->lock);
+	pthread_cond_destroy(&wal->wake);
+	pthread_cond_destroy(&wal->synced);
+	free(wal->path);
+	free(wal);
+	pager->wal = NULL;
+}